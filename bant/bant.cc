@@ -26,6 +26,7 @@ extern int optind;                             // NOLINT
 int getopt(int, char *const *, const char *);  // NOLINT
 }
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
@@ -44,33 +45,19 @@ int getopt(int, char *const *, const char *);  // NOLINT
 #include "bant/output-format.h"
 #include "bant/session.h"
 
-// Generated from at compile time from git tag or MODULE.bazel version
-#include "bant/generated-build-version.h"
 #include "bant/util/filesystem-prewarm-cache.h"
 
 #define BOLD  "\033[1m"
 #define RED   "\033[1;31m"
 #define RESET "\033[0m"
 
-// Print version coming from BANT_BUILD_GIT_VERSION that is generated by
-// by workspace status extracted from git.
-// If that didn't happen (e.g. we're built as part of being a MODULE.bazel
-// dependency), use BANT_MODULE_VERSION as secondary source.
 static int print_version() {
-#ifdef BANT_BUILD_GIT_VERSION
-#define RELEVANT_VERSION BANT_BUILD_GIT_VERSION
-#elif defined(BANT_MODULE_VERSION)
-#define RELEVANT_VERSION BANT_MODULE_VERSION
-#else
-#define RELEVANT_VERSION "(unknown)"
-#endif
   fprintf(stderr,
           "bant v%s <http://bant.build/>\n"
           "Copyright (c) 2024-2025 Henner Zeller. "
           "This program is free software; GPL 3.0.\n",
-          RELEVANT_VERSION);
+          bant::BantVersion());
   return EXIT_SUCCESS;
-#undef RELEVANT_VERSION
 }
 
 static int usage(const char *prog, const char *message, int exit_code) {
@@ -89,6 +76,8 @@ static int usage(const char *prog, const char *message, int exit_code) {
                      An optional parameter allows to limit the nesting depth,
                      e.g. -r2 just follows two levels after the toplevel
                      pattern. -r0 is equivalent to not providing -r.
+    -j <count>     : Number of threads to use where work is parallelized,
+                     e.g. in dwyu. Default: number of cores.
     -v             : Verbose; print some stats. Multiple times: more verbose.
     -h             : This help.
     --//<option>   : configurable flag attribute to be used in select() and
@@ -128,9 +117,21 @@ Commands (unique prefix sufficient):
     genrule-outputs: Print generated files by genrule()s matching pattern.
                      → 2 column table: (filename, genrule-target)
 
+    query          : Evaluate a bazel-query like expression (quote in shell)
+                     deps(x [, depth]), rdeps(universe, x [, depth]),
+                     allpaths(from, to), somepath(from, to), kind(regex, x),
+                     filter(regex, x), attr(name, regex, x),
+                     x union y (+), x intersect y (^), x except y (-)
+                     → 1 column table: (target)
+
     %s== Tools ==%s
     dwyu           : DWYU: Depend on What You Use (emit buildozer edit script)
                       -k strict: emit remove even if # keep comment in line.
+                      -s <bytes> : Only scan the beginning of sources: stop
+                                   looking for #includes once <bytes> of code
+                                   follow the last one. Default: whole file.
+                      -a : check all targets; don't reuse results of previous
+                           runs kept in ~/.cache/bant/
     canonicalize   : Emit rename edits to canonicalize targets.
     compile-flags  : (experimental) Emit compile flags to stdout. Redirect to
                      compile_flags.txt
@@ -187,7 +188,7 @@ int main(int argc, char *argv[]) {
     {"json", OutputFormat::kJSON},     {"graphviz", OutputFormat::kGraphviz},
   };
   int opt;
-  while ((opt = getopt(argc, argv, "C:qo:vhpecbf:r::Vkg:i")) != -1) {
+  while ((opt = getopt(argc, argv, "C:qo:vhpecbf:r::Vkg:ij:s:a")) != -1) {
     switch (opt) {
     case 'C': {
       std::error_code err;
@@ -226,6 +227,12 @@ int main(int argc, char *argv[]) {
 
     case 'k': flags.ignore_keep_comment = true; break;
 
+    case 'a': flags.recheck_all = true; break;
+
+    case 's': flags.include_scan_slack = std::max(0, atoi(optarg)); break;
+
+    case 'j': flags.jobs = atoi(optarg); break;
+
     case 'g': flags.grep_regex = optarg; break;
 
     case 'i':
@@ -21,27 +21,38 @@
 #include <iterator>
 #include <limits>
 #include <map>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "bant/explore/aliased-by.h"
 #include "bant/explore/dependency-graph.h"
+#include "bant/explore/dependency-index.h"
+#include "bant/explore/dependents-prefilter.h"
 #include "bant/explore/header-providers.h"
+#include "bant/explore/include-cache.h"
+#include "bant/explore/query-expression.h"
 #include "bant/explore/query-utils.h"
 #include "bant/frontend/elaboration.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/label-table.h"
 #include "bant/session.h"
 #include "bant/types-bazel.h"
 #include "bant/types.h"
 #include "bant/util/table-printer.h"
 #include "bant/workspace.h"
 
+// Generated from at compile time from git tag or MODULE.bazel version
+#include "bant/generated-build-version.h"
+
 // Tools accessible by these commands
 #include "bant/tool/canon-targets.h"
 #include "bant/tool/compilation-db.h"
+#include "bant/tool/dwyu-cache.h"
 #include "bant/tool/dwyu.h"
 #include "bant/tool/edit-callback.h"
 #include "bant/tool/workspace.h"
@@ -72,6 +83,7 @@ enum class Command {
   kCanonicalizeDeps,
   kHasDependents,
   kDependsOn,
+  kQuery,
 };
 
 void PrintOneToN(bant::Session &session, const BazelTargetMatcher &pattern,
@@ -91,6 +103,25 @@ void PrintOneToN(bant::Session &session, const BazelTargetMatcher &pattern,
   printer->Finish();
 }
 
+// Same output as above, but for one direction of the dependency graph.
+void PrintOneToN(bant::Session &session, const BazelTargetMatcher &pattern,
+                 const DependencyGraph &graph, const TargetAdjacency &table,
+                 const std::string &header1, const std::string &header2) {
+  auto printer = TablePrinter::Create(
+    session.out(), session.flags().output_format, {header1, header2});
+  std::vector<std::string> repeat_print;
+  for (const TargetId id : table.keys()) {
+    if (!pattern.Match(graph.labels.target(id))) continue;
+    repeat_print.clear();
+    for (const TargetId t : table.edges(id)) {
+      repeat_print.emplace_back(graph.labels.ToString(t));
+    }
+    printer->AddRowWithRepeatedLastColumn({graph.labels.ToString(id)},
+                                          repeat_print);
+  }
+  printer->Finish();
+}
+
 static bool NeedsProjectPopulated(Command cmd,
                                   const BazelTargetMatcher &pattern) {
   // No need to even parse the project if we just print the full workspace
@@ -101,7 +132,8 @@ static bool NeedsProjectPopulated(Command cmd,
 }
 
 CliStatus RunCommand(Session &session, Command cmd,
-                     const BazelPatternBundle &patterns) {
+                     const BazelPatternBundle &patterns,
+                     const QueryExpression *query) {
   // -- TODO: a lot of the following functionality including choosing what
   // data is needed needs to move into each command itself.
   // We don't have a 'Command' object yet, so linear here.
@@ -127,16 +159,42 @@ CliStatus RunCommand(Session &session, Command cmd,
 
   CommandlineFlags flags = session.flags();
 
+  // Commands only looking at the dependency graph can get it from an index
+  // kept between runs; then only the BUILD files that changed are parsed.
+  // Has dependents looks at everything every time, so benefits most.
+  std::unique_ptr<DependencyIndex> dependency_index;
+  if (cmd == Command::kHasDependents || cmd == Command::kDependsOn) {
+    if (auto index_file = DependencyIndexCacheFile(); index_file.has_value()) {
+      dependency_index =
+        std::make_unique<DependencyIndex>(*index_file, flags.custom_flags);
+    }
+  }
+
   bant::ParsedProject project(workspace, flags.verbose);
-  if (NeedsProjectPopulated(cmd, patterns)) {
-    if (project.FillFromPattern(session, dep_pattern) == 0) {
+  bool all_dependents_parsed = false;
+  if (NeedsProjectPopulated(cmd, patterns) && !dependency_index) {
+    int found;
+    if (cmd == Command::kHasDependents) {
+      // Without index, only parse the files that could mention the targets
+      // we're looking for. If these are all in our project, they are all
+      // we need to look at, no need to follow their dependencies.
+      const DependentsPrefilter prefilter(patterns);
+      found = FillWithPossibleDependents(session, dep_pattern, prefilter,
+                                         &project);
+      all_dependents_parsed =
+        prefilter.HasFilter() && prefilter.OnlyMainProjectTargets();
+    } else {
+      found = project.FillFromPattern(session, dep_pattern);
+    }
+    if (found == 0) {
       session.error() << "Pattern did not match any dir with BUILD file.\n";
     }
   }
 
   if (flags.recurse_dependency_depth <= 0 &&
       (cmd == Command::kDWYU || cmd == Command::kHasDependents)) {
-    flags.recurse_dependency_depth = std::numeric_limits<int>::max();
+    flags.recurse_dependency_depth =
+      all_dependents_parsed ? 0 : std::numeric_limits<int>::max();
   }
 
   if (flags.elaborate ||        //
@@ -159,8 +217,15 @@ CliStatus RunCommand(Session &session, Command cmd,
   case Command::kHasDependents:
     if (flags.recurse_dependency_depth >= 0) {
       const size_t before_build_files = project.ParsedFiles().size();
-      graph = bant::BuildDependencyGraph(
-        session, dep_pattern, flags.recurse_dependency_depth, &project);
+      if (dependency_index) {
+        graph = bant::BuildDependencyGraph(session, dep_pattern,
+                                           flags.recurse_dependency_depth,
+                                           &project, dependency_index.get());
+        dependency_index->Save();
+      } else {
+        graph = bant::BuildDependencyGraph(
+          session, dep_pattern, flags.recurse_dependency_depth, &project);
+      }
       const size_t after_build_files = project.ParsedFiles().size();
       if (session.flags().verbose) {
         session.info() << "Dependency graph expanded build file# from initial "
@@ -206,13 +271,29 @@ CliStatus RunCommand(Session &session, Command cmd,
       ExtractGeneratedFromGenrule(project, session.info()));
     break;
 
-  case Command::kDWYU:
-    if (bant::CreateDependencyEdits(
-          session, project, patterns,
-          CreateBuildozerDepsEditCallback(session.out())) > 0) {
+  case Command::kDWYU: {
+    // Results of targets whose inputs did not change are kept between runs
+    // of the same bant version, as are the includes of unchanged sources.
+    std::unique_ptr<DWYUResultCache> result_cache;
+    if (auto cache_file = DWYUResultCacheFile(); cache_file.has_value()) {
+      result_cache =
+        std::make_unique<DWYUResultCache>(*cache_file, BantVersion());
+    }
+    std::unique_ptr<IncludeCache> include_cache;
+    if (auto cache_file = IncludeCacheFile(); cache_file.has_value()) {
+      include_cache = std::make_unique<IncludeCache>(*cache_file);
+    }
+    const size_t edits = bant::CreateDependencyEdits(
+      session, project, patterns,
+      CreateBuildozerDepsEditCallback(session.out()), result_cache.get(),
+      include_cache.get());
+    if (result_cache) result_cache->Save(patterns);
+    if (include_cache) include_cache->Save();
+    if (edits > 0) {
       return CliStatus::kExitCleanupFindings;
     }
     break;
+  }
 
   case Command::kCanonicalizeDeps:
     if (CreateCanonicalizeEdits(
@@ -236,17 +317,18 @@ CliStatus RunCommand(Session &session, Command cmd,
       TablePrinter::Create(session.out(), session.flags().output_format,
                            {"file-location", "rule", "target"});
     for (const auto &[package, parsed] : project.ParsedFiles()) {
-      FindTargets(parsed->ast, {}, [&](const Result &target) {
-        auto target_name =
-          BazelTarget::ParseFrom(absl::StrCat(":", target.name), package);
-        if (!target_name.has_value()) {
-          return;
-        }
-        if (!print_pattern.Match(*target_name)) return;
-        printer->AddRow({project.Loc(target.name),
-                         std::string(target.rule),  //
-                         target_name->ToString()});
-      });
+      FindTargets(
+        parsed->ast, {}, {query::Attribute::kName}, [&](const Result &target) {
+          auto target_name =
+            BazelTarget::ParseFrom(absl::StrCat(":", target.name), package);
+          if (!target_name.has_value()) {
+            return;
+          }
+          if (!print_pattern.Match(*target_name)) return;
+          printer->AddRow({project.Loc(target.name),
+                           std::string(target.rule),  //
+                           target_name->ToString()});
+        });
     }
     printer->Finish();
   } break;
@@ -262,17 +344,26 @@ CliStatus RunCommand(Session &session, Command cmd,
 
   case Command::kDependsOn:
     // If explicitly asked recursively, print all that.
-    PrintOneToN(session, print_pattern, graph.depends_on,  //
+    PrintOneToN(session, print_pattern, graph, graph.depends_on,  //
                 "library", "depends-on");
     break;
 
   case Command::kHasDependents:
     // Print exactly what requested, as we implicitly had to recurse through
     // everything, so print_pattern would be too much.
-    PrintOneToN(session, patterns, graph.has_dependents,  //
+    PrintOneToN(session, patterns, graph, graph.has_dependents,  //
                 "library", "has-dependent");
     break;
 
+  case Command::kQuery: {
+    auto printer = TablePrinter::Create(
+      session.out(), session.flags().output_format, {"target"});
+    for (const BazelTarget &target : RunQuery(session, *query, &project)) {
+      printer->AddRow({target.ToString()});
+    }
+    printer->Finish();
+  } break;
+
   case Command::kCompilationDB:
   case Command::kCompileFlags:
     WriteCompilationFlags(session, patterns, &project,
@@ -306,6 +397,7 @@ CliStatus RunCliCommand(Session &session, std::span<std::string_view> args) {
     {"compilation-db", Command::kCompilationDB},
     {"compile-flags", Command::kCompileFlags},
     {"canonicalize", Command::kCanonicalizeDeps},
+    {"query", Command::kQuery},
   };
 
   if (!args.empty()) {
@@ -334,12 +426,26 @@ CliStatus RunCliCommand(Session &session, std::span<std::string_view> args) {
     return CliStatus::kExitCommandlineClarification;
   }
 
+  // The query expression is not a list of patterns; it brings its own.
+  if (cmd == Command::kQuery) {
+    const std::string expression = absl::StrJoin(args, " ");
+    auto query = QueryExpression::Parse(expression, session.error());
+    if (!query) return CliStatus::kExitFailure;
+    return RunCommand(session, cmd, query->patterns(), query.get());
+  }
+
   BazelPatternBundle patterns;
-  for (const std::string_view arg : args) {
+  for (std::string_view arg : args) {
+    const bool is_negative = arg.starts_with('-');  // -//foo/... excludes.
+    if (is_negative) arg.remove_prefix(1);
     if (auto p = BazelPattern::ParseFrom(arg); p.has_value()) {
-      patterns.AddPattern(p.value());
+      if (is_negative) {
+        patterns.AddNegativePattern(p.value());
+      } else {
+        patterns.AddPattern(p.value());
+      }
     } else {
-      session.error() << "Invalid bazel pattern " << args[0] << "\n";
+      session.error() << "Invalid bazel pattern " << arg << "\n";
       return CliStatus::kExitFailure;
     }
   }
@@ -355,6 +461,20 @@ CliStatus RunCliCommand(Session &session, std::span<std::string_view> args) {
     }
   }
 
-  return RunCommand(session, cmd, patterns);
+  return RunCommand(session, cmd, patterns, nullptr);
+}
+
+// Version coming from BANT_BUILD_GIT_VERSION that is generated by workspace
+// status extracted from git.
+// If that didn't happen (e.g. we're built as part of being a MODULE.bazel
+// dependency), use BANT_MODULE_VERSION as secondary source.
+const char *BantVersion() {
+#ifdef BANT_BUILD_GIT_VERSION
+  return BANT_BUILD_GIT_VERSION;
+#elif defined(BANT_MODULE_VERSION)
+  return BANT_MODULE_VERSION;
+#else
+  return "(unknown)";
+#endif
 }
 }  // namespace bant
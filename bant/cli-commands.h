@@ -31,5 +31,8 @@ enum class CliStatus {
   kExitCleanupFindings = 3,           // There were findings in cleanup
 };
 CliStatus RunCliCommand(Session &session, std::span<std::string_view> args);
+
+// Version of this bant binary; "(unknown)" if it was not built with one.
+const char *BantVersion();
 }  // namespace bant
 #endif  // BANT_CLI_COMMANDS
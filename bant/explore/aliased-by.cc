@@ -24,10 +24,13 @@
 
 namespace bant {
 OneToN<BazelTarget, BazelTarget> ExtractAliasedBy(const ParsedProject &p) {
+  static constexpr query::RuleSet kAliasRule{"alias"};
   OneToN<BazelTarget, BazelTarget> aliased_by;
   for (const auto &[_, build_file] : p.ParsedFiles()) {
     query::FindTargets(
-      build_file->ast, {"alias"}, [&](const query::Result &details) {
+      build_file->ast, kAliasRule,
+      {query::Attribute::kName, query::Attribute::kActual},
+      [&](const query::Result &details) {
         auto alias = build_file->package.QualifiedTarget(details.name);
         auto actual =
           BazelTarget::ParseFrom(details.actual, build_file->package);
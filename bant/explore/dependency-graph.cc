@@ -17,76 +17,271 @@
 
 #include "bant/explore/dependency-graph.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <future>
 #include <initializer_list>
+#include <map>
+#include <memory>
 #include <optional>
 #include <ostream>
 #include <set>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/time/time.h"
+#include "bant/explore/dependency-index.h"
 #include "bant/explore/query-utils.h"
+#include "bant/frontend/build-file-index.h"
 #include "bant/frontend/elaboration.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/label-table.h"
 #include "bant/session.h"
 #include "bant/types-bazel.h"
+#include "bant/util/cache-file.h"
 #include "bant/util/file-utils.h"
 #include "bant/util/stat.h"
-#include "bant/workspace.h"
+#include "bant/util/thread-pool.h"
 
 namespace bant {
 namespace {
 
-std::optional<FilesystemPath> PathForPackage(Session &session,
-                                             const BazelWorkspace &workspace,
-                                             const BazelPackage &package) {
-  Stat &stat = session.GetStatsFor("  - of which exist-check", "BUILD files");
-
-  std::string start_path;
-  if (!package.project.empty()) {
-    auto project_path_or = workspace.FindPathByProject(package.project);
-    if (!project_path_or.has_value()) {
-      // The following message would be too noisy right now as we attempt to
-      // read more dependencies than we need.
-      // info_out << "Can't find referenced " << package.project << "\n";
-      return std::nullopt;
-    }
-    start_path = project_path_or.value().path();
-  }
+// BUILD file of a package found and read by one of the workers. Each carries
+// its own stats, merged when collecting the results.
+struct LoadedBuildFile {
+  std::optional<FilesystemPath> path;
+  DependencyIndex::Lookup lookup;  // Without index: just the content.
+  int exist_checks = 0;
+  absl::Duration exist_check_duration;
+  absl::Duration read_duration;
+};
 
-  if (!package.path.empty()) {
-    if (!start_path.empty()) start_path.append("/");
-    start_path.append(package.path);
+LoadedBuildFile FindAndReadBuildFile(BuildFileIndex &index,
+                                     DependencyIndex *dependency_index,
+                                     const BazelPackage &package,
+                                     bool elaborate) {
+  LoadedBuildFile result;
+  {
+    const ScopedTimer timer(&result.exist_check_duration);
+    result.path = index.FindBuildFile(package, &result.exist_checks);
   }
-  const ScopedTimer timer(&stat.duration);
-  for (const std::string_view build_file : {"BUILD", "BUILD.bazel"}) {
-    FilesystemPath test_path(start_path, build_file);
-    ++stat.count;
-    if (test_path.can_read()) return test_path;
+  if (result.path.has_value()) {
+    const ScopedTimer timer(&result.read_duration);
+    if (dependency_index) {
+      result.lookup = dependency_index->Find(*result.path, elaborate);
+    } else {
+      result.lookup.content = ReadFileToString(*result.path);
+    }
   }
-  return std::nullopt;
+  return result;
 }
 
-void FindAndParseMissingPackages(Session &session,
-                                 const std::set<BazelPackage> &want,
-                                 std::set<BazelPackage> *error_packages,
-                                 ParsedProject *project) {
-  const BazelWorkspace &workspace = project->workspace();
-  for (const BazelPackage &package : want) {
-    if (project->FindParsedOrNull(package) != nullptr) {
-      continue;  // have it already.
-    }
-    auto path = PathForPackage(session, workspace, package);
-    if (!path.has_value()) {
-      error_packages->insert(package);
-      continue;
-    }
-    // Always elaborate new packages that we add as part of dependency graph
-    // building, as it might expand more dpendencies.
+// Rules of interest in a parsed BUILD file with what they depend on.
+DependencyIndex::RuleList ExtractRules(const ParsedBuildFile &parsed) {
+  static constexpr query::RuleSet kAllRules{};
+  DependencyIndex::RuleList result;
+  query::FindTargets(
+    parsed.ast, kAllRules,
+    {query::Attribute::kName, query::Attribute::kDeps,
+     query::Attribute::kActual},
+    [&](const query::Result &found) {
+      std::string_view name = found.name;
+      if (name.starts_with(':')) name.remove_prefix(1);
+      DependencyIndex::Rule &rule = result.emplace_back();
+      rule.name = name;
+      query::StringList deps;
+      query::AppendStringList(found.deps_list, deps);
+      if (!found.actual.empty()) deps.push_back(found.actual);
+      rule.deps.assign(deps.begin(), deps.end());
+    });
+  return result;
+}
+
+// Loads the packages needed while following dependencies. Packages can be
+// prefetched as soon as they are known to be needed: a pool of threads then
+// finds and reads their BUILD files while the caller is busy parsing and
+// scanning other packages.
+// Parsing and elaboration happen when the caller asks for a package, so
+// their order, and with it the result, is deterministic.
+//
+// With a DependencyIndex, the rules of packages are taken from there if
+// their BUILD file did not change; only the others are parsed.
+class PackageLoader {
+ public:
+  PackageLoader(Session &session, const LabelTable &labels,
+                std::set<BazelPackage> *error_packages, ParsedProject *project,
+                DependencyIndex *dependency_index)
+      : session_(session),
+        labels_(labels),
+        error_packages_(error_packages),
+        project_(project),
+        dependency_index_(dependency_index),
+        exist_stat_(
+          session.GetStatsFor("  - of which exist-check", "BUILD files")),
+        fread_stat_(session.GetStatsFor("read(BUILD)      ", "BUILD files")),
+        prefetch_stat_(
+          session.GetStatsFor("  - I/O hidden by prefetch", "BUILD files")),
+        reused_stat_(dependency_index
+                       ? &session.GetStatsFor("Dependency index: reused",
+                                              "packages")
+                       : nullptr),
+        recomputed_stat_(dependency_index
+                           ? &session.GetStatsFor(
+                               "Dependency index: recomputed", "packages")
+                           : nullptr) {}
+
+  // Start finding and reading the package in the background, unless we
+  // have it already.
+  void Prefetch(PackageId id, bool elaborate = true) {
+    if (in_flight_.contains(id)) return;
+    const BazelPackage &package = labels_.package(id);
+    if (dependency_index_ ? rules_.contains(id)
+                          : project_->FindParsedOrNull(package) != nullptr) {
+      return;
+    }
+    if (!read_pool_) {
+      read_pool_ = std::make_unique<ThreadPool>(kFileReadParallelism);
+    }
+    BuildFileIndex &index = project_->build_file_index();
+    DependencyIndex *const dependency_index = dependency_index_;
+    in_flight_.emplace(
+      id, read_pool_->ExecAsync([&index, dependency_index, &package,
+                                 elaborate]() {
+        return FindAndReadBuildFile(index, dependency_index, package,
+                                    elaborate);
+      }));
+  }
+
+  // Return the parsed and elaborated package, loading it if needed; this
+  // waits for a prefetch in progress. Returns nullptr if not available.
+  const ParsedBuildFile *GetOrLoad(PackageId id) {
+    const BazelPackage &package = labels_.package(id);
+    if (const auto *parsed = project_->FindParsedOrNull(package)) {
+      return parsed;
+    }
+    LoadedBuildFile loaded = Fetch(id, /*elaborate=*/true);
+    if (!loaded.path.has_value()) return nullptr;
+    return Parse(loaded, package, /*elaborate=*/true);
+  }
+
+  // Return the rules of the package, from the dependency index if its BUILD
+  // file is unchanged or by parsing it. Returns nullptr if not available.
+  const DependencyIndex::RuleList *GetRules(PackageId id,
+                                            bool elaborate = true) {
+    if (auto found = rules_.find(id); found != rules_.end()) {
+      return found->second;
+    }
+    const DependencyIndex::RuleList *result = nullptr;
+    LoadedBuildFile loaded = Fetch(id, elaborate);
+    if (loaded.lookup.rules) {
+      result = loaded.lookup.rules;
+    } else if (loaded.path.has_value() && loaded.lookup.content.has_value()) {
+      const ScopedTimer timer(&recomputed_stat_->duration);
+      const uint64_t fingerprint = Fingerprint(*loaded.lookup.content);
+      const FileStamp stamp = loaded.lookup.stamp;
+      if (const auto *parsed = Parse(loaded, labels_.package(id), elaborate)) {
+        ++recomputed_stat_->count;
+        result = dependency_index_->Update(*loaded.path, elaborate, stamp,
+                                           fingerprint, parsed->glob_dirs,
+                                           ExtractRules(*parsed));
+      }
+    }
+    rules_.emplace(id, result);
+    return result;
+  }
+
+ private:
+  // Get the result of the prefetch or find and read now.
+  LoadedBuildFile Fetch(PackageId id, bool elaborate) {
+    const BazelPackage &package = labels_.package(id);
+    LoadedBuildFile loaded;
+    if (auto found = in_flight_.find(id); found != in_flight_.end()) {
+      absl::Duration waited;
+      {
+        const ScopedTimer timer(&waited);
+        loaded = found->second.get();
+      }
+      in_flight_.erase(found);
+      const absl::Duration io_time =
+        loaded.exist_check_duration + loaded.read_duration;
+      ++prefetch_stat_.count;
+      if (io_time > waited) prefetch_stat_.duration += io_time - waited;
+    } else {
+      loaded = FindAndReadBuildFile(project_->build_file_index(),
+                                    dependency_index_, package, elaborate);
+    }
+
+    exist_stat_.count += loaded.exist_checks;
+    exist_stat_.duration += loaded.exist_check_duration;
+    if (!loaded.path.has_value()) {
+      error_packages_->insert(package);
+      return loaded;
+    }
+    if (loaded.lookup.rules) {
+      ++reused_stat_->count;
+      reused_stat_->duration += loaded.read_duration;
+    } else {
+      ++fread_stat_.count;
+      fread_stat_.duration += loaded.read_duration;
+    }
+    return loaded;
+  }
+
+  ParsedBuildFile *Parse(LoadedBuildFile &loaded, const BazelPackage &package,
+                         bool elaborate) {
+    // Packages added while following dependencies are always elaborated, as
+    // it might expand more dpendencies; the initially requested ones only
+    // with -e.
     // TODO: but do we need expensive glob() enabled ?
-    ParsedBuildFile *file = project->AddBuildFile(session, *path, package);
-    bant::Elaborate(session, project, file);
+    ParsedBuildFile *file = project_->AddBuildFile(
+      session_, *loaded.path, package, std::move(loaded.lookup.content));
+    if (file && elaborate) bant::Elaborate(session_, project_, file);
+    return file;
   }
+
+  Session &session_;
+  const LabelTable &labels_;
+  std::set<BazelPackage> *const error_packages_;
+  ParsedProject *const project_;
+  DependencyIndex *const dependency_index_;
+  Stat &exist_stat_;
+  Stat &fread_stat_;
+  Stat &prefetch_stat_;
+  Stat *const reused_stat_;      // Only with dependency index.
+  Stat *const recomputed_stat_;  // Only with dependency index.
+
+  absl::flat_hash_map<PackageId, std::future<LoadedBuildFile>> in_flight_;
+  absl::flat_hash_map<PackageId, const DependencyIndex::RuleList *> rules_;
+  std::unique_ptr<ThreadPool> read_pool_;  // Created once needed.
+};
+
+// Edge (from, to) as discovered while building the graph.
+using Edge = std::pair<TargetId, TargetId>;
+
+// Assemble the compressed sparse row adjacency from the edge list, for edges
+// in the forward direction or "reverse"d. The order of edges of each node is
+// the order in which they were discovered.
+TargetAdjacency MakeAdjacency(size_t node_count, const std::vector<Edge> &edges,
+                              bool reverse, std::vector<TargetId> keys) {
+  std::vector<uint32_t> offsets(node_count + 1, 0);
+  for (const auto &[from, to] : edges) {
+    ++offsets[(reverse ? to : from) + 1];
+  }
+  for (size_t i = 1; i <= node_count; ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+  std::vector<uint32_t> insert_pos(offsets.begin(), offsets.end() - 1);
+  std::vector<TargetId> adjacent(edges.size());
+  for (const auto &[from, to] : edges) {
+    const TargetId node = reverse ? to : from;
+    adjacent[insert_pos[node]++] = reverse ? from : to;
+  }
+  return {std::move(offsets), std::move(adjacent), std::move(keys)};
 }
 
 template <typename Container>
@@ -98,105 +293,202 @@ void PrintList(std::ostream &out, const char *msg, const Container &c) {
   out << "\n";
 }
 
-}  // namespace
-
-DependencyGraph BuildDependencyGraph(Session &session,
-                                     const BazelTargetMatcher &pattern,
-                                     int nesting_depth, ParsedProject *project,
-                                     const TargetInGraphCallback &walk_cb) {
+// Shared implementation of the public BuildDependencyGraph() variants. If
+// there is a "dependency_index", the initial targets come from the BUILD
+// files matching "initial_packages" instead of the packages already in the
+// project, and rules of unchanged BUILD files are taken from the index.
+DependencyGraph BuildGraph(Session &session, const BazelTargetMatcher &pattern,
+                           int nesting_depth, ParsedProject *project,
+                           const TargetInGraphCallback &walk_cb,
+                           const BazelPatternBundle *initial_packages,
+                           DependencyIndex *dependency_index) {
   // TODO: there will be some implicit dependencies: when using files, they
   // might not come from deps we mention, but are provided by genrules.
 
   // Follow all rules for now.
-  const std::initializer_list<std::string_view> kRulesOfInterest = {};
+  static constexpr query::RuleSet kRulesOfInterest{};
 
   std::set<BazelPackage> error_packages;
   std::set<BazelTarget> error_targets;
 
-  std::set<BazelTarget> deps_to_resolve_todo;
+  // While building, we only deal with interned ids of targets and collect
+  // the edges; the adjacency in both directions is assembled at the end.
+  DependencyGraph graph;
+  LabelTable &labels = graph.labels;
+  std::vector<bool> in_graph;
+  std::vector<Edge> edges;
+  auto make_room_for = [&](TargetId id) {
+    if (id >= in_graph.size()) in_graph.resize(id + 1);
+  };
+
+  absl::flat_hash_set<TargetId> deps_to_resolve_todo;
 
   Stat &stat = session.GetStatsFor("Dependency follow iterations", "rounds");
   const ScopedTimer timer(&stat.duration);
+  PackageLoader loader(session, labels, &error_packages, project,
+                       dependency_index);
 
   // Build the initial set of targets to follow from the pattern.
-  for (const auto &[_, parsed] : project->ParsedFiles()) {
-    const BazelPackage &current_package = parsed->package;
-    if (!pattern.Match(parsed->package)) continue;
-    query::FindTargets(parsed->ast, kRulesOfInterest,  //
-                       [&](const query::Result &result) {
-                         auto target_or =
-                           current_package.QualifiedTarget(result.name);
-                         if (!target_or || !pattern.Match(*target_or)) return;
-                         deps_to_resolve_todo.insert(*target_or);
-                       });
+  if (dependency_index) {
+    std::map<BazelPackage, PackageId> initial;
+    for (const auto &[package, build_file] :
+         project->FindBuildFiles(session, *initial_packages)) {
+      project->build_file_index().Remember(package, build_file);
+      initial.emplace(package, labels.Intern(package));
+    }
+    if (initial.empty()) {
+      session.error() << "Pattern did not match any dir with BUILD file.\n";
+    }
+    const bool elaborate = session.flags().elaborate;
+    for (const auto &[_, package_id] : initial) {
+      loader.Prefetch(package_id, elaborate);
+    }
+    for (const auto &[package, package_id] : initial) {
+      if (!pattern.Match(package)) continue;
+      const auto *rules = loader.GetRules(package_id, elaborate);
+      if (!rules) continue;
+      for (const DependencyIndex::Rule &rule : *rules) {
+        auto target_or = package.QualifiedTarget(rule.name);
+        if (!target_or || !pattern.Match(*target_or)) continue;
+        const TargetId id = labels.Intern(*target_or);
+        make_room_for(id);
+        deps_to_resolve_todo.insert(id);
+      }
+    }
+  } else {
+    for (const auto &[_, parsed] : project->ParsedFiles()) {
+      const BazelPackage &current_package = parsed->package;
+      if (!pattern.Match(parsed->package)) continue;
+      query::FindTargets(parsed->ast, kRulesOfInterest,
+                         {query::Attribute::kName},
+                         [&](const query::Result &result) {
+                           auto target_or =
+                             current_package.QualifiedTarget(result.name);
+                           if (!target_or || !pattern.Match(*target_or)) {
+                             return;
+                           }
+                           const TargetId id = labels.Intern(*target_or);
+                           make_room_for(id);
+                           deps_to_resolve_todo.insert(id);
+                         });
+    }
   }
 
-  DependencyGraph graph;
   do {
     ++stat.count;
+    // Dependencies found in this round are only followed if there is a next.
+    const bool has_next_round = (nesting_depth > 0);
 
     // Only need to look in a subset of packages requested by our target todo.
     // All these targets boil down to a set of packages that we need
     // to have available in the project (and possibly parse if not yet).
-    std::set<BazelPackage> scan_package;
-    for (const BazelTarget &t : deps_to_resolve_todo) {
-      scan_package.insert(t.package);
+    // Sorted, so that the order of processing is deterministic.
+    std::map<BazelPackage, PackageId> scan_package;
+    for (const TargetId t : deps_to_resolve_todo) {
+      const PackageId package_id = labels.package_id(t);
+      scan_package.emplace(labels.package(package_id), package_id);
     }
+    for (const auto &[_, package_id] : scan_package) {
+      loader.Prefetch(package_id);
+    }
+
+    absl::flat_hash_set<TargetId> next_round_deps_to_resolve_todo;
+
+    // Follow the dependencies of a rule found in a package we scan, if it is
+    // one of the targets we're looking for.
+    const auto visit_rule = [&](PackageId package_id, std::string_view name,
+                                const auto &to_follow,
+                                const query::Result *details) {
+      // Same name normalization as in BazelPackage::QualifiedTarget()
+      if (name.starts_with(':')) name.remove_prefix(1);
+      const auto target_id = labels.FindTarget(package_id, name);
+      if (!target_id.has_value()) return;  // Never referenced.
+      const bool interested = (deps_to_resolve_todo.erase(*target_id) == 1);
+      if (!interested) return;
+
+      if (walk_cb && details) {
+        walk_cb(labels.target(*target_id), *details);
+      }
+
+      in_graph[*target_id] = true;
+
+      for (const std::string_view dep : to_follow) {
+        auto dependency_or = labels.ParseAndIntern(dep, package_id);
+        if (!dependency_or.has_value()) continue;
+        const TargetId dependency_id = *dependency_or;
+        make_room_for(dependency_id);
 
-    // Make sure that we have parsed all packages we're looking through.
-    FindAndParseMissingPackages(session, scan_package, &error_packages,
-                                project);
+        // If this dependency is a target that we have not seen yet or will
+        // see in this round, put in the next todo.
+        if (!in_graph[dependency_id] &&
+            !deps_to_resolve_todo.contains(dependency_id) &&
+            next_round_deps_to_resolve_todo.insert(dependency_id).second &&
+            has_next_round) {
+          // Will need that package soon; start reading it right away.
+          loader.Prefetch(labels.package_id(dependency_id));
+        }
 
-    std::set<BazelTarget> next_round_deps_to_resolve_todo;
-    for (const BazelPackage &current_package : scan_package) {
-      const auto *parsed = project->FindParsedOrNull(current_package);
+        edges.emplace_back(*target_id, dependency_id);
+      }
+    };
+
+    for (const auto &[_, current_package_id] : scan_package) {
+      if (dependency_index) {
+        const auto *rules = loader.GetRules(current_package_id);
+        if (!rules) continue;
+        for (const DependencyIndex::Rule &rule : *rules) {
+          visit_rule(current_package_id, rule.name, rule.deps, nullptr);
+        }
+        continue;
+      }
+      const auto *parsed = loader.GetOrLoad(current_package_id);
       if (!parsed) continue;
-      query::FindTargets(
-        parsed->ast, kRulesOfInterest, [&](const query::Result &result) {
-          auto target_or = current_package.QualifiedTarget(result.name);
-          if (!target_or.has_value()) return;
-          const bool interested = (deps_to_resolve_todo.erase(*target_or) == 1);
-          if (!interested) return;
-
-          if (walk_cb) {
-            walk_cb(*target_or, result);
-          }
-
-          // The list to insert all the dependencies our current target has.
-          std::vector<BazelTarget> &depends_on =
-            graph.depends_on.insert({*target_or, {}}).first->second;
-
-          // Follow dependencies and alias references.
-          auto to_follow = query::ExtractStringList(result.deps_list);
-          if (!result.actual.empty()) {
-            to_follow.push_back(result.actual);
-          }
-
-          for (const auto dep : to_follow) {
-            auto dependency_or = BazelTarget::ParseFrom(dep, current_package);
-            if (!dependency_or.has_value()) continue;
-
-            // If this dependency is a target that we have not seen yet or will
-            // see in this round, put in the next todo.
-            if (!graph.depends_on.contains(*dependency_or) &&
-                !deps_to_resolve_todo.contains(*dependency_or)) {
-              next_round_deps_to_resolve_todo.insert(*dependency_or);
-            }
-
-            depends_on.push_back(*dependency_or);
-            // ... and the reverse
-            graph.has_dependents[*dependency_or].push_back(*target_or);
-          }
-        });
+      query::FindTargets(parsed->ast, kRulesOfInterest, query::kAllAttributes,
+                         [&](const query::Result &result) {
+                           // Follow dependencies and alias references.
+                           query::StringList to_follow;
+                           query::AppendStringList(result.deps_list,
+                                                   to_follow);
+                           if (!result.actual.empty()) {
+                             to_follow.push_back(result.actual);
+                           }
+                           visit_rule(current_package_id, result.name,
+                                      to_follow, &result);
+                         });
     }
 
     // Leftover dependencies that could not be resolved.
-    error_targets.insert(deps_to_resolve_todo.begin(),
-                         deps_to_resolve_todo.end());
+    for (const TargetId t : deps_to_resolve_todo) {
+      error_targets.insert(labels.target(t));
+    }
 
-    deps_to_resolve_todo = next_round_deps_to_resolve_todo;
+    deps_to_resolve_todo = std::move(next_round_deps_to_resolve_todo);
   } while (!deps_to_resolve_todo.empty() && (nesting_depth-- > 0));
 
+  // Assemble both directions; keys sorted by target for stable output.
+  const size_t node_count = labels.target_count();
+  in_graph.resize(node_count);
+  std::vector<bool> has_dependent(node_count);
+  for (const auto &[_, to] : edges) {
+    has_dependent[to] = true;
+  }
+  std::vector<TargetId> graph_keys;
+  std::vector<TargetId> dependent_keys;
+  for (TargetId id = 0; id < node_count; ++id) {
+    if (in_graph[id]) graph_keys.push_back(id);
+    if (has_dependent[id]) dependent_keys.push_back(id);
+  }
+  const auto by_target = [&labels](TargetId a, TargetId b) {
+    return labels.target(a) < labels.target(b);
+  };
+  std::sort(graph_keys.begin(), graph_keys.end(), by_target);
+  std::sort(dependent_keys.begin(), dependent_keys.end(), by_target);
+
+  graph.depends_on = MakeAdjacency(node_count, edges, /*reverse=*/false,
+                                   std::move(graph_keys));
+  graph.has_dependents = MakeAdjacency(node_count, edges, /*reverse=*/true,
+                                       std::move(dependent_keys));
+
   if (session.flags().verbose) {
     // Currently, we have a lot of targets that we don't deal with yet, such as
     // genrules or protobuffer rules. Goal: should be zero.
@@ -214,5 +506,22 @@ DependencyGraph BuildDependencyGraph(Session &session,
 
   return graph;
 }
+}  // namespace
+
+DependencyGraph BuildDependencyGraph(Session &session,
+                                     const BazelTargetMatcher &pattern,
+                                     int nesting_depth, ParsedProject *project,
+                                     const TargetInGraphCallback &walk_cb) {
+  return BuildGraph(session, pattern, nesting_depth, project, walk_cb,
+                    nullptr, nullptr);
+}
+
+DependencyGraph BuildDependencyGraph(Session &session,
+                                     const BazelPatternBundle &pattern,
+                                     int nesting_depth, ParsedProject *project,
+                                     DependencyIndex *index) {
+  return BuildGraph(session, pattern, nesting_depth, project, nullptr,
+                    &pattern, index);
+}
 
 }  // namespace bant
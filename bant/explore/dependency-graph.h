@@ -18,18 +18,60 @@
 #ifndef BANT_UTIL_RESOLVE_PACKAGES_
 #define BANT_UTIL_RESOLVE_PACKAGES_
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <span>
+#include <utility>
+#include <vector>
 
+#include "bant/explore/dependency-index.h"
 #include "bant/explore/query-utils.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/label-table.h"
 #include "bant/session.h"
 #include "bant/types-bazel.h"
-#include "bant/types.h"
 
 namespace bant {
+// One direction of edges in the dependency graph, in compressed sparse row
+// format: the edges of all nodes are stored consecutively in one array, the
+// ones of node n from offsets_[n] up to offsets_[n + 1].
+class TargetAdjacency {
+ public:
+  TargetAdjacency() = default;
+  TargetAdjacency(std::vector<uint32_t> offsets, std::vector<TargetId> edges,
+                  std::vector<TargetId> keys)
+      : offsets_(std::move(offsets)),
+        edges_(std::move(edges)),
+        keys_(std::move(keys)) {}
+
+  // Nodes that have an entry in this relation, sorted by their target.
+  const std::vector<TargetId> &keys() const { return keys_; }
+  size_t size() const { return keys_.size(); }
+
+  // Edges starting at the given node. Empty if there are none.
+  std::span<const TargetId> edges(TargetId node) const {
+    if (node + 1 >= offsets_.size()) return {};
+    return {edges_.data() + offsets_[node], edges_.data() + offsets_[node + 1]};
+  }
+
+  size_t edge_count() const { return edges_.size(); }
+
+ private:
+  std::vector<uint32_t> offsets_;
+  std::vector<TargetId> edges_;
+  std::vector<TargetId> keys_;
+};
+
+// The nodes in the graph are TargetIds in "labels".
 struct DependencyGraph {
-  OneToN<BazelTarget, BazelTarget> depends_on;
-  OneToN<BazelTarget, BazelTarget> has_dependents;
+  LabelTable labels;
+
+  // All targets in the graph, with the targets they depend on.
+  TargetAdjacency depends_on;
+
+  // Targets that are depended on, with the targets depending on them.
+  TargetAdjacency has_dependents;
 };
 
 // Build Dependency graph for all targets matching "pattern".
@@ -47,6 +89,15 @@ DependencyGraph BuildDependencyGraph(Session &session,
                                      const BazelTargetMatcher &pattern,
                                      int nesting_depth, ParsedProject *project,
                                      const TargetInGraphCallback &cb = nullptr);
+
+// Same, but starting from the BUILD files matching "pattern" found on the
+// filesystem, with the rules of BUILD files that did not change since taken
+// from "index"; only the others are parsed and added to "project". The index
+// is updated with these. Reports an error if no BUILD file matches.
+DependencyGraph BuildDependencyGraph(Session &session,
+                                     const BazelPatternBundle &pattern,
+                                     int nesting_depth, ParsedProject *project,
+                                     DependencyIndex *index);
 }  // namespace bant
 
 #endif  // BANT_UTIL_RESOLVE_PACKAGES_
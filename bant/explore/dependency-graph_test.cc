@@ -0,0 +1,131 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/dependency-graph.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "bant/frontend/parsed-project_testutil.h"
+#include "bant/label-table.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace bant {
+
+static BazelTarget T(std::string_view s) {
+  auto target_or = BazelTarget::ParseFrom(s, BazelPackage());
+  CHECK(target_or.has_value());
+  return *target_or;
+}
+
+static DependencyGraph BuildFor(ParsedProjectTestUtil &pp,
+                                std::string_view pattern_str) {
+  auto pattern = BazelPattern::ParseFrom(pattern_str);
+  CHECK(pattern.has_value());
+  Session session(&std::cerr, &std::cerr, CommandlineFlags{});
+  return BuildDependencyGraph(session, *pattern, 10, &pp.project());
+}
+
+// Targets in given adjacency as strings for easy comparison.
+static std::vector<std::string> Keys(const DependencyGraph &graph,
+                                     const TargetAdjacency &adjacency) {
+  std::vector<std::string> result;
+  for (const TargetId id : adjacency.keys()) {
+    result.push_back(graph.labels.ToString(id));
+  }
+  return result;
+}
+
+static std::vector<std::string> Edges(const DependencyGraph &graph,
+                                      const TargetAdjacency &adjacency,
+                                      std::string_view target) {
+  std::vector<std::string> result;
+  const auto id = graph.labels.FindTarget(T(target));
+  if (!id.has_value()) return result;
+  for (const TargetId edge : adjacency.edges(*id)) {
+    result.push_back(graph.labels.ToString(edge));
+  }
+  return result;
+}
+
+TEST(DependencyGraph, BuildBothDirections) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//a", R"(
+cc_library(
+  name = "a",
+  deps = [":b", "//c"],
+)
+cc_library(
+  name = "b",
+)
+cc_library(
+  name = "not-referenced",
+  deps = [":b"],
+)
+)");
+  pp.Add("//c", R"(
+cc_library(
+  name = "c",
+  deps = ["//a:b"],
+)
+)");
+
+  const DependencyGraph graph = BuildFor(pp, "//a:a");
+
+  EXPECT_THAT(Keys(graph, graph.depends_on),
+              ElementsAre("//a", "//a:b", "//c"));
+  EXPECT_THAT(Edges(graph, graph.depends_on, "//a:a"),
+              ElementsAre("//a:b", "//c"));
+  EXPECT_THAT(Edges(graph, graph.depends_on, "//a:b"), IsEmpty());
+  EXPECT_THAT(Edges(graph, graph.depends_on, "//c:c"), ElementsAre("//a:b"));
+  EXPECT_EQ(graph.depends_on.edge_count(), 3);
+
+  EXPECT_THAT(Keys(graph, graph.has_dependents), ElementsAre("//a:b", "//c"));
+  EXPECT_THAT(Edges(graph, graph.has_dependents, "//a:b"),
+              ElementsAre("//a", "//c"));
+  EXPECT_THAT(Edges(graph, graph.has_dependents, "//c:c"), ElementsAre("//a"));
+  EXPECT_THAT(Edges(graph, graph.has_dependents, "//a:a"), IsEmpty());
+  EXPECT_EQ(graph.has_dependents.edge_count(), 3);
+
+  // Never looked at as not reachable from the pattern.
+  EXPECT_FALSE(graph.labels.FindTarget(T("//a:not-referenced")).has_value());
+}
+
+TEST(DependencyGraph, DependencyNotInProjectOnlyInReverseDirection) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//a", R"(
+cc_library(
+  name = "a",
+  deps = ["@nonexistent//foo:bar"],
+)
+)");
+
+  const DependencyGraph graph = BuildFor(pp, "//a:a");
+  EXPECT_THAT(Keys(graph, graph.depends_on), ElementsAre("//a"));
+  EXPECT_THAT(Keys(graph, graph.has_dependents),
+              ElementsAre("@nonexistent//foo:bar"));
+}
+}  // namespace bant
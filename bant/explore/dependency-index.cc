@@ -0,0 +1,242 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/dependency-index.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/file-utils.h"
+
+namespace bant {
+namespace {
+// Bump if the format or what is extracted from BUILD files changes.
+constexpr std::string_view kFileHeader = "bant-dependency-index 4";
+
+// Modification time of a directory; changes if entries are added or removed.
+std::optional<int64_t> DirectoryMtime(const std::string &dir) {
+  auto stamp = GetFileStamp(FilesystemPath(dir));
+  if (!stamp.has_value()) return std::nullopt;
+  return stamp->mtime;
+}
+
+// Fingerprint of the custom flags, independent of their order.
+uint64_t CustomFlagsFingerprint(
+  const absl::flat_hash_set<std::string> &custom_flags) {
+  std::vector<std::string_view> sorted(custom_flags.begin(),
+                                       custom_flags.end());
+  std::sort(sorted.begin(), sorted.end());
+  uint64_t hash = kFingerprintInit;
+  for (const std::string_view flag : sorted) {
+    hash = Fingerprint(flag, hash);
+    hash = Fingerprint("\n", hash);
+  }
+  return hash;
+}
+}  // namespace
+
+DependencyIndex::DependencyIndex(
+  std::string file, const absl::flat_hash_set<std::string> &custom_flags)
+    : file_(std::move(file)),
+      custom_flags_fingerprint_(CustomFlagsFingerprint(custom_flags)) {
+  Load();
+}
+
+DependencyIndex::Key DependencyIndex::KeyFor(const FilesystemPath &build_file,
+                                             bool elaborated) const {
+  // Without elaboration, select()s are kept as they are.
+  return {build_file.path(), elaborated,
+          elaborated ? custom_flags_fingerprint_ : 0};
+}
+
+DependencyIndex::Lookup DependencyIndex::Find(const FilesystemPath &build_file,
+                                              bool elaborated) {
+  Lookup result;
+  const std::optional<FileStamp> stamp = GetFileStamp(build_file);
+  if (stamp.has_value()) result.stamp = *stamp;
+
+  Entry *entry = nullptr;
+  uint64_t fingerprint = 0;
+  bool stamp_unchanged = false;
+  std::vector<DirStamp> glob_dirs;
+  {
+    const std::lock_guard<std::mutex> l(lock_);
+    auto found = entries_.find(KeyFor(build_file, elaborated));
+    if (found != entries_.end()) {
+      entry = &found->second;
+      stamp_unchanged = stamp.has_value() && entry->stamp == *stamp;
+      fingerprint = entry->fingerprint;
+      glob_dirs = entry->glob_dirs;
+    }
+  }
+
+  // Even with the same BUILD file, glob() might now see different files.
+  for (const auto &[dir, mtime] : glob_dirs) {
+    if (DirectoryMtime(dir) != mtime) {
+      entry = nullptr;
+      break;
+    }
+  }
+
+  if (entry && stamp_unchanged) {
+    const std::lock_guard<std::mutex> l(lock_);
+    entry->used = true;
+    result.rules = &entry->rules;
+    return result;
+  }
+
+  // Touched, but possibly still the same content.
+  result.content = ReadFileToString(build_file);
+  if (entry && result.content.has_value() &&
+      Fingerprint(*result.content) == fingerprint) {
+    const std::lock_guard<std::mutex> l(lock_);
+    entry->stamp = result.stamp;
+    entry->used = true;
+    modified_ = true;
+    result.rules = &entry->rules;
+    result.content.reset();
+  }
+  return result;
+}
+
+const DependencyIndex::RuleList *DependencyIndex::Update(
+  const FilesystemPath &build_file, bool elaborated, FileStamp stamp,
+  uint64_t fingerprint, const std::vector<std::string> &glob_dirs,
+  RuleList rules) {
+  std::vector<DirStamp> glob_dir_stamps;
+  for (const std::string &dir : glob_dirs) {
+    const std::optional<int64_t> mtime = DirectoryMtime(dir);
+    if (!mtime.has_value()) continue;  // Gone now, so not listed next time.
+    glob_dir_stamps.emplace_back(dir, *mtime);
+  }
+  std::sort(glob_dir_stamps.begin(), glob_dir_stamps.end());
+  glob_dir_stamps.erase(
+    std::unique(glob_dir_stamps.begin(), glob_dir_stamps.end()),
+    glob_dir_stamps.end());
+
+  const std::lock_guard<std::mutex> l(lock_);
+  for (Rule &rule : rules) {
+    rule.name = updated_strings_.Keep(rule.name);
+    for (std::string_view &dep : rule.deps) dep = updated_strings_.Keep(dep);
+  }
+
+  Entry &entry = entries_[KeyFor(build_file, elaborated)];
+  entry.stamp = stamp;
+  entry.fingerprint = fingerprint;
+  entry.used = true;
+  entry.glob_dirs = std::move(glob_dir_stamps);
+  entry.rules = std::move(rules);
+  modified_ = true;
+  return &entry.rules;
+}
+
+void DependencyIndex::Load() {
+  // F <build-file> <inode> <size> <mtime> <fingerprint> <elaborated>
+  //   <custom-flags-fingerprint>
+  // G <glob-dir> <mtime>
+  // R <name> <dep>...
+  Entry *current = nullptr;
+  auto record = [&](std::span<const std::string_view> fields) {
+    if (fields[0] == "F" && fields.size() == 8) {
+      Entry entry;
+      uint64_t custom_flags = 0;
+      if (!ParseNumber(fields[2], &entry.stamp.inode) ||
+          !ParseNumber(fields[3], &entry.stamp.size) ||
+          !ParseNumber(fields[4], &entry.stamp.mtime) ||
+          !ParseNumber(fields[5], &entry.fingerprint, 16) ||
+          !ParseNumber(fields[7], &custom_flags, 16)) {
+        return false;
+      }
+      const bool elaborated = (fields[6] == "1");
+      Entry &stored =
+        entries_[{std::string(fields[1]), elaborated, custom_flags}];
+      current = &(stored = std::move(entry));
+      return true;
+    }
+    if (fields[0] == "G" && fields.size() == 3 && current) {
+      DirStamp &dir = current->glob_dirs.emplace_back(fields[1], 0);
+      return ParseNumber(fields[2], &dir.second);
+    }
+    if (fields[0] == "R" && fields.size() >= 2 && current) {
+      Rule &rule = current->rules.emplace_back();
+      rule.name = fields[1];
+      rule.deps.assign(fields.begin() + 2, fields.end());
+      return true;
+    }
+    return false;
+  };
+  // Rules point into the loaded content.
+  LoadCacheFile(file_, kFileHeader, &loaded_content_, &entries_, record);
+}
+
+bool DependencyIndex::Save() {
+  const std::lock_guard<std::mutex> l(lock_);
+  modified_ |= std::erase_if(entries_, [](const auto &entry) {
+    const auto &[key, value] = entry;
+    return !value.used && !FilesystemPath(std::get<0>(key)).can_read();
+  }) > 0;
+  if (!modified_) return true;  // Nothing to update.
+
+  CacheFileWriter out(file_, kFileHeader);
+  std::vector<std::string_view> fields;
+  for (const auto &[key, entry] : entries_) {
+    const auto &[build_file, elaborated, custom_flags] = key;
+    bool storable = CacheFileWriter::IsStorable(build_file);
+    for (const auto &[dir, _] : entry.glob_dirs) {
+      storable &= CacheFileWriter::IsStorable(dir);
+    }
+    for (const Rule &rule : entry.rules) {
+      storable &= CacheFileWriter::IsStorable(rule.name);
+      for (const std::string_view dep : rule.deps) {
+        storable &= CacheFileWriter::IsStorable(dep);
+      }
+    }
+    if (!storable) continue;  // Will be parsed next time.
+    out.Write({"F", build_file, absl::StrCat(entry.stamp.inode),
+               absl::StrCat(entry.stamp.size), absl::StrCat(entry.stamp.mtime),
+               absl::StrFormat("%x", entry.fingerprint), elaborated ? "1" : "0",
+               absl::StrFormat("%x", custom_flags)});
+    for (const auto &[dir, mtime] : entry.glob_dirs) {
+      out.Write({"G", dir, absl::StrCat(mtime)});
+    }
+    for (const Rule &rule : entry.rules) {
+      fields.assign({"R", rule.name});
+      fields.insert(fields.end(), rule.deps.begin(), rule.deps.end());
+      out.Write(fields);
+    }
+  }
+  if (!out.Commit()) return false;
+  modified_ = false;
+  return true;
+}
+
+std::optional<std::string> DependencyIndexCacheFile() {
+  return ProjectCacheFile("deps-index");
+}
+}  // namespace bant
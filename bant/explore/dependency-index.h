@@ -0,0 +1,137 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_EXPLORE_DEPENDENCY_INDEX_H
+#define BANT_EXPLORE_DEPENDENCY_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/file-utils.h"
+
+namespace bant {
+// Remembers per BUILD file the rules it defines and the labels each of them
+// depends on; all that is needed to build the dependency graph.
+//
+// Entries are checked against the FileStamp of the BUILD file and, if it
+// changed, against a Fingerprint() of its content. If glob()s were
+// elaborated, the directories they listed are checked for modification, as
+// files added or removed there can change the rules. Elaborated rules also
+// depend on the custom flags select()s were resolved with, so are kept per
+// set of these. Kept between runs, building the graph then only needs to
+// parse BUILD files that changed since, and only needs to read those that
+// were touched. (*.bzl files are not considered, as bant does not evaluate
+// them.)
+//
+// Find() is thread-safe; it can be called concurrently from multiple readers
+// and while the index is updated.
+class DependencyIndex {
+ public:
+  // Strings are owned by the index, or, before Update(), by the caller.
+  struct Rule {
+    std::string_view name;
+    std::vector<std::string_view> deps;  // As written; incl. alias 'actual'.
+  };
+  using RuleList = std::vector<Rule>;
+
+  // Result of looking up a BUILD file.
+  struct Lookup {
+    const RuleList *rules = nullptr;  // Set if the BUILD file is unchanged.
+
+    // Otherwise, the content and stamp of the file for a following Update().
+    std::optional<std::string> content;
+    FileStamp stamp;
+  };
+
+  // Index stored in "file". Starts out with its content if it exists and is
+  // readable. Elaborated rules are looked up and recorded for the given
+  // "custom_flags" (see CommandlineFlags::custom_flags) that decide which
+  // branch of a select() is taken.
+  explicit DependencyIndex(
+    std::string file,
+    const absl::flat_hash_set<std::string> &custom_flags = {});
+  DependencyIndex(const DependencyIndex &) = delete;
+
+  // The rules of "build_file", if it did not change since they were
+  // recorded with the same "elaborated" state. Otherwise, the content is read
+  // and returned.
+  Lookup Find(const FilesystemPath &build_file, bool elaborated);
+
+  // Record the rules of a BUILD file, extracted from the content with given
+  // "fingerprint" and "stamp" as returned by Find(). The "glob_dirs" are the
+  // directories elaboration listed to get these rules. Returns the stored list
+  // with copies of the strings owned by the index.
+  const RuleList *Update(const FilesystemPath &build_file, bool elaborated,
+                         FileStamp stamp, uint64_t fingerprint,
+                         const std::vector<std::string> &glob_dirs,
+                         RuleList rules);
+
+  // Write back the index if anything changed. Entries for BUILD files that
+  // don't exist anymore are dropped. Returns true on success.
+  bool Save();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  // Directory and its modification time.
+  using DirStamp = std::pair<std::string, int64_t>;
+
+  // BUILD file, elaborated state and, if elaborated, the fingerprint of the
+  // custom flags. Several of these can be needed in one run, or alternate
+  // between runs.
+  using Key = std::tuple<std::string, bool, uint64_t>;
+
+  struct Entry {
+    FileStamp stamp;
+    uint64_t fingerprint = 0;
+    bool used = false;  // Looked up or updated in this run.
+    std::vector<DirStamp> glob_dirs;
+    RuleList rules;
+  };
+
+  Key KeyFor(const FilesystemPath &build_file, bool elaborated) const;
+  void Load();
+
+  const std::string file_;
+  const uint64_t custom_flags_fingerprint_;
+  std::mutex lock_;
+
+  // Backing store for the strings in the rules: the content loaded from the
+  // file, and the strings of each Update().
+  std::string loaded_content_;
+  StringStore updated_strings_;
+
+  // Node-based map: references to entries stay stable.
+  std::map<Key, Entry> entries_;
+  bool modified_ = false;
+};
+
+// If the user created a ~/.cache/bant directory, the file to keep the index
+// of the project in the current directory in; nullopt otherwise.
+std::optional<std::string> DependencyIndexCacheFile();
+}  // namespace bant
+
+#endif  // BANT_EXPLORE_DEPENDENCY_INDEX_H
@@ -0,0 +1,297 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/dependency-index.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/check.h"
+#include "bant/explore/dependency-graph.h"
+#include "bant/frontend/parsed-project.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/file-utils.h"
+#include "bant/workspace.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::UnorderedElementsAre;
+
+namespace bant {
+namespace {
+std::vector<std::string> RuleNames(const DependencyIndex::RuleList *rules) {
+  std::vector<std::string> result;
+  if (!rules) return result;
+  for (const auto &rule : *rules) result.emplace_back(rule.name);
+  return result;
+}
+
+void SetModificationTime(const std::string &file, time_t t) {
+  const struct utimbuf times = {.actime = t, .modtime = t};
+  CHECK(utime(file.c_str(), &times) == 0);
+}
+}  // namespace
+
+TEST(DependencyIndex, FindUpdateSaveAndLoad) {
+  const std::string dir = ::testing::TempDir() + "/dependency-index";
+  mkdir(dir.c_str(), 0755);
+  const std::string index_file = dir + "/index";
+  unlink(index_file.c_str());  // Possibly left from previous run.
+  const FilesystemPath build_file(dir + "/BUILD");
+  std::ofstream(build_file.path()) << "cc_library(name = 'foo')\n";
+  SetModificationTime(build_file.path(), 1000);
+
+  {
+    DependencyIndex index(index_file);
+    DependencyIndex::Lookup lookup = index.Find(build_file, false);
+    EXPECT_EQ(lookup.rules, nullptr);  // Not known yet.
+    ASSERT_TRUE(lookup.content.has_value());
+    DependencyIndex::RuleList rules = {{.name = "foo", .deps = {":bar"}}};
+    index.Update(build_file, false, lookup.stamp,
+                 Fingerprint(*lookup.content), {}, rules);
+
+    lookup = index.Find(build_file, false);
+    EXPECT_THAT(RuleNames(lookup.rules), ElementsAre("foo"));
+    EXPECT_FALSE(lookup.content.has_value());  // Didn't need to read.
+
+    // Extracted differently if elaborated, so that is not the same.
+    EXPECT_EQ(index.Find(build_file, true).rules, nullptr);
+    EXPECT_TRUE(index.Save());
+  }
+
+  {
+    DependencyIndex index(index_file);
+    const DependencyIndex::Lookup lookup = index.Find(build_file, false);
+    EXPECT_THAT(RuleNames(lookup.rules), ElementsAre("foo"));
+    ASSERT_EQ(lookup.rules->size(), 1);
+    EXPECT_THAT((*lookup.rules)[0].deps, ElementsAre(":bar"));
+  }
+
+  // Touched, but same content: still good.
+  SetModificationTime(build_file.path(), 2000);
+  {
+    DependencyIndex index(index_file);
+    EXPECT_THAT(RuleNames(index.Find(build_file, false).rules),
+                ElementsAre("foo"));
+  }
+
+  // Actually changed.
+  std::ofstream(build_file.path()) << "cc_library(name = 'baz')\n";
+  {
+    DependencyIndex index(index_file);
+    const DependencyIndex::Lookup lookup = index.Find(build_file, false);
+    EXPECT_EQ(lookup.rules, nullptr);
+    EXPECT_EQ(lookup.content, "cc_library(name = 'baz')\n");
+  }
+}
+
+TEST(DependencyIndex, GraphOnlyParsesChangedBuildFiles) {
+  const std::string root = ::testing::TempDir() + "/dependency-index-graph";
+  mkdir(root.c_str(), 0755);
+  mkdir((root + "/foo").c_str(), 0755);
+  mkdir((root + "/bar").c_str(), 0755);
+  const std::string index_file = root + "/index";
+  unlink(index_file.c_str());
+  std::ofstream(root + "/foo/BUILD")
+    << "cc_library(name = 'a', deps = ['//bar:b'])\n";
+  std::ofstream(root + "/bar/BUILD") << "cc_library(name = 'b')\n";
+
+  BazelWorkspace workspace;
+  workspace.project_location[{.project = "ext", .version = ""}] =
+    FilesystemPath(root);
+  BazelPatternBundle pattern;
+  pattern.AddPattern(*BazelPattern::ParseFrom("@ext//..."));
+  pattern.Finish();
+
+  // Returns the edges as strings and how many BUILD files were parsed.
+  auto build_graph = [&](int *parsed_count) {
+    Session session(&std::cerr, &std::cerr, CommandlineFlags{});
+    ParsedProject project(workspace, false);
+    DependencyIndex index(index_file);
+    const DependencyGraph graph =
+      BuildDependencyGraph(session, pattern, 10, &project, &index);
+    CHECK(index.Save());
+    *parsed_count = project.ParsedFiles().size();
+    std::vector<std::string> result;
+    for (const TargetId id : graph.depends_on.keys()) {
+      for (const TargetId dep : graph.depends_on.edges(id)) {
+        result.push_back(graph.labels.ToString(id) + " -> " +
+                         graph.labels.ToString(dep));
+      }
+    }
+    return result;
+  };
+
+  int parsed = 0;
+  EXPECT_THAT(build_graph(&parsed), ElementsAre("@ext//foo:a -> @ext//bar:b"));
+  EXPECT_EQ(parsed, 2);
+
+  EXPECT_THAT(build_graph(&parsed), ElementsAre("@ext//foo:a -> @ext//bar:b"));
+  EXPECT_EQ(parsed, 0);  // All from the index.
+
+  std::ofstream(root + "/bar/BUILD")
+    << "cc_library(name = 'b', deps = [':c'])\ncc_library(name = 'c')\n";
+  EXPECT_THAT(build_graph(&parsed), ElementsAre("@ext//bar:b -> @ext//bar:c",
+                                                "@ext//foo:a -> @ext//bar:b"));
+  EXPECT_EQ(parsed, 1);
+}
+
+TEST(DependencyIndex, GlobbedDirectoryChangeInvalidatesEntry) {
+  const std::string root = ::testing::TempDir() + "/dependency-index-glob";
+  mkdir(root.c_str(), 0755);
+  mkdir((root + "/foo").c_str(), 0755);
+  const std::string index_file = root + "/index";
+  unlink(index_file.c_str());
+  unlink((root + "/foo/two.dep").c_str());
+  std::ofstream(root + "/foo/BUILD")
+    << "cc_library(name = 'a', deps = glob(['*.dep']))\n";
+  std::ofstream(root + "/foo/one.dep") << "";
+  SetModificationTime(root + "/foo", 1000);
+
+  BazelWorkspace workspace;
+  workspace.project_location[{.project = "ext", .version = ""}] =
+    FilesystemPath(root);
+  BazelPatternBundle pattern;
+  pattern.AddPattern(*BazelPattern::ParseFrom("@ext//foo:a"));
+  pattern.Finish();
+
+  auto build_graph = [&](int *parsed_count) {
+    CommandlineFlags flags;
+    flags.elaborate = true;
+    Session session(&std::cerr, &std::cerr, flags);
+    ParsedProject project(workspace, false);
+    DependencyIndex index(index_file);
+    const DependencyGraph graph =
+      BuildDependencyGraph(session, pattern, 0, &project, &index);
+    CHECK(index.Save());
+    *parsed_count = project.ParsedFiles().size();
+    std::vector<std::string> result;
+    CHECK_EQ(graph.depends_on.keys().size(), 1);
+    for (const TargetId dep :
+         graph.depends_on.edges(graph.depends_on.keys().front())) {
+      result.push_back(graph.labels.ToString(dep));
+    }
+    return result;
+  };
+
+  int parsed = 0;
+  EXPECT_THAT(build_graph(&parsed), ElementsAre("@ext//foo:one.dep"));
+  EXPECT_EQ(parsed, 1);
+
+  EXPECT_THAT(build_graph(&parsed), ElementsAre("@ext//foo:one.dep"));
+  EXPECT_EQ(parsed, 0);
+
+  // Same BUILD file, but glob() would now see a different directory.
+  std::ofstream(root + "/foo/two.dep") << "";
+  EXPECT_THAT(build_graph(&parsed),
+              UnorderedElementsAre("@ext//foo:one.dep", "@ext//foo:two.dep"));
+  EXPECT_EQ(parsed, 1);
+}
+
+TEST(DependencyIndex, ElaboratedRulesAreKeptPerCustomFlags) {
+  const std::string root = ::testing::TempDir() + "/dependency-index-select";
+  mkdir(root.c_str(), 0755);
+  mkdir((root + "/a").c_str(), 0755);
+  const std::string index_file = root + "/index";
+  unlink(index_file.c_str());
+  std::ofstream(root + "/a/BUILD") << R"(
+cc_library(
+  name = "a",
+  deps = select({
+    "//cfg:foo": ["//b:b"],
+    "//conditions:default": ["//c:c"],
+  }),
+))";
+
+  BazelWorkspace workspace;
+  workspace.project_location[{.project = "ext", .version = ""}] =
+    FilesystemPath(root);
+  BazelPatternBundle pattern;
+  pattern.AddPattern(*BazelPattern::ParseFrom("@ext//a:a"));
+  pattern.Finish();
+
+  auto build_graph = [&](const absl::flat_hash_set<std::string> &custom_flags,
+                         int *parsed_count) {
+    CommandlineFlags flags;
+    flags.elaborate = true;
+    flags.custom_flags = custom_flags;
+    Session session(&std::cerr, &std::cerr, flags);
+    ParsedProject project(workspace, false);
+    DependencyIndex index(index_file, custom_flags);
+    const DependencyGraph graph =
+      BuildDependencyGraph(session, pattern, 0, &project, &index);
+    CHECK(index.Save());
+    *parsed_count = project.ParsedFiles().size();
+    std::vector<std::string> result;
+    CHECK_EQ(graph.depends_on.keys().size(), 1);
+    for (const TargetId dep :
+         graph.depends_on.edges(graph.depends_on.keys().front())) {
+      result.push_back(graph.labels.ToString(dep));
+    }
+    return result;
+  };
+
+  int parsed = 0;
+  EXPECT_THAT(build_graph({}, &parsed), ElementsAre("@ext//c"));
+  EXPECT_EQ(parsed, 1);
+
+  // Other flags: select() resolves differently, so not taken from the index.
+  EXPECT_THAT(build_graph({"//cfg:foo"}, &parsed), ElementsAre("@ext//b"));
+  EXPECT_EQ(parsed, 1);
+
+  // Both are kept.
+  EXPECT_THAT(build_graph({}, &parsed), ElementsAre("@ext//c"));
+  EXPECT_EQ(parsed, 0);
+  EXPECT_THAT(build_graph({"//cfg:foo"}, &parsed), ElementsAre("@ext//b"));
+  EXPECT_EQ(parsed, 0);
+}
+
+TEST(DependencyIndex, PatternWithoutBuildFileIsReported) {
+  const std::string root = ::testing::TempDir() + "/dependency-index-none";
+  mkdir(root.c_str(), 0755);
+  const std::string index_file = root + "/index";
+
+  BazelWorkspace workspace;
+  workspace.project_location[{.project = "ext", .version = ""}] =
+    FilesystemPath(root);
+  BazelPatternBundle pattern;
+  pattern.AddPattern(*BazelPattern::ParseFrom("@ext//nonexist/..."));
+  pattern.Finish();
+
+  std::stringstream out;
+  Session session(&out, &out, CommandlineFlags{});
+  ParsedProject project(workspace, false);
+  DependencyIndex index(index_file);
+  const DependencyGraph graph =
+    BuildDependencyGraph(session, pattern, 0, &project, &index);
+  EXPECT_EQ(graph.depends_on.size(), 0);
+  EXPECT_THAT(out.str(),
+              HasSubstr("Pattern did not match any dir with BUILD file."));
+}
+}  // namespace bant
@@ -0,0 +1,143 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/dependents-prefilter.h"
+
+#include <cstddef>
+#include <cstring>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "bant/frontend/parsed-project.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+#include "bant/util/file-utils.h"
+#include "bant/util/stat.h"
+#include "bant/util/thread-pool.h"
+
+namespace bant {
+namespace {
+// memmem() is typically vectorized by the libc, much faster than a naive
+// search for the short needles we have.
+bool Contains(std::string_view haystack, std::string_view needle) {
+  if (needle.empty()) return true;
+  return memmem(haystack.data(), haystack.size(),  //
+                needle.data(), needle.size()) != nullptr;
+}
+}  // namespace
+
+DependentsPrefilter::DependentsPrefilter(const BazelPatternBundle &targets) {
+  for (const BazelPattern &pattern : targets.patterns()) {
+    if (pattern.project().empty() && pattern.path().empty() &&
+        pattern.target_name().empty()) {
+      has_filter_ = false;  // Pattern like //... or //:all; could be anything
+    }
+    fragments_.push_back({pattern, pattern.project(), pattern.path(),
+                          pattern.target_name()});
+  }
+  if (fragments_.empty()) has_filter_ = false;
+}
+
+bool DependentsPrefilter::OnlyMainProjectTargets() const {
+  for (const Fragments &f : fragments_) {
+    if (!f.project.empty()) return false;
+  }
+  return true;
+}
+
+bool DependentsPrefilter::MightReference(const BazelPackage &package,
+                                         std::string_view content) const {
+  if (!has_filter_) return true;
+  for (const Fragments &f : fragments_) {
+    if (!Contains(content, f.target_name)) continue;
+    if (f.pattern.Match(package)) return true;  // ':name' suffices
+    if (package.project != f.project && !Contains(content, f.project)) {
+      continue;
+    }
+    if (Contains(content, f.path)) return true;
+  }
+  return false;
+}
+
+int FillWithPossibleDependents(Session &session,
+                               const BazelPatternBundle &search,
+                               const DependentsPrefilter &prefilter,
+                               ParsedProject *project) {
+  if (!prefilter.HasFilter()) {
+    return project->FillFromPattern(session, search);
+  }
+
+  Stat &fread_stat = session.GetStatsFor("read(BUILD)      ", "BUILD files");
+  Stat &skip_stat =
+    session.GetStatsFor("  - not referencing target", "BUILD files");
+
+  struct ScanResult {
+    std::optional<std::string> content;  // Only set if candidate.
+    size_t size = 0;
+    absl::Duration filter_duration;
+    bool readable = false;
+  };
+
+  const auto build_files = project->FindBuildFiles(session, search);
+  std::vector<std::future<ScanResult>> scans;
+  scans.reserve(build_files.size());
+  {
+    const ScopedTimer timer(&fread_stat.duration);
+    ThreadPool pool(kFileReadParallelism);
+    for (const auto &[package, build_file] : build_files) {
+      project->build_file_index().Remember(package, build_file);
+      scans.push_back(pool.ExecAsync([&prefilter, &package, &build_file]() {
+        ScanResult result;
+        std::optional<std::string> content = ReadFileToString(build_file);
+        if (!content.has_value()) return result;
+        result.readable = true;
+        result.size = content->size();
+        bool candidate;
+        {
+          const ScopedTimer timer(&result.filter_duration);
+          candidate = prefilter.MightReference(package, *content);
+        }
+        if (candidate) result.content = std::move(content);
+        return result;
+      }));
+    }
+    for (auto &scan : scans) scan.wait();
+  }
+
+  for (size_t i = 0; i < build_files.size(); ++i) {
+    const auto &[package, build_file] = build_files[i];
+    ScanResult scanned = scans[i].get();
+    ++fread_stat.count;
+    if (scanned.readable && !scanned.content.has_value()) {
+      ++skip_stat.count;
+      skip_stat.duration += scanned.filter_duration;
+      skip_stat.AddBytesProcessed(scanned.size);
+      fread_stat.AddBytesProcessed(scanned.size);
+      continue;
+    }
+    // Unreadable files are passed on for the usual error reporting.
+    project->AddBuildFile(session, build_file, package,
+                          std::move(scanned.content));
+  }
+  return build_files.size();
+}
+}  // namespace bant
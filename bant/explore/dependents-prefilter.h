@@ -0,0 +1,80 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_EXPLORE_DEPENDENTS_PREFILTER_
+#define BANT_EXPLORE_DEPENDENTS_PREFILTER_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bant/frontend/parsed-project.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+
+namespace bant {
+// Cheap textual test if a BUILD file could reference any target matching
+// the given patterns, before going through the expense of parsing it.
+//
+// A reference to //foo/bar:baz from another package has to spell out the
+// package path "foo/bar" and, for a specific target, its name "baz"; within
+// the package, ":baz" or "baz" still contains the name. So a file that does
+// not contain these fragments can't depend on the target. There might be
+// false positives, but no false negatives (unless a label is assembled from
+// pieces smaller than path and name).
+class DependentsPrefilter {
+ public:
+  explicit DependentsPrefilter(const BazelPatternBundle &targets);
+
+  // Returns false if there is no fragment to look for, e.g. for //...; any
+  // file might then reference matching targets.
+  bool HasFilter() const { return has_filter_; }
+
+  // Returns true if all targets are in the main project. External projects
+  // don't depend on the main project, so all dependents are then found in
+  // the BUILD files of the main project.
+  bool OnlyMainProjectTargets() const;
+
+  // Could "content" of the BUILD file defining "package" reference any of
+  // the targets ?
+  bool MightReference(const BazelPackage &package,
+                      std::string_view content) const;
+
+ private:
+  struct Fragments {
+    BazelPattern pattern;     // To check if package is covered by pattern.
+    std::string project;      // Needs to be mentioned from other projects.
+    std::string path;         // Needs to be mentioned from other packages.
+    std::string target_name;  // Always needs to be mentioned if non-empty.
+  };
+  std::vector<Fragments> fragments_;
+  bool has_filter_ = true;
+};
+
+// Fill "project" with the BUILD files matching "search" that could contain
+// dependents according to the "prefilter". All files
+// are read, but only the candidates are parsed. Other packages found are
+// remembered in the BuildFileIndex so that they don't have to be searched
+// for again if needed later.
+// Returns number of build files found (parsed or not).
+int FillWithPossibleDependents(Session &session,
+                               const BazelPatternBundle &search,
+                               const DependentsPrefilter &prefilter,
+                               ParsedProject *project);
+}  // namespace bant
+
+#endif  // BANT_EXPLORE_DEPENDENTS_PREFILTER_
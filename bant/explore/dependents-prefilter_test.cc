@@ -0,0 +1,96 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/dependents-prefilter.h"
+
+#include <initializer_list>
+#include <string_view>
+
+#include "bant/types-bazel.h"
+#include "gtest/gtest.h"
+
+namespace bant {
+static BazelPatternBundle MakeBundle(std::initializer_list<const char *> p) {
+  BazelPatternBundle result;
+  for (const char *pattern : p) {
+    result.AddPattern(*BazelPattern::ParseFrom(pattern));
+  }
+  result.Finish();
+  return result;
+}
+
+TEST(DependentsPrefilter, ExactTargetNeedsNameAndPath) {
+  const DependentsPrefilter filter(MakeBundle({"//foo/bar:baz"}));
+  ASSERT_TRUE(filter.HasFilter());
+  const BazelPackage other("", "other");
+  EXPECT_TRUE(filter.MightReference(other, R"(deps = ["//foo/bar:baz"])"));
+  EXPECT_TRUE(filter.MightReference(other, R"(deps = ["@//foo/bar:baz"])"));
+  EXPECT_FALSE(filter.MightReference(other, R"(deps = [":baz"])"));
+  EXPECT_FALSE(filter.MightReference(other, R"(deps = ["//foo/bar:qux"])"));
+  EXPECT_FALSE(filter.MightReference(other, ""));
+}
+
+TEST(DependentsPrefilter, SamePackageOnlyNeedsName) {
+  const DependentsPrefilter filter(MakeBundle({"//foo/bar:baz"}));
+  const BazelPackage same("", "foo/bar");
+  EXPECT_TRUE(filter.MightReference(same, R"(deps = [":baz"])"));
+  EXPECT_TRUE(filter.MightReference(same, R"(deps = ["baz"])"));
+  EXPECT_FALSE(filter.MightReference(same, R"(deps = [":qux"])"));
+}
+
+TEST(DependentsPrefilter, PackageDefaultTargetShorthand) {
+  const DependentsPrefilter filter(MakeBundle({"//foo/bar"}));
+  EXPECT_TRUE(filter.MightReference(BazelPackage("", "x"), R"(["//foo/bar"])"));
+}
+
+TEST(DependentsPrefilter, ExternalProjectNeedsToBeMentioned) {
+  const DependentsPrefilter filter(MakeBundle({"@ext//foo:baz"}));
+  EXPECT_TRUE(filter.MightReference(BazelPackage("", "x"),  //
+                                    R"(["@ext//foo:baz"])"));
+  EXPECT_FALSE(filter.MightReference(BazelPackage("", "x"),  //
+                                     R"(["//foo:baz"])"));
+  // Within the external project itself, the project is implicit.
+  EXPECT_TRUE(filter.MightReference(BazelPackage("@ext", "x"),  //
+                                    R"(["//foo:baz"])"));
+}
+
+TEST(DependentsPrefilter, AllTargetsInPackageOnlyNeedsPath) {
+  const DependentsPrefilter filter(MakeBundle({"//foo/bar:all"}));
+  ASSERT_TRUE(filter.HasFilter());
+  EXPECT_TRUE(filter.MightReference(BazelPackage("", "x"),  //
+                                    R"(["//foo/bar:anything"])"));
+  EXPECT_FALSE(filter.MightReference(BazelPackage("", "x"),  //
+                                     R"(["//foo/baz:anything"])"));
+  EXPECT_TRUE(filter.MightReference(BazelPackage("", "foo/bar"),  //
+                                    R"([":anything"])"));
+}
+
+TEST(DependentsPrefilter, AnyOfMultiplePatterns) {
+  const DependentsPrefilter filter(MakeBundle({"//a:x", "//b:y"}));
+  const BazelPackage other("", "other");
+  EXPECT_TRUE(filter.MightReference(other, R"(["//a:x"])"));
+  EXPECT_TRUE(filter.MightReference(other, R"(["//b:y"])"));
+  EXPECT_FALSE(filter.MightReference(other, R"(["//a:y"])"));
+}
+
+TEST(DependentsPrefilter, NoFilterForMatchEverything) {
+  EXPECT_FALSE(DependentsPrefilter(MakeBundle({"//..."})).HasFilter());
+  EXPECT_FALSE(DependentsPrefilter(MakeBundle({})).HasFilter());
+  EXPECT_FALSE(
+    DependentsPrefilter(MakeBundle({"//a:x", "//:all"})).HasFilter());
+}
+}  // namespace bant
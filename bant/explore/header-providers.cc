@@ -19,16 +19,20 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <initializer_list>
-#include <iterator>
+#include <memory>
 #include <optional>
 #include <ostream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
 #include "bant/explore/aliased-by.h"
 #include "bant/explore/query-utils.h"
@@ -80,12 +84,6 @@ static std::string_view LightCanonicalizePath(std::string_view path) {
   return path;
 }
 
-// Convert to format needed for suffix matching.
-static std::string KeyTransform(std::string_view in, bool suffix_index) {
-  return suffix_index ? std::string{in.rbegin(), in.rend()}.append("/")
-                      : std::string{in};
-}
-
 // Strip a "file_path" if it starts with the optional "strip_prefix", otherwise
 // return as-is.
 static std::string_view StripIfNeeded(std::string_view file_path,
@@ -112,18 +110,27 @@ static void IterateCCLibraryHeaders(const ParsedBuildFile &build_file,
   // Unfortunately, grpc does not simply have a cc_library(), but its own
   // rule or macro, making it invisible if we just look at cc_library.
   // Hacking it up here to look also for the grpc version.
-  static const std::initializer_list<std::string_view> kInterestingLibRules{
+  static constexpr query::RuleSet kInterestingLibRules{
     "cc_library",
     "grpc_cc_library",
   };
 
+  static constexpr query::AttributeMask kHeaderAttributes{
+    query::Attribute::kName,          query::Attribute::kHdrs,
+    query::Attribute::kTextualHdrs,   query::Attribute::kPublicHdrs,
+    query::Attribute::kIncludePrefix, query::Attribute::kStripIncludePrefix,
+    query::Attribute::kIncludes,
+  };
+
   query::FindTargets(
-    build_file.ast, kInterestingLibRules, [&](const query::Result &cc_lib) {
+    build_file.ast, kInterestingLibRules, kHeaderAttributes,
+    [&](const query::Result &cc_lib) {
       auto cc_library = build_file.package.QualifiedTarget(cc_lib.name);
       if (!cc_library.has_value()) return;
 
-      auto hdrs = query::ExtractStringList(cc_lib.hdrs_list);
-      const auto textual_hdrs = query::ExtractStringList(cc_lib.textual_hdrs);
+      query::StringList hdrs;
+      query::AppendStringList(cc_lib.hdrs_list, hdrs);
+      const query::StringListView textual_hdrs(cc_lib.textual_hdrs);
 
       // ABSL HACK...
       // In absl/strings:string_view, there is the string_view.h exported.
@@ -144,7 +151,7 @@ static void IterateCCLibraryHeaders(const ParsedBuildFile &build_file,
                     "string_view.h") != textual_hdrs.end();
       }
 
-      hdrs.insert(hdrs.end(), textual_hdrs.begin(), textual_hdrs.end());
+      query::AppendStringList(cc_lib.textual_hdrs, hdrs);
       query::AppendStringList(cc_lib.public_hdrs, hdrs);  // grpc hack.
       for (const std::string_view header : hdrs) {
         if (absl_string_view_skip && header == "string_view.h") continue;
@@ -167,8 +174,8 @@ static void IterateCCLibraryHeaders(const ParsedBuildFile &build_file,
         // TODO: double check that the following is what incdirs is supposed to
         // do. Looks like it works for zlib.
         // Could also show up under shorter path with -I
-        const auto incdirs = query::ExtractStringList(cc_lib.includes_list);
-        for (const std::string_view dir : incdirs) {
+        for (const std::string_view dir :
+             query::StringListView(cc_lib.includes_list)) {
           std::string prefix(dir);
           if (!prefix.ends_with('/')) {
             prefix.append("/");
@@ -200,13 +207,13 @@ static void InsertLibAndAliasesToTargetSet(
 static void AppendCCLibraryHeaders(
   const ParsedBuildFile &build_file,
   const OneToN<BazelTarget, BazelTarget> &alias_index, std::ostream &info_out,
-  bool suffix_index, ProvidedFromTargetSet &result) {
+  ProvidedFromTargetSet &result) {
   IterateCCLibraryHeaders(
     build_file, [&](const BazelTarget &cc_library, std::string_view hdr_loc,
                     std::string_view header_fqn) {
       const std::string_view canonicalized = LightCanonicalizePath(header_fqn);
-      const std::string key = KeyTransform(canonicalized, suffix_index);
-      InsertLibAndAliasesToTargetSet(key, cc_library, alias_index, result);
+      InsertLibAndAliasesToTargetSet(std::string(canonicalized), cc_library,
+                                     alias_index, result);
     });
 }
 
@@ -224,13 +231,13 @@ static void AppendCCLibraryHeaders(
 //     header->cc_library that we're after.
 static void AppendProtoLibraryHeaders(
   const ParsedBuildFile &build_file,
-  const OneToN<BazelTarget, BazelTarget> &alias_index, bool reverse,
+  const OneToN<BazelTarget, BazelTarget> &alias_index,
   ProvidedFromTargetSet &result) {
   // TODO: once we wire the DependencyGraph through, we can make the look-up
   // in one go. Also we wouldn't be limited to proto_library() and
   // cc_proto_library() having to reside in one package.
 
-  static const std::initializer_list<std::string_view> kInterestingLibRules{
+  static constexpr query::RuleSet kInterestingLibRules{
     "cc_proto_library",
     "cc_grpc_library",
   };
@@ -241,16 +248,17 @@ static void AppendProtoLibraryHeaders(
   // We have two of these: one regular (index:false), one for grpc(index:true)
   OneToOne<BazelTarget, BazelTarget> proto_lib2cc_proto_lib[2];
   query::FindTargets(
-    build_file.ast, kInterestingLibRules, [&](const query::Result &cc_plib) {
+    build_file.ast, kInterestingLibRules,
+    {query::Attribute::kName, query::Attribute::kSrcs, query::Attribute::kDeps},
+    [&](const query::Result &cc_plib) {
       auto target = build_file.package.QualifiedTarget(cc_plib.name);
       if (!target.has_value()) return;
 
       const bool is_grpc = (cc_plib.rule == "cc_grpc_library");
 
       // cc_proto_library has deps in deps, cc_grpc_library in srcs.
-      auto cc_proto_deps = is_grpc
-                             ? query::ExtractStringList(cc_plib.srcs_list)
-                             : query::ExtractStringList(cc_plib.deps_list);
+      const query::StringListView cc_proto_deps(is_grpc ? cc_plib.srcs_list
+                                                        : cc_plib.deps_list);
 
       for (const std::string_view dep : cc_proto_deps) {
         auto proto_library = BazelTarget::ParseFrom(dep, build_file.package);
@@ -264,8 +272,12 @@ static void AppendProtoLibraryHeaders(
   // which are only known to proto_library()s.
   // Looking at the proto_library(), we can derive the header from the *.proto.
   // Putting it all together.
+  static constexpr query::RuleSet kProtoLibRule{"proto_library"};
   query::FindTargets(
-    build_file.ast, {"proto_library"}, [&](const query::Result &proto_lib) {
+    build_file.ast, kProtoLibRule,
+    {query::Attribute::kName, query::Attribute::kSrcs,
+     query::Attribute::kStripImportPrefix},
+    [&](const query::Result &proto_lib) {
       auto target = build_file.package.QualifiedTarget(proto_lib.name);
       if (!target.has_value()) return;
 
@@ -284,8 +296,8 @@ static void AppendProtoLibraryHeaders(
 
         // Now, look through all *.proto files this proto_library() gets,
         // assemble the header filename from it and record in our result.
-        const auto proto_srcs = query::ExtractStringList(proto_lib.srcs_list);
-        for (std::string_view proto : proto_srcs) {
+        for (std::string_view proto :
+             query::StringListView(proto_lib.srcs_list)) {
           if (!proto.ends_with(".proto")) {
             // possibly file list. Not handling that yet.
             continue;
@@ -305,9 +317,8 @@ static void AppendProtoLibraryHeaders(
             // for proto_library().
             const std::string_view maybe_stripped =
               StripIfNeeded(proto_header, proto_lib.strip_import_prefix);
-            const std::string key = KeyTransform(maybe_stripped, reverse);
-            InsertLibAndAliasesToTargetSet(key, cc_proto_lib, alias_index,
-                                           result);
+            InsertLibAndAliasesToTargetSet(std::string(maybe_stripped),
+                                           cc_proto_lib, alias_index, result);
           }
         }
       }
@@ -316,8 +327,7 @@ static void AppendProtoLibraryHeaders(
 }  // namespace
 
 ProvidedFromTargetSet ExtractHeaderToLibMapping(const ParsedProject &project,
-                                                std::ostream &info_out,
-                                                bool suffix_index) {
+                                                std::ostream &info_out) {
   ProvidedFromTargetSet result;
 
   const auto aliased_by_index = ExtractAliasedBy(project);
@@ -327,24 +337,24 @@ ProvidedFromTargetSet ExtractHeaderToLibMapping(const ParsedProject &project,
 
     // There are multiple rule types that behave like a cc library and
     // provide header files.
-    AppendCCLibraryHeaders(*build_file, aliased_by_index,  //
-                           info_out, suffix_index, result);
-    AppendProtoLibraryHeaders(*build_file, aliased_by_index,  //
-                              suffix_index, result);
+    AppendCCLibraryHeaders(*build_file, aliased_by_index, info_out, result);
+    AppendProtoLibraryHeaders(*build_file, aliased_by_index, result);
   }
 
   return result;
 }
 
 ProvidedFromTarget ExtractGeneratedFromGenrule(const ParsedProject &project,
-                                               std::ostream &info_out,
-                                               bool suffix_index) {
+                                               std::ostream &info_out) {
+  static constexpr query::RuleSet kGenruleRule{"genrule"};
   ProvidedFromTarget result;
   for (const auto &[_, file_content] : project.ParsedFiles()) {
     if (!file_content->ast) continue;
     query::FindTargets(
-      file_content->ast, {"genrule"}, [&](const query::Result &params) {
-        const auto genfiles = query::ExtractStringList(params.outs_list);
+      file_content->ast, kGenruleRule,
+      {query::Attribute::kName, query::Attribute::kOuts},
+      [&](const query::Result &params) {
+        const query::StringListView genfiles(params.outs_list);
 
         auto target = file_content->package.QualifiedTarget(params.name);
         if (!target.has_value()) return;
@@ -352,7 +362,7 @@ ProvidedFromTarget ExtractGeneratedFromGenrule(const ParsedProject &project,
         for (const std::string_view generated : genfiles) {
           const auto gen_fqn = file_content->package.QualifiedFile(generated);
           const auto &inserted =
-            result.insert({KeyTransform(gen_fqn, suffix_index), *target});
+            result.insert({gen_fqn, *target});
           if (!inserted.second && target != inserted.first->second) {
             // TODO: differentiate between info-log (external projects) and
             // error-log (current project, as these are actionable).
@@ -373,63 +383,134 @@ ProvidedFromTarget ExtractGeneratedFromGenrule(const ParsedProject &project,
   return result;
 }
 
-static std::string_view CommonPrefix(std::string_view a, std::string_view b) {
-  if (b.length() < a.length()) {
-    std::swap(a, b);
-  }
-  for (size_t i = 0; i < a.length(); ++i) {
-    if (a[i] != b[i]) return a.substr(0, i);
+// Order of path components in the trie, such that the entries are in the
+// same order as their reversed paths would be: compare reversed, with '/' as
+// terminating character.
+static bool ReversedComponentLess(std::string_view a, std::string_view b) {
+  for (size_t i = 0;; ++i) {
+    const bool a_end = (i == a.size());
+    const bool b_end = (i == b.size());
+    if (a_end && b_end) return false;
+    const char ac = a_end ? '/' : a[a.size() - 1 - i];
+    const char bc = b_end ? '/' : b[b.size() - 1 - i];
+    if (ac != bc) return ac < bc;
   }
-  return a;
 }
 
-static size_t CommonSlashes(std::string_view a, std::string_view b) {
-  const std::string_view common = CommonPrefix(a, b);
-  return std::count_if(common.begin(), common.end(),
-                       [](char c) { return c == '/'; });
-}
-
-std::optional<FindResult> FindBySuffix(const ProvidedFromTargetSet &index,
-                                       std::string_view key,
-                                       size_t min_fuzzy_paths) {
-  if (index.empty()) return std::nullopt;
-  const std::string search_key = KeyTransform(key, true);
-  const ProvidedFromTargetSet::const_iterator found =
-    index.lower_bound(search_key);
-  if (found != index.end() && found->first == search_key) {
-    return FindResult{.match = std::string(key),  // Exact match.
-                      .target_set = &found->second,
-                      .fuzzy_score = 0};
+HeaderSuffixIndex::HeaderSuffixIndex()
+    : path_storage_(std::make_unique<Arena>(1 << 16)) {}
+
+HeaderSuffixIndex::HeaderSuffixIndex(const ProvidedFromTargetSet &provided)
+    : HeaderSuffixIndex() {
+  nodes_.emplace_back();  // root
+  // Lookup of (parent, component) only needed while building.
+  absl::flat_hash_map<std::pair<uint32_t, std::string_view>, uint32_t> lookup;
+  for (const auto &[path, targets] : provided) {
+    char *const path_copy =
+      static_cast<char *>(path_storage_->Alloc(path.size()));
+    memcpy(path_copy, path.data(), path.size());
+    const std::string_view stored_path(path_copy, path.size());
+    uint32_t node = 0;
+    std::string_view remaining = stored_path;
+    for (;;) {
+      const size_t slash = remaining.find_last_of('/');
+      const std::string_view component = (slash == std::string_view::npos)
+                                           ? remaining
+                                           : remaining.substr(slash + 1);
+      auto inserted = lookup.emplace(std::make_pair(node, component),
+                                     static_cast<uint32_t>(nodes_.size()));
+      if (inserted.second) {
+        nodes_[node].children.push_back({component, inserted.first->second});
+        nodes_.emplace_back();
+      }
+      node = inserted.first->second;
+      if (slash == std::string_view::npos) break;
+      remaining = remaining.substr(0, slash);
+    }
+    nodes_[node].path = stored_path;
+    nodes_[node].targets = &*target_sets_.insert(targets).first;
+  }
+  for (Node &n : nodes_) {
+    std::sort(n.children.begin(), n.children.end(),
+              [](const Child &a, const Child &b) {
+                return ReversedComponentLess(a.component, b.component);
+              });
   }
+  AssignTerminalRange(0);
+}
 
-  const bool was_at_end = (found == index.end());
-  ProvidedFromTargetSet::const_iterator best = found;
-  if (was_at_end) {  // Need to look one before.
-    --best;
+void HeaderSuffixIndex::AssignTerminalRange(uint32_t node_idx) {
+  // In suffix order, the terminal at this node comes before all children.
+  Node &node = nodes_[node_idx];
+  node.first_terminal = node.targets ? node_idx : kNoNode;
+  node.last_terminal = node.targets ? node_idx : kNoNode;
+  for (const Child &child : node.children) {
+    AssignTerminalRange(child.node);
+    const Node &child_node = nodes_[child.node];
+    if (node.first_terminal == kNoNode) {
+      node.first_terminal = child_node.first_terminal;
+    }
+    node.last_terminal = child_node.last_terminal;
   }
+}
 
-  size_t best_common_path_elements = CommonSlashes(search_key, best->first);
-
-  // A longer match might be hiding before our found position.
-  if (!was_at_end &&            // Unless we already looked one before.
-      best != index.begin()) {  // Can't go before that
-    auto before = std::prev(best);
-    const size_t common_path_elements =
-      CommonSlashes(search_key, before->first);
-    if (common_path_elements > best_common_path_elements) {
-      best_common_path_elements = common_path_elements;
-      best = before;
+std::optional<FindResult> HeaderSuffixIndex::FindBySuffix(
+  std::string_view key, size_t min_fuzzy_paths) const {
+  if (nodes_.size() <= 1) return std::nullopt;
+
+  // Walk down as far as path components match.
+  uint32_t node = 0;
+  size_t matched_paths = 0;
+  std::string_view remaining = key;
+  std::optional<std::string_view> mismatch;  // Component not found.
+  for (;;) {
+    const size_t slash = remaining.find_last_of('/');
+    const std::string_view component = (slash == std::string_view::npos)
+                                         ? remaining
+                                         : remaining.substr(slash + 1);
+    const std::vector<Child> &children = nodes_[node].children;
+    auto found = std::lower_bound(children.begin(), children.end(), component,
+                                  [](const Child &c, std::string_view value) {
+                                    return ReversedComponentLess(c.component,
+                                                                 value);
+                                  });
+    if (found == children.end() || found->component != component) {
+      mismatch = component;
+      break;
     }
+    node = found->node;
+    ++matched_paths;
+    if (slash == std::string_view::npos) break;
+    remaining = remaining.substr(0, slash);
   }
-  if (best_common_path_elements < min_fuzzy_paths) {
-    return std::nullopt;
+
+  const Node &deepest = nodes_[node];
+  if (!mismatch.has_value() && deepest.targets) {
+    return FindResult{.match = key,  // Exact match.
+                      .target_set = deepest.targets,
+                      .fuzzy_score = 0};
   }
 
+  if (matched_paths < min_fuzzy_paths) return std::nullopt;
+
+  // Fuzzy match. Of all the entries sharing the matched suffix, choose the
+  // first one that would sort after the key in suffix order, or the last one
+  // if there is none.
+  uint32_t best = deepest.first_terminal;
+  if (mismatch.has_value()) {
+    auto after = std::upper_bound(
+      deepest.children.begin(), deepest.children.end(), *mismatch,
+      [](std::string_view value, const Child &c) {
+        return ReversedComponentLess(value, c.component);
+      });
+    best = (after != deepest.children.end())
+             ? nodes_[after->node].first_terminal
+             : deepest.last_terminal;
+  }
   return FindResult{
-    .match = std::string(
-      {best->first.rbegin() + 1 /*skip-slash*/, best->first.rend()}),
-    .target_set = &best->second,
-    .fuzzy_score = static_cast<int>(best_common_path_elements),
+    .match = nodes_[best].path,
+    .target_set = nodes_[best].targets,
+    .fuzzy_score = static_cast<int>(matched_paths),
   };
 }
 
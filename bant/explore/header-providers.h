@@ -18,17 +18,22 @@
 #ifndef BANT_TOOL_HEADER_PROVIDER_
 #define BANT_TOOL_HEADER_PROVIDER_
 
+#include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <optional>
 #include <ostream>
+#include <set>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "absl/container/btree_set.h"
 #include "bant/frontend/parsed-project.h"
 #include "bant/session.h"
 #include "bant/types-bazel.h"
 #include "bant/types.h"
+#include "bant/util/arena.h"
 
 // TODO: Given that this not only provides HeaderToLibMapping but also
 // from Genrule, the name of this file is somewhat a misnomer.
@@ -43,31 +48,64 @@ using ProvidedFromTargetSet = OneToNSet<std::string, BazelTarget>;
 
 // Givent the "project", creates a mapping of all headers that are exported by
 // cc_library() targets to their respective targets.
-// If "suffix_index" is set, output is compatible with FinxBySuffix()
 ProvidedFromTargetSet ExtractHeaderToLibMapping(const ParsedProject &project,
-                                                std::ostream &info_out,
-                                                bool suffix_index = false);
+                                                std::ostream &info_out);
 
 // Find all the output generated by genrules. Should really only be 1:1.
-// If "suffix_index" is set, output is compatible with FinxBySuffix().
 ProvidedFromTarget ExtractGeneratedFromGenrule(const ParsedProject &project,
-                                               std::ostream &info_out,
-                                               bool suffix_index = false);
+                                               std::ostream &info_out);
 
 struct FindResult {
-  std::string match;  // Found match. Different from query if fuzzy match.
+  // Found match. Different from query if fuzzy match. Points to the query
+  // or into the index.
+  std::string_view match;
   const absl::btree_set<BazelTarget> *target_set;
   int fuzzy_score = 0;  // 0 if exact match otherwise path element count.
 };
 
-// Find a set of target that fuzzily match the suffix of the given key.
-// index is required to be generated with reverse keys, i.e. "reverse_index"
-// set to true when generating.
-// If there is no full match, "min_fuzzy_path" selects the minimum number of
-// path components that need to match. E.g. a match of foo/bar/baz.h would be 3.
-std::optional<FindResult> FindBySuffix(const ProvidedFromTargetSet &index,
-                                       std::string_view key,
-                                       size_t min_fuzzy_paths = 2);
+// Index of headers to find the providing targets by matching path suffixes.
+//
+// A trie over path components, starting from the last one: a lookup is
+// O(path depth) and does not allocate. Identical target sets (e.g. all the
+// headers of one library) are only stored once.
+class HeaderSuffixIndex {
+ public:
+  HeaderSuffixIndex();
+  explicit HeaderSuffixIndex(const ProvidedFromTargetSet &provided);
+
+  HeaderSuffixIndex(HeaderSuffixIndex &&) = default;
+  HeaderSuffixIndex &operator=(HeaderSuffixIndex &&) = default;
+
+  // Find a set of target that fuzzily match the suffix of the given key.
+  // If there is no full match, "min_fuzzy_path" selects the minimum number of
+  // path components that need to match. E.g. a match of foo/bar/baz.h would
+  // be 3. If multiple entries match equally well, the first one following
+  // the key in reversed path order is chosen.
+  std::optional<FindResult> FindBySuffix(std::string_view key,
+                                         size_t min_fuzzy_paths = 2) const;
+
+ private:
+  static constexpr uint32_t kNoNode = 0xffffffff;
+  struct Child {
+    std::string_view component;  // Points into path_storage_
+    uint32_t node;
+  };
+  struct Node {
+    std::vector<Child> children;  // Sorted by reversed component.
+    std::string_view path;        // Full path if this is a header.
+    const absl::btree_set<BazelTarget> *targets = nullptr;  // if header.
+
+    // Range of headers in this sub-tree in reversed path order.
+    uint32_t first_terminal = kNoNode;
+    uint32_t last_terminal = kNoNode;
+  };
+
+  void AssignTerminalRange(uint32_t node_idx);
+
+  std::unique_ptr<Arena> path_storage_;
+  std::set<absl::btree_set<BazelTarget>> target_sets_;
+  std::vector<Node> nodes_;  // nodes_[0] is the root.
+};
 
 // Pretty provided files and targets they are coming from in two columns.
 void PrintProvidedSources(Session &session, const std::string &table_header,
@@ -205,12 +205,6 @@ genrule(
               Contains(Pair("gen/ai/lucy-🌈-💎.txt", T("//gen/ai:llm"))));
 }
 
-static std::string reverse(std::string_view in) {
-  // This is a whitebox approach as we know how the index needs to be stored,
-  // but ok as header-providers.cc and this test go hand-in-hand.
-  return std::string{in.rbegin(), in.rend()}.append("/");
-}
-
 // Check for existence of value of fail if not.
 #define ASSERT_HAS_VALUE(x)     \
   ({                            \
@@ -220,58 +214,87 @@ static std::string reverse(std::string_view in) {
   })
 
 TEST(HeaderProviders, FindBySuffixTest) {
-  ProvidedFromTargetSet test_index;
-  test_index[reverse("foo/bar/baz/qux.h")].insert(T("//foo"));
-  test_index[reverse("baz/qux.h")].insert(T("//bar"));
+  ProvidedFromTargetSet headers;
+  headers["foo/bar/baz/qux.h"].insert(T("//foo"));
+  headers["baz/qux.h"].insert(T("//bar"));
+  HeaderSuffixIndex test_index(headers);
 
   // Exact match should only return that element
   FindResult result =
-    ASSERT_HAS_VALUE(FindBySuffix(test_index, "foo/bar/baz/qux.h"));
+    ASSERT_HAS_VALUE(test_index.FindBySuffix("foo/bar/baz/qux.h"));
   EXPECT_EQ(result.fuzzy_score, 0);  // no fuzzy, full match.
   EXPECT_THAT(*result.target_set, ElementsAre(T("//foo")));
 
-  result = ASSERT_HAS_VALUE(FindBySuffix(test_index, "baz/qux.h"));
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("baz/qux.h"));
   EXPECT_EQ(result.fuzzy_score, 0);  // no fuzzy, full match.
   EXPECT_THAT(*result.target_set, ElementsAre(T("//bar")));
 
   // Below, only fuzzy matches happen.
 
   // fuzzy matches with different amount of expected path elements
-  EXPECT_FALSE(FindBySuffix(test_index, "qux.h", 2).has_value());  // 2 slash
-  EXPECT_TRUE(FindBySuffix(test_index, "qux.h", 1).has_value());   // 1 slash
-  EXPECT_FALSE(FindBySuffix(test_index, "ux.h", 1).has_value());   // not even 1
+  EXPECT_FALSE(test_index.FindBySuffix("qux.h", 2).has_value());  // 2 slash
+  EXPECT_TRUE(test_index.FindBySuffix("qux.h", 1).has_value());   // 1 slash
+  EXPECT_FALSE(test_index.FindBySuffix("ux.h", 1).has_value());   // not even 1
 
   // so in general shorter matches than to the first slash don't count.
-  EXPECT_FALSE(FindBySuffix(test_index, "bar/xqux.h", 1).has_value());
+  EXPECT_FALSE(test_index.FindBySuffix("bar/xqux.h", 1).has_value());
 
   // Other fuzzy matches should return the candiate matching closest.
-  result = ASSERT_HAS_VALUE(FindBySuffix(test_index, "az/qux.h", 1));
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("az/qux.h", 1));
   EXPECT_EQ(result.fuzzy_score, 1);
   EXPECT_THAT(*result.target_set, ElementsAre(T("//bar")));
 
-  result = ASSERT_HAS_VALUE(FindBySuffix(test_index, "r/baz/qux.h"));
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("r/baz/qux.h"));
   EXPECT_EQ(result.fuzzy_score, 2);
   EXPECT_THAT(*result.target_set, ElementsAre(T("//foo")));
 
-  result = ASSERT_HAS_VALUE(FindBySuffix(test_index, "bar/baz/qux.h"));
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("bar/baz/qux.h"));
   EXPECT_EQ(result.fuzzy_score, 3);
   EXPECT_THAT(*result.target_set, ElementsAre(T("//foo")));
 
   // Longer path than is in index, but with the same suffix. It will
   // be one before the match. We find it before end()
   result =
-    ASSERT_HAS_VALUE(FindBySuffix(test_index, "hello/foo/bar/baz/qux.h"));
+    ASSERT_HAS_VALUE(test_index.FindBySuffix("hello/foo/bar/baz/qux.h"));
   EXPECT_EQ(result.fuzzy_score, 4);
   EXPECT_THAT(*result.target_set, ElementsAre(T("//foo")));
 
   // If there is another entry afterwards, we also find it.
-  test_index[reverse("foo/bar/baz/rux.h")].insert(T("//rux"));
+  headers["foo/bar/baz/rux.h"].insert(T("//rux"));
+  test_index = HeaderSuffixIndex(headers);
   result =
-    ASSERT_HAS_VALUE(FindBySuffix(test_index, "hello/foo/bar/baz/qux.h"));
+    ASSERT_HAS_VALUE(test_index.FindBySuffix("hello/foo/bar/baz/qux.h"));
   EXPECT_EQ(result.fuzzy_score, 4);
   EXPECT_THAT(*result.target_set, ElementsAre(T("//foo")));
 }
 
+TEST(HeaderProviders, FindBySuffixChoosesDeterministicallyAmongEqualMatches) {
+  ProvidedFromTargetSet headers;
+  headers["a/foo/bar.h"].insert(T("//a"));
+  headers["b/foo/bar.h"].insert(T("//b"));
+  headers["z/foo/bar.h"].insert(T("//z"));
+  headers["foo/baz.h"].insert(T("//a"));
+  const HeaderSuffixIndex test_index(headers);
+
+  // Key is a suffix of all of them: choose first in reverse path order.
+  FindResult result = ASSERT_HAS_VALUE(test_index.FindBySuffix("foo/bar.h"));
+  EXPECT_EQ(result.fuzzy_score, 2);
+  EXPECT_EQ(result.match, "a/foo/bar.h");
+  EXPECT_THAT(*result.target_set, ElementsAre(T("//a")));
+
+  // Otherwise, the first that would follow the key in reverse path order.
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("c/foo/bar.h"));
+  EXPECT_EQ(result.match, "z/foo/bar.h");
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("zz/foo/bar.h"));
+  EXPECT_EQ(result.match, "z/foo/bar.h");  // Nothing after: last one.
+
+  // The same target set is shared between headers providing it.
+  const FindResult other = ASSERT_HAS_VALUE(test_index.FindBySuffix(
+    "foo/baz.h"));
+  result = ASSERT_HAS_VALUE(test_index.FindBySuffix("a/foo/bar.h"));
+  EXPECT_EQ(other.target_set, result.target_set);
+}
+
 // Needs test:
 // strip_import_prefix
 // aliases for proto libraries.
@@ -0,0 +1,161 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/include-cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/file-utils.h"
+
+namespace bant {
+namespace {
+// Bump if the format or how includes are extracted changes.
+constexpr std::string_view kFileHeader = "bant-include-cache 1";
+}  // namespace
+
+IncludeCache::IncludeCache(std::string file) : file_(std::move(file)) {
+  Load();
+}
+
+IncludeCache::Lookup IncludeCache::Find(const FilesystemPath &source_file,
+                                        size_t scan_slack) {
+  Lookup result;
+  const std::optional<FileStamp> stamp = GetFileStamp(source_file);
+  if (!stamp.has_value()) return result;
+  result.exists = true;
+  result.stamp = *stamp;
+
+  const std::lock_guard<std::mutex> l(lock_);
+  auto found = entries_.find({source_file.path(), scan_slack});
+  if (found == entries_.end()) return result;
+  Entry &entry = found->second;
+  entry.used = true;
+  if (entry.stamp == *stamp) {
+    result.includes = entry.includes;
+    result.fingerprint = entry.fingerprint;
+  }
+  return result;
+}
+
+std::optional<IncludeCache::IncludeList> IncludeCache::FindByContent(
+  const FilesystemPath &source_file, size_t scan_slack, FileStamp stamp,
+  uint64_t fingerprint) {
+  const std::lock_guard<std::mutex> l(lock_);
+  auto found = entries_.find({source_file.path(), scan_slack});
+  if (found == entries_.end()) return std::nullopt;
+  Entry &entry = found->second;
+  entry.used = true;
+  if (entry.fingerprint != fingerprint) return std::nullopt;
+  if (entry.stamp != stamp) {
+    entry.stamp = stamp;
+    modified_ = true;
+  }
+  return entry.includes;
+}
+
+IncludeCache::IncludeList IncludeCache::Update(
+  const FilesystemPath &source_file, size_t scan_slack, FileStamp stamp,
+  uint64_t fingerprint, IncludeList includes) {
+  const std::lock_guard<std::mutex> l(lock_);
+  for (Include &include : includes) {
+    include.path = updated_strings_.Keep(include.path);
+  }
+
+  Entry &entry = entries_[{source_file.path(), scan_slack}];
+  entry.stamp = stamp;
+  entry.fingerprint = fingerprint;
+  entry.used = true;
+  entry.includes = std::move(includes);
+  modified_ = true;
+  return entry.includes;
+}
+
+void IncludeCache::Load() {
+  // F <source-file> <scan-slack> <inode> <size> <mtime> <fingerprint>
+  // I <line> <column> <include-path>
+  Entry *current = nullptr;
+  auto record = [&](std::span<const std::string_view> fields) {
+    if (fields[0] == "F" && fields.size() == 7) {
+      Entry entry;
+      size_t scan_slack = 0;
+      if (!ParseNumber(fields[2], &scan_slack) ||
+          !ParseNumber(fields[3], &entry.stamp.inode) ||
+          !ParseNumber(fields[4], &entry.stamp.size) ||
+          !ParseNumber(fields[5], &entry.stamp.mtime) ||
+          !ParseNumber(fields[6], &entry.fingerprint, 16)) {
+        return false;
+      }
+      Entry &stored = entries_[{std::string(fields[1]), scan_slack}];
+      current = &(stored = std::move(entry));
+      return true;
+    }
+    if (fields[0] == "I" && fields.size() == 4 && current) {
+      Include &include = current->includes.emplace_back();
+      include.path = fields[3];
+      return ParseNumber(fields[1], &include.position.line) &&
+             ParseNumber(fields[2], &include.position.col);
+    }
+    return false;
+  };
+  // Includes point into the loaded content.
+  LoadCacheFile(file_, kFileHeader, &loaded_content_, &entries_, record);
+}
+
+bool IncludeCache::Save() {
+  const std::lock_guard<std::mutex> l(lock_);
+  modified_ |= std::erase_if(entries_, [](const auto &entry) {
+    const auto &[key, value] = entry;
+    return !value.used && !FilesystemPath(key.first).can_read();
+  }) > 0;
+  if (!modified_) return true;  // Nothing to update.
+
+  CacheFileWriter out(file_, kFileHeader);
+  for (const auto &[key, entry] : entries_) {
+    const auto &[source_file, scan_slack] = key;
+    bool storable = CacheFileWriter::IsStorable(source_file);
+    for (const Include &include : entry.includes) {
+      storable &= CacheFileWriter::IsStorable(include.path);
+    }
+    if (!storable) continue;  // Will be extracted next time.
+    out.Write({"F", source_file, absl::StrCat(scan_slack),
+               absl::StrCat(entry.stamp.inode), absl::StrCat(entry.stamp.size),
+               absl::StrCat(entry.stamp.mtime),
+               absl::StrFormat("%x", entry.fingerprint)});
+    for (const Include &include : entry.includes) {
+      out.Write({"I", absl::StrCat(include.position.line),
+                 absl::StrCat(include.position.col), include.path});
+    }
+  }
+  if (!out.Commit()) return false;
+  modified_ = false;
+  return true;
+}
+
+std::optional<std::string> IncludeCacheFile() {
+  return ProjectCacheFile("include-cache");
+}
+}  // namespace bant
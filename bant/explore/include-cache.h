@@ -0,0 +1,125 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_EXPLORE_INCLUDE_CACHE_H
+#define BANT_EXPLORE_INCLUDE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bant/frontend/source-locator.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/file-utils.h"
+
+namespace bant {
+// Remembers per source file the #include "..." it contains and where. These
+// only depend on the bytes of the file, so are kept between runs and don't
+// need to be extracted again; unchanged files are not even opened.
+//
+// Entries are checked against the FileStamp of the file and, if it changed,
+// against a Fingerprint() of the content the includes were extracted from.
+//
+// Find(), FindByContent() and Update() are thread-safe.
+class IncludeCache {
+ public:
+  // Strings are owned by the cache, or, before Update(), by the caller.
+  struct Include {
+    std::string_view path;  // As written between the quotes.
+    LineColumn position;    // Of the path in the file.
+
+    bool operator==(const Include &) const = default;
+  };
+  using IncludeList = std::vector<Include>;
+
+  // Result of looking up a file.
+  struct Lookup {
+    bool exists = false;  // File could be stat()'ed.
+    FileStamp stamp;      // For a following FindByContent() or Update().
+
+    // Set if the file is unchanged.
+    std::optional<IncludeList> includes;
+    uint64_t fingerprint = 0;
+  };
+
+  // Cache stored in "file". Starts out with its content if it exists and is
+  // readable.
+  explicit IncludeCache(std::string file);
+  IncludeCache(const IncludeCache &) = delete;
+
+  // The includes of "source_file", if its stamp did not change since they
+  // were recorded with the same "scan_slack" (see
+  // CommandlineFlags::include_scan_slack; it determines how much of the file
+  // is looked at). Does not read the file.
+  Lookup Find(const FilesystemPath &source_file, size_t scan_slack);
+
+  // For a file with a changed stamp: if the content the includes were
+  // extracted from still has the same "fingerprint", return the includes
+  // and remember the new "stamp".
+  std::optional<IncludeList> FindByContent(const FilesystemPath &source_file,
+                                           size_t scan_slack, FileStamp stamp,
+                                           uint64_t fingerprint);
+
+  // Record the includes of "source_file" extracted from content with given
+  // "fingerprint". The "stamp" is the one returned by Find() before reading
+  // the file. Returns the includes with copies of the strings owned by
+  // the cache.
+  IncludeList Update(const FilesystemPath &source_file, size_t scan_slack,
+                     FileStamp stamp, uint64_t fingerprint,
+                     IncludeList includes);
+
+  // Write back the cache if anything changed. Entries for files that don't
+  // exist anymore are dropped. Returns true on success.
+  bool Save();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    FileStamp stamp;
+    uint64_t fingerprint = 0;
+    bool used = false;  // Looked up or updated in this run.
+    IncludeList includes;
+  };
+
+  void Load();
+
+  const std::string file_;
+  std::mutex lock_;
+
+  // Backing store for the include paths: the content loaded from the file,
+  // and the strings of each Update().
+  std::string loaded_content_;
+  StringStore updated_strings_;
+
+  // Keyed by source file and scan slack.
+  std::map<std::pair<std::string, size_t>, Entry> entries_;
+  bool modified_ = false;
+};
+
+// If the user created a ~/.cache/bant directory, the file to keep the
+// includes of the project in the current directory in; nullopt otherwise.
+std::optional<std::string> IncludeCacheFile();
+}  // namespace bant
+
+#endif  // BANT_EXPLORE_INCLUDE_CACHE_H
@@ -0,0 +1,110 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/include-cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "bant/frontend/source-locator.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/file-utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using Include = bant::IncludeCache::Include;
+
+namespace bant {
+TEST(IncludeCache, FindUpdateSaveAndLoad) {
+  const std::string dir = ::testing::TempDir() + "/include-cache";
+  mkdir(dir.c_str(), 0755);
+  const std::string cache_file = dir + "/cache";
+  unlink(cache_file.c_str());  // Possibly left from previous run.
+  const FilesystemPath source(dir + "/foo.cc");
+  const std::string content = "#include \"foo.h\"\n";
+  std::ofstream(source.path()) << content;
+  const uint64_t fingerprint = Fingerprint(content);
+
+  {
+    IncludeCache cache(cache_file);
+    IncludeCache::Lookup lookup = cache.Find(source, 0);
+    EXPECT_TRUE(lookup.exists);
+    EXPECT_FALSE(lookup.includes.has_value());  // Not known yet.
+    const std::string from_content = "foo.h";
+    EXPECT_THAT(cache.Update(source, 0, lookup.stamp, fingerprint,
+                             {{.path = from_content, .position = {0, 10}}}),
+                ElementsAre(Include{"foo.h", {0, 10}}));
+
+    lookup = cache.Find(source, 0);
+    ASSERT_TRUE(lookup.includes.has_value());
+    EXPECT_THAT(*lookup.includes, ElementsAre(Include{"foo.h", {0, 10}}));
+    EXPECT_EQ(lookup.fingerprint, fingerprint);
+
+    // Scanning different amounts of the file can yield different includes.
+    EXPECT_FALSE(cache.Find(source, 1000).includes.has_value());
+    EXPECT_TRUE(cache.Save());
+  }
+
+  {
+    IncludeCache cache(cache_file);
+    const IncludeCache::Lookup lookup = cache.Find(source, 0);
+    ASSERT_TRUE(lookup.includes.has_value());
+    EXPECT_THAT(*lookup.includes, ElementsAre(Include{"foo.h", {0, 10}}));
+    EXPECT_EQ(lookup.fingerprint, fingerprint);
+  }
+
+  // Replaced with the same content: needs to be read, but is still good.
+  const std::string replacement = dir + "/foo.cc.new";
+  std::ofstream(replacement) << content;
+  ASSERT_EQ(std::rename(replacement.c_str(), source.path().c_str()), 0);
+  {
+    IncludeCache cache(cache_file);
+    const IncludeCache::Lookup lookup = cache.Find(source, 0);
+    EXPECT_FALSE(lookup.includes.has_value());
+    EXPECT_THAT(cache.FindByContent(source, 0, lookup.stamp, fingerprint),
+                testing::Optional(ElementsAre(Include{"foo.h", {0, 10}})));
+    EXPECT_FALSE(cache.FindByContent(source, 0, lookup.stamp, fingerprint + 1)
+                   .has_value());
+    EXPECT_TRUE(cache.Save());
+  }
+
+  // ... and the new stamp has been remembered.
+  {
+    IncludeCache cache(cache_file);
+    EXPECT_TRUE(cache.Find(source, 0).includes.has_value());
+  }
+
+  // Gone files are not kept.
+  unlink(source.path().c_str());
+  {
+    IncludeCache cache(cache_file);
+    EXPECT_FALSE(cache.Find(source, 0).exists);
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_TRUE(cache.Save());
+  }
+  {
+    IncludeCache cache(cache_file);
+    EXPECT_EQ(cache.size(), 0);
+  }
+}
+}  // namespace bant
@@ -0,0 +1,526 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/query-expression.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "bant/explore/dependency-graph.h"
+#include "bant/explore/query-utils.h"
+#include "bant/explore/reachability.h"
+#include "bant/explore/target-set.h"
+#include "bant/frontend/ast.h"
+#include "bant/frontend/named-content.h"
+#include "bant/frontend/parsed-project.h"
+#include "bant/frontend/scanner.h"
+#include "bant/label-table.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+#include "re2/re2.h"
+
+namespace bant {
+struct QueryTerm {
+  enum class Op {
+    kPattern,
+    kUnion,
+    kIntersect,
+    kExcept,
+    kDeps,
+    kRdeps,
+    kAllPaths,
+    kSomePath,
+    kKind,
+    kFilter,
+    kAttr,
+  };
+  explicit QueryTerm(Op op) : op(op) {}
+
+  const Op op;
+  BazelPattern pattern;          // kPattern
+  std::unique_ptr<RE2> regex;    // kKind, kFilter, kAttr
+  std::string attribute;         // kAttr
+  int depth = -1;                // kDeps, kRdeps; negative: unlimited.
+  std::vector<std::unique_ptr<QueryTerm>> args;
+};
+
+namespace {
+using Op = QueryTerm::Op;
+
+// The query language has no use for most of the tokens the Scanner knows,
+// but target patterns such as //foo/bar:baz-qux or @x//... are split by it
+// into many. Tokens directly adjacent to each other are glued back together
+// into one word. Quoted strings are a word on their own.
+struct Word {
+  enum Kind { kText, kOpen, kClose, kComma, kEnd, kError };
+  Kind kind;
+  std::string_view text;  // Unquoted, if it was a string literal.
+  bool quoted = false;
+  size_t column = 0;
+};
+
+class WordScanner {
+ public:
+  explicit WordScanner(std::string_view expression)
+      : content_("<query>", expression), scanner_(content_) {}
+
+  Word Next() {
+    if (has_upcoming_) {
+      has_upcoming_ = false;
+      return upcoming_;
+    }
+    const Token token = scanner_.Next();
+    Word result{
+      .kind = Word::kText, .text = token.text, .column = Column(token)};
+    switch (token.type) {
+    case TokenType::kOpenParen: result.kind = Word::kOpen; break;
+    case TokenType::kCloseParen: result.kind = Word::kClose; break;
+    case TokenType::kComma: result.kind = Word::kComma; break;
+    case TokenType::kEof: result.kind = Word::kEnd; break;
+    case TokenType::kStringLiteral:
+      result.text = Unquote(token.text);
+      result.quoted = true;
+      break;
+    default: {
+      const char *const start = token.text.data();
+      const char *end = start + token.text.size();
+      for (Token t = scanner_.Peek(); IsGlueable(t) && t.text.data() == end;
+           t = scanner_.Peek()) {
+        end = scanner_.Next().text.end();
+      }
+      result.text = {start, static_cast<size_t>(end - start)};
+    }
+    }
+    return result;
+  }
+
+  Word Peek() {
+    if (!has_upcoming_) {
+      upcoming_ = Next();
+      has_upcoming_ = true;
+    }
+    return upcoming_;
+  }
+
+ private:
+  static bool IsGlueable(const Token &t) {
+    switch (t.type) {
+    case TokenType::kOpenParen:
+    case TokenType::kCloseParen:
+    case TokenType::kComma:
+    case TokenType::kStringLiteral:
+    case TokenType::kEof: return false;
+    default: return true;
+    }
+  }
+
+  static std::string_view Unquote(std::string_view literal) {
+    if (literal.starts_with('r') || literal.starts_with('R')) {
+      literal.remove_prefix(1);
+    }
+    const size_t quote_len = literal.starts_with("\"\"\"") ? 3 : 1;
+    if (literal.size() < 2 * quote_len) return {};
+    return literal.substr(quote_len, literal.size() - 2 * quote_len);
+  }
+
+  size_t Column(const Token &t) const {
+    return t.text.data() - content_.content().data() + 1;
+  }
+
+  NamedLineIndexedContent content_;
+  Scanner scanner_;
+  Word upcoming_;
+  bool has_upcoming_ = false;
+};
+
+class QueryParser {
+ public:
+  QueryParser(std::string_view expression, std::ostream &error)
+      : scanner_(expression), error_(error) {}
+
+  std::unique_ptr<QueryTerm> ParseQuery() {
+    auto result = ParseExpression();
+    if (!result) return nullptr;
+    const Word w = scanner_.Next();
+    if (w.kind != Word::kEnd) return Error(w, "expected end of query");
+    return result;
+  }
+
+  BazelPatternBundle TakePatterns() { return std::move(patterns_); }
+
+ private:
+  static std::optional<Op> BinaryOperator(const Word &w) {
+    if (w.kind != Word::kText || w.quoted) return std::nullopt;
+    if (w.text == "union" || w.text == "+") return Op::kUnion;
+    if (w.text == "intersect" || w.text == "^") return Op::kIntersect;
+    if (w.text == "except" || w.text == "-") return Op::kExcept;
+    return std::nullopt;
+  }
+
+  // All binary operators have the same precedence and are left-associative.
+  std::unique_ptr<QueryTerm> ParseExpression() {
+    auto result = ParsePrimary();
+    while (result) {
+      const std::optional<Op> op = BinaryOperator(scanner_.Peek());
+      if (!op) break;
+      scanner_.Next();
+      auto right = ParsePrimary();
+      if (!right) return nullptr;
+      auto combined = std::make_unique<QueryTerm>(*op);
+      combined->args.push_back(std::move(result));
+      combined->args.push_back(std::move(right));
+      result = std::move(combined);
+    }
+    return result;
+  }
+
+  std::unique_ptr<QueryTerm> ParsePrimary() {
+    const Word w = scanner_.Next();
+    switch (w.kind) {
+    case Word::kOpen: {
+      auto result = ParseExpression();
+      if (!result || !Expect(Word::kClose, "')'")) return nullptr;
+      return result;
+    }
+    case Word::kText:
+      if (!w.quoted && scanner_.Peek().kind == Word::kOpen) {
+        scanner_.Next();
+        return ParseFunction(w);
+      }
+      return ParsePattern(w);
+    default: return Error(w, "expected target pattern or function");
+    }
+  }
+
+  std::unique_ptr<QueryTerm> ParsePattern(const Word &w) {
+    auto pattern = BazelPattern::ParseFrom(w.text);
+    if (!pattern.has_value()) return Error(w, "invalid target pattern");
+    patterns_.AddPattern(*pattern);
+    auto result = std::make_unique<QueryTerm>(Op::kPattern);
+    result->pattern = *pattern;
+    return result;
+  }
+
+  // Function name and opening parenthesis are already consumed.
+  std::unique_ptr<QueryTerm> ParseFunction(const Word &name) {
+    struct Function {
+      std::string_view name;
+      Op op;
+      bool attribute_arg;   // Leading attribute name.
+      bool regex_arg;       // Leading regular expression.
+      int expression_args;  // Then this many expressions.
+      bool depth_arg;       // Optional trailing depth.
+    };
+    static constexpr Function kFunctions[] = {
+      {"deps", Op::kDeps, false, false, 1, true},
+      {"rdeps", Op::kRdeps, false, false, 2, true},
+      {"allpaths", Op::kAllPaths, false, false, 2, false},
+      {"somepath", Op::kSomePath, false, false, 2, false},
+      {"kind", Op::kKind, false, true, 1, false},
+      {"filter", Op::kFilter, false, true, 1, false},
+      {"attr", Op::kAttr, true, true, 1, false},
+    };
+    const auto *const function =
+      std::find_if(std::begin(kFunctions), std::end(kFunctions),
+                   [&](const Function &f) { return f.name == name.text; });
+    if (function == std::end(kFunctions)) {
+      return Error(name, "unknown function");
+    }
+
+    auto result = std::make_unique<QueryTerm>(function->op);
+    if (function->attribute_arg) {
+      const Word attribute = scanner_.Next();
+      if (attribute.kind != Word::kText) {
+        return Error(attribute, "expected attribute name");
+      }
+      result->attribute = attribute.text;
+      if (!Expect(Word::kComma, "','")) return nullptr;
+    }
+
+    if (function->regex_arg) {
+      const Word regex = scanner_.Next();
+      if (regex.kind != Word::kText) return Error(regex, "expected regex");
+      RE2::Options options;
+      options.set_log_errors(false);
+      result->regex = std::make_unique<RE2>(regex.text, options);
+      if (!result->regex->ok()) return Error(regex, "invalid regex");
+      if (!Expect(Word::kComma, "','")) return nullptr;
+    }
+
+    for (int i = 0; i < function->expression_args; ++i) {
+      if (i > 0 && !Expect(Word::kComma, "','")) return nullptr;
+      auto arg = ParseExpression();
+      if (!arg) return nullptr;
+      result->args.push_back(std::move(arg));
+    }
+
+    if (function->depth_arg && scanner_.Peek().kind == Word::kComma) {
+      scanner_.Next();
+      const Word depth = scanner_.Next();
+      const char *const end = depth.text.data() + depth.text.size();
+      auto [parsed_end, ec] =
+        std::from_chars(depth.text.data(), end, result->depth);
+      if (depth.kind != Word::kText || ec != std::errc() ||
+          parsed_end != end || result->depth < 0) {
+        return Error(depth, "expected non-negative depth");
+      }
+    }
+
+    if (!Expect(Word::kClose, "')'")) return nullptr;
+    return result;
+  }
+
+  bool Expect(Word::Kind kind, std::string_view what) {
+    const Word w = scanner_.Next();
+    if (w.kind == kind) return true;
+    Error(w, absl::StrCat("expected ", what));
+    return false;
+  }
+
+  std::unique_ptr<QueryTerm> Error(const Word &w, std::string_view msg) {
+    error_ << "query:1:" << w.column << ": " << msg;
+    if (w.kind == Word::kEnd) {
+      error_ << " (got end of query)";
+    } else {
+      error_ << " (got '" << w.text << "')";
+    }
+    error_ << "\n";
+    return nullptr;
+  }
+
+  WordScanner scanner_;
+  std::ostream &error_;
+  BazelPatternBundle patterns_;
+};
+
+// True if the value of "attribute" in the rule call matches "regex". Lists
+// match if any of the elements matches.
+bool AttributeMatches(FunCall *rule, std::string_view attribute,
+                      const RE2 &regex) {
+  if (!rule || !rule->argument()) return false;
+  for (Node *arg : *rule->argument()) {
+    Assignment *const assignment = arg ? arg->CastAsAssignment() : nullptr;
+    if (!assignment || !assignment->maybe_identifier() ||
+        assignment->maybe_identifier()->id() != attribute) {
+      continue;
+    }
+    Node *const value = assignment->value();
+    if (!value) return false;
+    if (Scalar *scalar = value->CastAsScalar()) {
+      return RE2::PartialMatch(scalar->AsString(), regex);
+    }
+    if (List *list = value->CastAsList()) {
+      for (Node *element : *list) {
+        Scalar *const scalar = element ? element->CastAsScalar() : nullptr;
+        if (scalar && RE2::PartialMatch(scalar->AsString(), regex)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    std::stringstream printed;  // Anything else, e.g. a select().
+    printed << value;
+    return RE2::PartialMatch(printed.str(), regex);
+  }
+  return false;
+}
+
+class QueryEvaluator {
+ public:
+  QueryEvaluator(const DependencyGraph &graph, std::span<FunCall *const> rules)
+      : graph_(graph), rules_(rules), reachability_(graph) {}
+
+  TargetSet Evaluate(const QueryTerm &term) {
+    switch (term.op) {
+    case Op::kPattern: return Select([&](TargetId id) {
+        return term.pattern.Match(graph_.labels.target(id));
+      });
+
+    case Op::kUnion: {
+      TargetSet result = Evaluate(*term.args[0]);
+      result |= Evaluate(*term.args[1]);
+      return result;
+    }
+    case Op::kIntersect: {
+      TargetSet result = Evaluate(*term.args[0]);
+      result &= Evaluate(*term.args[1]);
+      return result;
+    }
+    case Op::kExcept: {
+      TargetSet result = Evaluate(*term.args[0]);
+      result -= Evaluate(*term.args[1]);
+      return result;
+    }
+
+    case Op::kDeps:
+      return reachability_.TransitiveDependencies(Evaluate(*term.args[0]),
+                                                  term.depth);
+
+    case Op::kRdeps: {
+      // Everything depending on a target in the closure of the universe is
+      // also in that closure, so restricting afterwards is the same as
+      // searching only within the universe.
+      TargetSet result = reachability_.TransitiveDependents(
+        Evaluate(*term.args[1]), term.depth);
+      result &= reachability_.TransitiveDependencies(Evaluate(*term.args[0]));
+      return result;
+    }
+
+    case Op::kAllPaths: {
+      TargetSet result =
+        reachability_.TransitiveDependencies(Evaluate(*term.args[0]));
+      result &= reachability_.TransitiveDependents(Evaluate(*term.args[1]));
+      return result;
+    }
+
+    case Op::kSomePath: return SomePath(*term.args[0], *term.args[1]);
+
+    case Op::kKind: {
+      TargetSet result = Evaluate(*term.args[0]);
+      return Filter(result, [&](TargetId id) {
+        FunCall *const rule = Rule(id);
+        return rule && RE2::PartialMatch(rule->identifier()->id(), *term.regex);
+      });
+    }
+    case Op::kFilter: {
+      TargetSet result = Evaluate(*term.args[0]);
+      return Filter(result, [&](TargetId id) {
+        return RE2::PartialMatch(graph_.labels.ToString(id), *term.regex);
+      });
+    }
+    case Op::kAttr: {
+      TargetSet result = Evaluate(*term.args[0]);
+      return Filter(result, [&](TargetId id) {
+        return AttributeMatches(Rule(id), term.attribute, *term.regex);
+      });
+    }
+    }
+    return {};
+  }
+
+ private:
+  template <typename Predicate>
+  TargetSet Select(Predicate &&predicate) const {
+    const size_t target_count = graph_.labels.target_count();
+    TargetSet result(target_count);
+    for (TargetId id = 0; id < target_count; ++id) {
+      if (predicate(id)) result.insert(id);
+    }
+    return result;
+  }
+
+  template <typename Predicate>
+  static TargetSet Filter(const TargetSet &input, Predicate &&predicate) {
+    TargetSet result;
+    input.ForEach([&](TargetId id) {
+      if (predicate(id)) result.insert(id);
+    });
+    return result;
+  }
+
+  FunCall *Rule(TargetId id) const {
+    return id < rules_.size() ? rules_[id] : nullptr;
+  }
+
+  // A path from the first target in "from" that reaches any in "to".
+  TargetSet SomePath(const QueryTerm &from_term, const QueryTerm &to_term) {
+    const TargetSet from = Evaluate(from_term);
+    TargetSet to = Evaluate(to_term);
+    to &= reachability_.TransitiveDependencies(from);
+    TargetSet result;
+    if (to.empty()) return result;
+    const TargetId destination = to.ToVector().front();
+    for (const TargetId start : from.ToVector()) {
+      const std::vector<TargetId> path =
+        reachability_.SomePath(start, destination);
+      if (path.empty()) continue;
+      for (const TargetId id : path) result.insert(id);
+      break;
+    }
+    return result;
+  }
+
+  const DependencyGraph &graph_;
+  const std::span<FunCall *const> rules_;
+  const ReachabilityIndex reachability_;
+};
+}  // namespace
+
+QueryExpression::QueryExpression(std::unique_ptr<QueryTerm> root,
+                                 BazelPatternBundle patterns)
+    : root_(std::move(root)), patterns_(std::move(patterns)) {
+  patterns_.Finish();
+}
+
+QueryExpression::~QueryExpression() = default;
+
+std::unique_ptr<QueryExpression> QueryExpression::Parse(
+  std::string_view expression, std::ostream &error) {
+  QueryParser parser(expression, error);
+  std::unique_ptr<QueryTerm> root = parser.ParseQuery();
+  if (!root) return nullptr;
+  return std::unique_ptr<QueryExpression>(
+    new QueryExpression(std::move(root), parser.TakePatterns()));
+}
+
+TargetSet QueryExpression::Evaluate(const DependencyGraph &graph,
+                                    std::span<FunCall *const> rules) const {
+  QueryEvaluator evaluator(graph, rules);
+  return evaluator.Evaluate(*root_);
+}
+
+std::vector<BazelTarget> RunQuery(Session &session,
+                                  const QueryExpression &query,
+                                  ParsedProject *project) {
+  // The callback only knows the target, the ids are looked up once the
+  // graph is complete.
+  std::vector<std::pair<BazelTarget, FunCall *>> found_rules;
+  const DependencyGraph graph = BuildDependencyGraph(
+    session, query.patterns(), std::numeric_limits<int>::max(), project,
+    [&](const BazelTarget &target, const query::Result &details) {
+      found_rules.emplace_back(target, details.node);
+    });
+
+  std::vector<FunCall *> rules(graph.labels.target_count(), nullptr);
+  for (const auto &[target, rule] : found_rules) {
+    if (auto id = graph.labels.FindTarget(target); id.has_value()) {
+      rules[*id] = rule;
+    }
+  }
+
+  std::vector<BazelTarget> result;
+  query.Evaluate(graph, rules).ForEach([&](TargetId id) {
+    result.push_back(graph.labels.target(id));
+  });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+}  // namespace bant
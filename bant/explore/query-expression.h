@@ -0,0 +1,90 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_EXPLORE_QUERY_EXPRESSION_H
+#define BANT_EXPLORE_QUERY_EXPRESSION_H
+
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "bant/explore/dependency-graph.h"
+#include "bant/explore/target-set.h"
+#include "bant/frontend/ast.h"
+#include "bant/frontend/parsed-project.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+
+namespace bant {
+struct QueryTerm;  // Node in the parsed expression tree.
+
+// An expression in a subset of the bazel query language, evaluated on the
+// DependencyGraph. Supported are target patterns, parenthesis and
+//
+//   deps(x [, depth])         x and everything it transitively depends on.
+//   rdeps(u, x [, depth])     targets in the transitive closure of u that
+//                             depend on x.
+//   allpaths(from, to)        all targets on some path from -> to.
+//   somepath(from, to)        the targets on one shortest path from -> to.
+//   kind(regex, x)            targets in x with a rule name matching regex.
+//   filter(regex, x)          targets in x with a label matching regex.
+//   attr(name, regex, x)      targets in x with attribute matching regex.
+//
+//   x union y, x + y          set operations; all binary operators have the
+//   x intersect y, x ^ y      same precedence and are left-associative.
+//   x except y, x - y
+//
+// Words are read with the same Scanner that reads BUILD files, so quoting
+// works the same; quoting is only needed if a word contains spaces, commas
+// or parenthesis.
+class QueryExpression {
+ public:
+  // Parse "expression". On error, prints message to "error" and returns
+  // nullptr.
+  static std::unique_ptr<QueryExpression> Parse(std::string_view expression,
+                                                std::ostream &error);
+  ~QueryExpression();
+
+  // All target patterns mentioned in the expression. The graph the
+  // expression is evaluated on needs to contain the targets matching these
+  // and their transitive dependencies.
+  const BazelPatternBundle &patterns() const { return patterns_; }
+
+  // Evaluate on "graph". The "rules" are indexed by TargetId and contain
+  // the call defining the target, or nullptr if not known; needed by kind()
+  // and attr().
+  TargetSet Evaluate(const DependencyGraph &graph,
+                     std::span<FunCall *const> rules) const;
+
+ private:
+  QueryExpression(std::unique_ptr<QueryTerm> root,
+                  BazelPatternBundle patterns);
+
+  std::unique_ptr<QueryTerm> root_;
+  BazelPatternBundle patterns_;
+};
+
+// Build the dependency graph needed for "query" from the packages in
+// "project" and evaluate. Returns the resulting targets sorted.
+std::vector<BazelTarget> RunQuery(Session &session,
+                                  const QueryExpression &query,
+                                  ParsedProject *project);
+}  // namespace bant
+
+#endif  // BANT_EXPLORE_QUERY_EXPRESSION_H
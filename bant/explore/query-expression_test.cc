@@ -0,0 +1,139 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/query-expression.h"
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "bant/frontend/parsed-project_testutil.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+
+namespace bant {
+class QueryExpressionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // a -> b -> c -> d
+    //      b -> e
+    // t (test) -> a
+    pp_.Add("//p", R"(
+cc_library(name = "a", deps = [":b"], tags = ["keep"])
+cc_library(name = "b", deps = [":c", ":e"])
+cc_library(name = "c", deps = ["//q:d"])
+cc_library(name = "e", copts = ["-Wall"])
+cc_test(name = "t", deps = [":a"])
+)");
+    pp_.Add("//q", R"(
+cc_library(name = "d")
+cc_binary(name = "tool", deps = [":d"])
+)");
+  }
+
+  std::vector<std::string> Query(std::string_view expression) {
+    auto query = QueryExpression::Parse(expression, std::cerr);
+    CHECK(query) << expression;
+    Session session(&std::cerr, &std::cerr, CommandlineFlags{});
+    std::vector<std::string> result;
+    for (const BazelTarget &t : RunQuery(session, *query, &pp_.project())) {
+      result.push_back(t.ToString());
+    }
+    return result;
+  }
+
+  ParsedProjectTestUtil pp_;
+};
+
+TEST_F(QueryExpressionTest, Patterns) {
+  EXPECT_THAT(Query("//q:d"), ElementsAre("//q:d"));
+  EXPECT_THAT(Query("//q/..."), ElementsAre("//q:d", "//q:tool"));
+  EXPECT_THAT(Query("'//q:tool'"), ElementsAre("//q:tool"));
+}
+
+TEST_F(QueryExpressionTest, SetOperations) {
+  EXPECT_THAT(Query("//q:d union //p:a"), ElementsAre("//p:a", "//q:d"));
+  EXPECT_THAT(Query("//q:d + //p:a"), ElementsAre("//p:a", "//q:d"));
+  EXPECT_THAT(Query("//q/... intersect //q:d"), ElementsAre("//q:d"));
+  EXPECT_THAT(Query("//q/... ^ //q:d"), ElementsAre("//q:d"));
+  EXPECT_THAT(Query("//q/... except //q:d"), ElementsAre("//q:tool"));
+  EXPECT_THAT(Query("//q/... - //q:d"), ElementsAre("//q:tool"));
+
+  // Left associative, parenthesis group.
+  EXPECT_THAT(Query("//q/... - //q:d + //q:d"),
+              ElementsAre("//q:d", "//q:tool"));
+  EXPECT_THAT(Query("//q/... - (//q:d + //q:d)"), ElementsAre("//q:tool"));
+}
+
+TEST_F(QueryExpressionTest, Deps) {
+  EXPECT_THAT(Query("deps(//p:b)"), ElementsAre("//p:b", "//p:c", "//p:e",
+                                                "//q:d"));
+  EXPECT_THAT(Query("deps(//p:b, 1)"), ElementsAre("//p:b", "//p:c", "//p:e"));
+  EXPECT_THAT(Query("deps(//p:b, 0)"), ElementsAre("//p:b"));
+}
+
+TEST_F(QueryExpressionTest, ReverseDeps) {
+  EXPECT_THAT(Query("rdeps(//..., //p:c)"),
+              ElementsAre("//p:a", "//p:b", "//p:c", "//p:t"));
+  EXPECT_THAT(Query("rdeps(//..., //p:c, 1)"), ElementsAre("//p:b", "//p:c"));
+
+  // Only within the universe.
+  EXPECT_THAT(Query("rdeps(//p:a, //q:d)"),
+              ElementsAre("//p:a", "//p:b", "//p:c", "//q:d"));
+  EXPECT_THAT(Query("rdeps(//..., //q:d) intersect kind(cc_test, //...)"),
+              ElementsAre("//p:t"));
+}
+
+TEST_F(QueryExpressionTest, Paths) {
+  EXPECT_THAT(Query("allpaths(//p:t, //p:c)"),
+              ElementsAre("//p:a", "//p:b", "//p:c", "//p:t"));
+  EXPECT_THAT(Query("somepath(//p:a, //q:d)"),
+              ElementsAre("//p:a", "//p:b", "//p:c", "//q:d"));
+  EXPECT_THAT(Query("somepath(//q:d, //p:a)"), IsEmpty());
+}
+
+TEST_F(QueryExpressionTest, Filters) {
+  EXPECT_THAT(Query("kind(cc_binary, //...)"), ElementsAre("//q:tool"));
+  EXPECT_THAT(Query("kind('cc_(test|binary)', //...)"),
+              ElementsAre("//p:t", "//q:tool"));
+  EXPECT_THAT(Query("filter(':[de]$', //...)"), ElementsAre("//p:e", "//q:d"));
+  EXPECT_THAT(Query("attr(tags, keep, //...)"), ElementsAre("//p:a"));
+  EXPECT_THAT(Query("attr(copts, '^-W', //...)"), ElementsAre("//p:e"));
+  EXPECT_THAT(Query("attr(name, ool, //...)"), ElementsAre("//q:tool"));
+}
+
+TEST_F(QueryExpressionTest, ParseErrors) {
+  for (const std::string_view bad :
+       {"", "deps(", "deps(//p:a", "deps(//p:a, x)", "deps(//p:a, -1)",
+        "unknown(//p:a)", "//p:a union", "(//p:a", "//p:a )",
+        "kind('(', //p:a)", "attr(tags, //p:a)"}) {
+    std::stringstream error;
+    EXPECT_EQ(QueryExpression::Parse(bad, error), nullptr) << bad;
+    EXPECT_THAT(error.str(), HasSubstr("query:1:")) << bad;
+  }
+}
+}  // namespace bant
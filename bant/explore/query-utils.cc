@@ -17,193 +17,243 @@
 
 #include "bant/explore/query-utils.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <initializer_list>
+#include <optional>
 #include <string_view>
 #include <vector>
 
-#include "absl/container/flat_hash_set.h"
 #include "bant/frontend/ast.h"
 
 namespace bant::query {
 namespace {
-// TODO: these of course need to be configurable. Ideally with a simple
-// path query language.
-class TargetFinder : public BaseVoidVisitor {
- public:
-  TargetFinder(std::initializer_list<std::string_view> rules_of_interest,
-               bool allow_empty_name, const TargetFindCallback &cb)
-      : of_interest_(rules_of_interest),
-        allow_empty_name_(allow_empty_name),
-        found_cb_(cb) {}
-
-  void VisitFunCall(FunCall *f) final {
-    if (in_relevant_call_ != Relevancy::kNotRelevant) {
-      BaseVoidVisitor::VisitFunCall(f);  // Nesting.
-      return;
-    }
-    in_relevant_call_ = IsRelevant(f->identifier()->id());
-    if (in_relevant_call_ == Relevancy::kNotRelevant) return;
-
-    current_ = {};
-    current_.node = f;
-    current_.rule = f->identifier()->id();
-    for (Node *element : *f->argument()) {
-      WalkNonNull(element);
-    }
-    if (in_relevant_call_ == Relevancy::kUserQuery) {
-      InformCaller();
+// Keyword names, indexed by Attribute.
+constexpr std::array<std::string_view,
+                     static_cast<size_t>(Attribute::kNumAttributes)>
+  kAttributeKeywords = {
+    "name",                  // kName
+    "actual",                // kActual
+    "version",               // kVersion
+    "repo_name",             // kRepoName
+    "deprecation",           // kDeprecation
+    "srcs",                  // kSrcs
+    "hdrs",                  // kHdrs
+    "textual_hdrs",          // kTextualHdrs
+    "public_hdrs",           // kPublicHdrs
+    "deps",                  // kDeps
+    "outs",                  // kOuts
+    "visibility",            // kVisibility
+    "includes",              // kIncludes
+    "include_prefix",        // kIncludePrefix
+    "strip_include_prefix",  // kStripIncludePrefix
+    "strip_import_prefix",   // kStripImportPrefix
+    "alwayslink",            // kAlwayslink
+    "testonly",              // kTestonly
+};
+
+// Longest keyword is used to size the by-length lookup below.
+constexpr size_t kMaxKeywordLen = 20;
+
+// Keywords bucketed by length, so that only a handful of candidates with
+// the same length need a string compare.
+struct KeywordsByLength {
+  constexpr KeywordsByLength() {
+    for (size_t i = 0; i < kAttributeKeywords.size(); ++i) {
+      const size_t len = kAttributeKeywords[i].size();
+      bucket[len][count[len]++] = static_cast<Attribute>(i);
     }
-    in_relevant_call_ = Relevancy::kNotRelevant;
   }
+  static constexpr size_t kMaxPerBucket = 5;  // name, srcs, hdrs, deps, outs
+  size_t count[kMaxKeywordLen + 1] = {};
+  Attribute bucket[kMaxKeywordLen + 1][kMaxPerBucket] = {};
+};
+constexpr KeywordsByLength kKeywordsByLength;
 
-  // Assignment we see in a keyword argument inside a function call.
-  void VisitAssignment(Assignment *a) final {
-    switch (in_relevant_call_) {
-    case Relevancy::kPackageInfo: ExtractPackageInfo(a); break;
-    case Relevancy::kUserQuery: ExtractQueryInfo(a); break;
-    default: break;
-    }
+void AssignString(Node *value, std::string_view *out) {
+  if (Scalar *scalar = value->CastAsScalar()) *out = scalar->AsString();
+}
+
+void AssignList(Node *value, List **out) {
+  if (List *list = value->CastAsList()) *out = list;
+}
+
+void AssignBool(Node *value, bool *out) {
+  if (Scalar *scalar = value->CastAsScalar()) {
+    *out = scalar->AsInt();
+  } else if (Identifier *id = value->CastAsIdentifier()) {
+    // If the value has been a 'True' constant, the constant expression
+    // eval will be flattening that to a scalar once implemented.
+    // But until then, we need to check for the constant symbol manually.
+    *out = (id->id() == "True");
+  }
+}
+
+// Rules of interest given at runtime. Typically only a handful, so a linear
+// search is cheaper than building a hash set each time.
+class RuleList {
+ public:
+  explicit RuleList(std::initializer_list<std::string_view> rules)
+      : rules_(rules) {}
+
+  bool Match(std::string_view rule) const {
+    if (rules_.size() == 0) return true;
+    return std::find(rules_.begin(), rules_.end(), rule) != rules_.end();
   }
 
  private:
-  enum class Relevancy {
-    kNotRelevant,  // Not currently in any interesting function call.
-    kUserQuery,    // Function call interesting because user asked for it.
-    kPackageInfo   // Interesting because it contains package info.
-  };
-
-  // Relevant info we're interested in the package.
-  void ExtractPackageInfo(Assignment *a) {
-    if (!a->maybe_identifier() || !a->value()) return;
-    const std::string_view lhs = a->maybe_identifier()->id();
-    if (List *list = a->value()->CastAsList()) {
-      if (lhs == "default_visibility") {
-        package_default_visibility_ = list;
-      }
-    }
+  const std::initializer_list<std::string_view> rules_;
+};
+}  // namespace
+
+namespace internal {
+TargetCollector::TargetCollector(AttributeMask attributes,
+                                 bool allow_empty_name)
+    : attributes_(EffectiveAttributes(attributes)),
+      allow_empty_name_(allow_empty_name) {}
+
+bool TargetCollector::CollectFromCall(FunCall *f, Relevancy relevancy) {
+  if (relevancy == Relevancy::kNotRelevant) return false;
+  in_relevant_call_ = relevancy;
+  current_ = {};
+  current_.node = f;
+  current_.rule = f->identifier()->id();
+  for (Node *element : *f->argument()) {
+    WalkNonNull(element);
   }
+  in_relevant_call_ = Relevancy::kNotRelevant;
+  return relevancy == Relevancy::kUserQuery && FinishResult();
+}
 
-  // Value extracted for the user query.
-  void ExtractQueryInfo(Assignment *a) {
-    if (!a->maybe_identifier() || !a->value()) return;
-    const std::string_view lhs = a->maybe_identifier()->id();
-    if (Scalar *scalar = a->value()->CastAsScalar()) {
-      if (lhs == "name") {
-        current_.name = scalar->AsString();
-      } else if (lhs == "alwayslink") {
-        current_.alwayslink = scalar->AsInt();
-      } else if (lhs == "testonly") {
-        current_.testonly = scalar->AsInt();
-      } else if (lhs == "include_prefix") {
-        current_.include_prefix = scalar->AsString();
-      } else if (lhs == "strip_include_prefix") {
-        current_.strip_include_prefix = scalar->AsString();
-      } else if (lhs == "strip_import_prefix") {
-        current_.strip_import_prefix = scalar->AsString();
-      } else if (lhs == "version") {
-        current_.version = scalar->AsString();
-      } else if (lhs == "repo_name") {
-        current_.repo_name = scalar->AsString();
-      } else if (lhs == "actual") {
-        current_.actual = scalar->AsString();
-      } else if (lhs == "deprecation") {
-        current_.deprecation = scalar->AsString();
-      }
-    } else if (List *list = a->value()->CastAsList()) {
-      if (lhs == "hdrs") {
-        current_.hdrs_list = list;
-      } else if (lhs == "srcs") {
-        current_.srcs_list = list;
-      } else if (lhs == "deps") {
-        current_.deps_list = list;
-      } else if (lhs == "includes") {
-        current_.includes_list = list;
-      } else if (lhs == "outs") {
-        current_.outs_list = list;
-      } else if (lhs == "visibility") {
-        current_.visibility = list;
-      } else if (lhs == "textual_hdrs") {
-        current_.textual_hdrs = list;
-      } else if (lhs == "public_hdrs") {
-        current_.public_hdrs = list;
-      }
-    } else if (Identifier *id = a->value()->CastAsIdentifier()) {
-      // If alwayslink has been a 'True' constant, the constant expression
-      // eval will be flattening that to a scalar once implemented.
-      // But until then, we need to check for the constant symbol manually.
-      if (lhs == "alwayslink") {
-        current_.alwayslink = (id->id() == "True");
-      } else if (lhs == "testonly") {
-        current_.testonly = (id->id() == "True");
-      }
-    }
+void TargetCollector::VisitAssignment(Assignment *a) {
+  switch (in_relevant_call_) {
+  case Relevancy::kPackageInfo: ExtractPackageInfo(a); break;
+  case Relevancy::kUserQuery: ExtractQueryInfo(a); break;
+  default: break;
   }
+}
 
-  void InformCaller() {
-    if (!allow_empty_name_ && current_.name.empty()) return;
-    // If we never got a hdrs list (or couldn't read it because
-    // it was a glob), assume this is an alwayslink library, so it wouldn't be
-    // considered for removal by DWYU (e.g. :gtest_main)
-    // TODO: figure out what the actual semantics is in bazel.
-    if (current_.rule == "cc_library" &&
-        (!current_.hdrs_list || current_.hdrs_list->empty())) {
-      current_.alwayslink = true;
-    }
-    if (current_.visibility == nullptr) {
-      current_.visibility = package_default_visibility_;
+void TargetCollector::ExtractPackageInfo(Assignment *a) {
+  if (!a->maybe_identifier() || !a->value()) return;
+  const std::string_view lhs = a->maybe_identifier()->id();
+  if (List *list = a->value()->CastAsList()) {
+    if (lhs == "default_visibility") {
+      package_default_visibility_ = list;
     }
-    found_cb_(current_);
   }
+}
 
-  Relevancy IsRelevant(std::string_view name) const {
-    if (name == "package") return Relevancy::kPackageInfo;
-    if (of_interest_.empty()) return Relevancy::kUserQuery;
-    return of_interest_.contains(name) ? Relevancy::kUserQuery
-                                       : Relevancy::kNotRelevant;
+void TargetCollector::ExtractQueryInfo(Assignment *a) {
+  if (!a->maybe_identifier() || !a->value()) return;
+  const std::optional<Attribute> attribute =
+    AttributeFromKeyword(a->maybe_identifier()->id());
+  if (!attribute.has_value() || !attributes_.contains(*attribute)) return;
+  Node *const value = a->value();
+  switch (*attribute) {
+  case Attribute::kName: AssignString(value, &current_.name); break;
+  case Attribute::kActual: AssignString(value, &current_.actual); break;
+  case Attribute::kVersion: AssignString(value, &current_.version); break;
+  case Attribute::kRepoName: AssignString(value, &current_.repo_name); break;
+  case Attribute::kDeprecation:
+    AssignString(value, &current_.deprecation);
+    break;
+  case Attribute::kSrcs: AssignList(value, &current_.srcs_list); break;
+  case Attribute::kHdrs: AssignList(value, &current_.hdrs_list); break;
+  case Attribute::kTextualHdrs:
+    AssignList(value, &current_.textual_hdrs);
+    break;
+  case Attribute::kPublicHdrs: AssignList(value, &current_.public_hdrs); break;
+  case Attribute::kDeps: AssignList(value, &current_.deps_list); break;
+  case Attribute::kOuts: AssignList(value, &current_.outs_list); break;
+  case Attribute::kVisibility: AssignList(value, &current_.visibility); break;
+  case Attribute::kIncludes: AssignList(value, &current_.includes_list); break;
+  case Attribute::kIncludePrefix:
+    AssignString(value, &current_.include_prefix);
+    break;
+  case Attribute::kStripIncludePrefix:
+    AssignString(value, &current_.strip_include_prefix);
+    break;
+  case Attribute::kStripImportPrefix:
+    AssignString(value, &current_.strip_import_prefix);
+    break;
+  case Attribute::kAlwayslink: AssignBool(value, &current_.alwayslink); break;
+  case Attribute::kTestonly: AssignBool(value, &current_.testonly); break;
+  case Attribute::kNumAttributes: break;
   }
+}
 
-  // The package should come early in the file, so we should have gathered
-  // the default visibility once we hit an actual rule.
-  List *package_default_visibility_ = nullptr;
+bool TargetCollector::FinishResult() {
+  if (!allow_empty_name_ && current_.name.empty()) return false;
+  // If we never got a hdrs list (or couldn't read it because
+  // it was a glob), assume this is an alwayslink library, so it wouldn't be
+  // considered for removal by DWYU (e.g. :gtest_main)
+  // TODO: figure out what the actual semantics is in bazel.
+  if (attributes_.contains(Attribute::kAlwayslink) &&
+      current_.rule == "cc_library" &&
+      (!current_.hdrs_list || current_.hdrs_list->empty())) {
+    current_.alwayslink = true;
+  }
+  if (current_.visibility == nullptr &&
+      attributes_.contains(Attribute::kVisibility)) {
+    current_.visibility = package_default_visibility_;
+  }
+  return true;
+}
 
-  // TODO: this assumes library call being a toplevel function; might need
-  // stack here if nested (though we might just deal with that in a separate
-  // transformation expanding list comprehensions).
-  Result current_;
+// Name is always needed to decide if we report a target; the implicit
+// alwayslink decision needs to know about hdrs.
+AttributeMask TargetCollector::EffectiveAttributes(AttributeMask requested) {
+  AttributeMask result = requested | AttributeMask{Attribute::kName};
+  if (requested.contains(Attribute::kAlwayslink)) {
+    result = result | AttributeMask{Attribute::kHdrs};
+  }
+  return result;
+}
+}  // namespace internal
 
-  Relevancy in_relevant_call_ = Relevancy::kNotRelevant;
-  const absl::flat_hash_set<std::string_view> of_interest_;
-  const bool allow_empty_name_;
-  const TargetFindCallback &found_cb_;
-};
-}  // namespace
+std::optional<Attribute> AttributeFromKeyword(std::string_view keyword) {
+  const size_t len = keyword.size();
+  if (len > kMaxKeywordLen) return std::nullopt;
+  for (size_t i = 0; i < kKeywordsByLength.count[len]; ++i) {
+    const Attribute candidate = kKeywordsByLength.bucket[len][i];
+    if (kAttributeKeywords[static_cast<size_t>(candidate)] == keyword) {
+      return candidate;
+    }
+  }
+  return std::nullopt;
+}
 
 void FindTargets(Node *ast,
                  std::initializer_list<std::string_view> rules_of_interest,
                  const TargetFindCallback &cb) {
-  TargetFinder(rules_of_interest, false, cb).WalkNonNull(ast);
+  FindTargets(ast, rules_of_interest, kAllAttributes, cb);
+}
+
+void FindTargets(Node *ast,
+                 std::initializer_list<std::string_view> rules_of_interest,
+                 AttributeMask attributes, const TargetFindCallback &cb) {
+  internal::TargetFinder<RuleList, const TargetFindCallback> finder(
+    RuleList(rules_of_interest), attributes, false, cb);
+  finder.WalkNonNull(ast);
 }
 
 void FindTargetsAllowEmptyName(
   Node *ast, std::initializer_list<std::string_view> rules_of_interest,
   const TargetFindCallback &cb) {
-  TargetFinder(rules_of_interest, true, cb).WalkNonNull(ast);
+  FindTargetsAllowEmptyName(ast, rules_of_interest, kAllAttributes, cb);
 }
 
-void AppendStringList(List *list, std::vector<std::string_view> &append_to) {
-  if (list == nullptr) return;
-  for (Node *n : *list) {
-    Scalar *scalar = n->CastAsScalar();
-    if (!scalar) continue;
-    if (const std::string_view str = scalar->AsString(); !str.empty()) {
-      append_to.push_back(str);
-    }
-  }
+void FindTargetsAllowEmptyName(
+  Node *ast, std::initializer_list<std::string_view> rules_of_interest,
+  AttributeMask attributes, const TargetFindCallback &cb) {
+  internal::TargetFinder<RuleList, const TargetFindCallback> finder(
+    RuleList(rules_of_interest), attributes, true, cb);
+  finder.WalkNonNull(ast);
 }
 
 std::vector<std::string_view> ExtractStringList(List *list) {
-  std::vector<std::string_view> result;
-  AppendStringList(list, result);
-  return result;
+  const StringListView view(list);
+  return {view.begin(), view.end()};
 }
 }  // namespace bant::query
@@ -18,11 +18,20 @@
 #ifndef BANT_QUERY_UTILS_
 #define BANT_QUERY_UTILS_
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <optional>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
 #include "bant/frontend/ast.h"
 
 namespace bant::query {
@@ -53,9 +62,185 @@ struct Result {
   bool testonly = false;
 };
 
+// Keyword arguments FindTargets() knows about, each one filling a field
+// in Result. Used to request only the attributes needed.
+enum class Attribute : uint8_t {
+  kName,
+  kActual,
+  kVersion,
+  kRepoName,
+  kDeprecation,
+  kSrcs,
+  kHdrs,
+  kTextualHdrs,
+  kPublicHdrs,
+  kDeps,
+  kOuts,
+  kVisibility,
+  kIncludes,
+  kIncludePrefix,
+  kStripIncludePrefix,
+  kStripImportPrefix,
+  kAlwayslink,
+  kTestonly,
+  kNumAttributes,  // Not an attribute, just counting.
+};
+
+// Set of attributes to be extracted. Cheap bitset, usable as constexpr.
+class AttributeMask {
+ public:
+  constexpr AttributeMask() = default;
+  constexpr AttributeMask(std::initializer_list<Attribute> attributes) {
+    for (const Attribute a : attributes) bits_ |= Bit(a);
+  }
+
+  static constexpr AttributeMask All() {
+    AttributeMask result;
+    result.bits_ = Bit(Attribute::kNumAttributes) - 1;
+    return result;
+  }
+
+  constexpr bool contains(Attribute a) const { return (bits_ & Bit(a)) != 0; }
+
+  constexpr AttributeMask operator|(AttributeMask other) const {
+    AttributeMask result;
+    result.bits_ = bits_ | other.bits_;
+    return result;
+  }
+
+  constexpr bool operator==(const AttributeMask &) const = default;
+
+ private:
+  static constexpr uint32_t Bit(Attribute a) {
+    return uint32_t(1) << static_cast<int>(a);
+  }
+  uint32_t bits_ = 0;
+};
+static_assert(static_cast<int>(Attribute::kNumAttributes) < 32);
+
+// Default for FindTargets(): extract everything.
+inline constexpr AttributeMask kAllAttributes = AttributeMask::All();
+
+// Map keyword argument name to the attribute; nullopt if it is not one we
+// extract.
+std::optional<Attribute> AttributeFromKeyword(std::string_view keyword);
+
 // Callback of a query.
 using TargetFindCallback = std::function<void(const Result &)>;
 
+// A set of rule names known at compile time, kept sorted so that a lookup
+// is a binary search without any allocation. An empty set matches all rules.
+//   static constexpr query::RuleSet kRules{"cc_library", "cc_binary"};
+template <size_t N>
+class RuleSet {
+ public:
+  template <typename... T>
+  consteval explicit RuleSet(const T &...rules)
+      : rules_{std::string_view(rules)...} {
+    std::sort(rules_.begin(), rules_.end());
+  }
+
+  constexpr bool Match(std::string_view rule) const {
+    if constexpr (N == 0) {
+      return true;
+    } else {
+      return std::binary_search(rules_.begin(), rules_.end(), rule);
+    }
+  }
+
+ private:
+  std::array<std::string_view, N> rules_;
+};
+template <typename... T>
+RuleSet(const T &...) -> RuleSet<sizeof...(T)>;
+
+namespace internal {
+// The part of the target finder independent of the rule matching and
+// callback: gathers the attributes of relevant function calls in a Result.
+class TargetCollector : public BaseVoidVisitor {
+ public:
+  TargetCollector(AttributeMask attributes, bool allow_empty_name);
+
+  // Assignment we see in a keyword argument inside a function call.
+  void VisitAssignment(Assignment *a) final;
+
+ protected:
+  enum class Relevancy {
+    kNotRelevant,  // Not currently in any interesting function call.
+    kUserQuery,    // Function call interesting because user asked for it.
+    kPackageInfo   // Interesting because it contains package info.
+  };
+
+  bool InRelevantCall() const {
+    return in_relevant_call_ != Relevancy::kNotRelevant;
+  }
+
+  // Gather the attributes of function call "f". Returns true, if this
+  // resulted in a Result in current() to be reported to the caller.
+  bool CollectFromCall(FunCall *f, Relevancy relevancy);
+
+  const Result &current() const { return current_; }
+
+ private:
+  // Relevant info we're interested in the package.
+  void ExtractPackageInfo(Assignment *a);
+
+  // Value extracted for the user query.
+  void ExtractQueryInfo(Assignment *a);
+
+  // Fill in implicit values. Returns if current_ should be reported.
+  bool FinishResult();
+
+  static AttributeMask EffectiveAttributes(AttributeMask requested);
+
+  // The package should come early in the file, so we should have gathered
+  // the default visibility once we hit an actual rule.
+  List *package_default_visibility_ = nullptr;
+
+  // TODO: this assumes library call being a toplevel function; might need
+  // stack here if nested (though we might just deal with that in a separate
+  // transformation expanding list comprehensions).
+  Result current_;
+
+  Relevancy in_relevant_call_ = Relevancy::kNotRelevant;
+  const AttributeMask attributes_;
+  const bool allow_empty_name_;
+};
+
+// TODO: these of course need to be configurable. Ideally with a simple
+// path query language.
+// RuleMatcher needs to provide a bool Match(std::string_view rule) method.
+template <typename RuleMatcher, typename Callback>
+class TargetFinder final : public TargetCollector {
+ public:
+  TargetFinder(const RuleMatcher &rules, AttributeMask attributes,
+               bool allow_empty_name, Callback &cb)
+      : TargetCollector(attributes, allow_empty_name),
+        rules_(rules),
+        found_cb_(cb) {}
+
+  void VisitFunCall(FunCall *f) final {
+    if (InRelevantCall()) {
+      BaseVoidVisitor::VisitFunCall(f);  // Nesting.
+      return;
+    }
+    if (CollectFromCall(f, IsRelevant(f->identifier()->id()))) {
+      found_cb_(current());
+    }
+  }
+
+ private:
+  Relevancy IsRelevant(std::string_view name) const {
+    if (name == "package") return Relevancy::kPackageInfo;
+    return rules_.Match(name) ? Relevancy::kUserQuery
+                              : Relevancy::kNotRelevant;
+  }
+
+  const RuleMatcher rules_;
+  Callback &found_cb_;
+};
+}  // namespace internal
+
 // Walk the "ast" and find all the targets that match any of the given
 // "rules_of_interest" names (such as 'cc_library'). If list empty: match all.
 // Provides callback with all the relevant information gathered in a
@@ -66,10 +251,104 @@ void FindTargets(Node *ast,
                  std::initializer_list<std::string_view> rules_of_interest,
                  const TargetFindCallback &cb);
 
+// Same as above, but only extract the "attributes" the caller is interested
+// in; all other fields in Result stay at their default value. The rule name
+// and node are always filled.
+void FindTargets(Node *ast,
+                 std::initializer_list<std::string_view> rules_of_interest,
+                 AttributeMask attributes, const TargetFindCallback &cb);
+
 // Same as above, but allow the name to be empty.
 void FindTargetsAllowEmptyName(
   Node *ast, std::initializer_list<std::string_view> rules_of_interest,
   const TargetFindCallback &cb);
+void FindTargetsAllowEmptyName(
+  Node *ast, std::initializer_list<std::string_view> rules_of_interest,
+  AttributeMask attributes, const TargetFindCallback &cb);
+
+// Same as above, but with the rules of interest known at compile time and
+// the callback called directly (e.g. a lambda), so that it can be inlined.
+// Preferable in loops over all files of a project.
+template <size_t N, typename Callback>
+void FindTargets(Node *ast, const RuleSet<N> &rules_of_interest,
+                 AttributeMask attributes, Callback &&cb) {
+  internal::TargetFinder<RuleSet<N>, std::remove_reference_t<Callback>> finder(
+    rules_of_interest, attributes, false, cb);
+  finder.WalkNonNull(ast);
+}
+
+// A lightweight view over the non-empty strings in a list-node, such as
+// srcs or deps. Iterating it yields the strings without allocating.
+// A nullptr list is an empty range.
+// The original string-views are preserved, so can be used to recover the
+// location in file.
+class StringListView {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    iterator() = default;
+
+    std::string_view operator*() const { return current_; }
+    iterator &operator++() {
+      ++it_;
+      SkipToNonEmptyString();
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator result = *this;
+      ++*this;
+      return result;
+    }
+    bool operator==(const iterator &other) const { return it_ == other.it_; }
+
+   private:
+    friend class StringListView;
+    using ListIterator = decltype(std::declval<List>().begin());
+
+    iterator(ListIterator it, ListIterator end) : it_(it), end_(end) {
+      SkipToNonEmptyString();
+    }
+
+    void SkipToNonEmptyString() {
+      for (/**/; it_ != end_; ++it_) {
+        Scalar *scalar = (*it_)->CastAsScalar();
+        if (!scalar) continue;
+        current_ = scalar->AsString();
+        if (!current_.empty()) return;
+      }
+    }
+
+    ListIterator it_;
+    ListIterator end_;
+    std::string_view current_;
+  };
+
+  using value_type = std::string_view;
+  using const_iterator = iterator;
+
+  explicit StringListView(List *list) : list_(list) {}
+
+  iterator begin() const {
+    return list_ ? iterator(list_->begin(), list_->end()) : iterator();
+  }
+  iterator end() const {
+    return list_ ? iterator(list_->end(), list_->end()) : iterator();
+  }
+  bool empty() const { return begin() == end(); }
+
+ private:
+  List *list_;
+};
+
+// For callers who need to collect strings from lists with random access.
+// Most lists are short, so typically fits without heap allocation.
+using StringList = absl::InlinedVector<std::string_view, 16>;
 
 // Utility function: extract list of non-empty strings from list-node and
 // return as vector.
@@ -77,8 +356,14 @@ void FindTargetsAllowEmptyName(
 // location in file.
 std::vector<std::string_view> ExtractStringList(List *list);
 
-// Similar to ExtractStringList(), but append to vector.
-void AppendStringList(List *list, std::vector<std::string_view> &append_to);
+// Similar to ExtractStringList(), but append to a vector-like container,
+// e.g. std::vector<std::string_view> or StringList.
+template <typename Container>
+void AppendStringList(List *list, Container &append_to) {
+  for (const std::string_view str : StringListView(list)) {
+    append_to.push_back(str);
+  }
+}
 
 }  // namespace bant::query
 
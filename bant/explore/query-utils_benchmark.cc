@@ -0,0 +1,155 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "absl/strings/str_cat.h"
+#include "bant/explore/query-utils.h"
+#include "bant/frontend/parsed-project.h"
+#include "bant/frontend/parsed-project_testutil.h"
+#include "benchmark/benchmark.h"
+
+namespace bant::query {
+namespace {
+// Creates a project with "packages" BUILD files, each containing a
+// handful of typical rules with a realistic amount of keyword arguments.
+class SyntheticProject {
+ public:
+  explicit SyntheticProject(int packages) {
+    for (int p = 0; p < packages; ++p) {
+      std::string content;
+      absl::StrAppend(&content, "package(default_visibility = "
+                                "[\"//visibility:public\"])\n");
+      for (int i = 0; i < 8; ++i) {
+        absl::StrAppend(&content, "cc_library(\n",                        //
+                        "  name = \"lib", i, "\",\n",                     //
+                        "  srcs = [\"lib", i, ".cc\", \"impl", i, ".cc\"],\n",
+                        "  hdrs = [\"lib", i, ".h\"],\n",                 //
+                        "  copts = [\"-Wall\", \"-Wextra\"],\n",          //
+                        "  includes = [\".\"],\n",                        //
+                        "  strip_include_prefix = \"/pkg\",\n",           //
+                        "  deps = [\n",                                   //
+                        "    \":lib", (i + 1) % 8, "\",\n",               //
+                        "    \"//pkg", (p + 1) % packages, ":lib", i, "\",\n",
+                        "    \"@abseil-cpp//absl/strings\",\n",           //
+                        "  ],\n",                                         //
+                        "  visibility = [\"//visibility:public\"],\n",    //
+                        ")\n");
+      }
+      absl::StrAppend(&content,                               //
+                      "alias(name = \"alias\", actual = \":lib0\")\n",
+                      "cc_test(\n",                           //
+                      "  name = \"lib_test\",\n",             //
+                      "  srcs = [\"lib_test.cc\"],\n",        //
+                      "  deps = [\":lib0\", \":lib1\"],\n",  //
+                      ")\n",                                  //
+                      "genrule(\n",                           //
+                      "  name = \"gen\",\n",                  //
+                      "  outs = [\"gen.h\"],\n",              //
+                      "  cmd = \"echo > $@\",\n",             //
+                      ")\n");
+      pp_.Add(absl::StrCat("//pkg", p), content);
+    }
+  }
+
+  const ParsedProject &project() { return pp_.project(); }
+
+ private:
+  ParsedProjectTestUtil pp_;
+};
+
+SyntheticProject &GetProject() {
+  static SyntheticProject *const project = new SyntheticProject(2000);
+  return *project;
+}
+
+template <bool kMasked>
+void BM_FindTargetsAlias(benchmark::State &state) {
+  const ParsedProject &project = GetProject().project();
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto &[_, build_file] : project.ParsedFiles()) {
+      const auto cb = [&](const Result &r) { found += r.actual.size(); };
+      if (kMasked) {
+        FindTargets(build_file->ast, {"alias"},
+                    {Attribute::kName, Attribute::kActual}, cb);
+      } else {
+        FindTargets(build_file->ast, {"alias"}, cb);
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+BENCHMARK(BM_FindTargetsAlias<false>);
+BENCHMARK(BM_FindTargetsAlias<true>);
+
+template <bool kMasked>
+void BM_FindTargetsAllRulesDeps(benchmark::State &state) {
+  const ParsedProject &project = GetProject().project();
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto &[_, build_file] : project.ParsedFiles()) {
+      const auto cb = [&](const Result &r) {
+        found += (r.deps_list != nullptr);
+      };
+      if (kMasked) {
+        FindTargets(build_file->ast, {}, {Attribute::kName, Attribute::kDeps},
+                    cb);
+      } else {
+        FindTargets(build_file->ast, {}, cb);
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+BENCHMARK(BM_FindTargetsAllRulesDeps<false>);
+BENCHMARK(BM_FindTargetsAllRulesDeps<true>);
+
+// Compile-time rule set and inlined callback.
+void BM_FindTargetsRuleSet(benchmark::State &state) {
+  static constexpr RuleSet kRules{"cc_library", "cc_binary", "cc_test"};
+  const ParsedProject &project = GetProject().project();
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto &[_, build_file] : project.ParsedFiles()) {
+      FindTargets(build_file->ast, kRules,
+                  {Attribute::kName, Attribute::kDeps},
+                  [&](const Result &r) { found += (r.deps_list != nullptr); });
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+BENCHMARK(BM_FindTargetsRuleSet);
+
+// Same with rules given at runtime.
+void BM_FindTargetsRuleList(benchmark::State &state) {
+  const ParsedProject &project = GetProject().project();
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto &[_, build_file] : project.ParsedFiles()) {
+      FindTargets(build_file->ast, {"cc_library", "cc_binary", "cc_test"},
+                  {Attribute::kName, Attribute::kDeps},
+                  [&](const Result &r) { found += (r.deps_list != nullptr); });
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+BENCHMARK(BM_FindTargetsRuleList);
+}  // namespace
+}  // namespace bant::query
@@ -17,6 +17,10 @@
 
 #include "bant/explore/query-utils.h"
 
+#include <optional>
+#include <string_view>
+#include <vector>
+
 #include "bant/frontend/parsed-project.h"
 #include "bant/frontend/parsed-project_testutil.h"
 #include "gmock/gmock.h"
@@ -93,4 +97,146 @@ cc_library(
     }
   });
 }
+
+TEST(QueryUtils, StringListView) {
+  ParsedProjectTestUtil pp;
+  const ParsedBuildFile *build_file = pp.Add("//", R"(
+cc_library(
+  name = "foo_lib",
+  srcs = ["", "foo.cc", some_variable, "", "bar.cc", ""],
+  hdrs = [],
+)
+)");
+  EXPECT_TRUE(build_file);
+  int count = 0;
+  FindTargets(build_file->ast, {"cc_library"}, [&](const query::Result &found) {
+    ++count;
+    const StringListView srcs(found.srcs_list);
+    EXPECT_FALSE(srcs.empty());
+    EXPECT_THAT(srcs, ElementsAre("foo.cc", "bar.cc"));
+
+    EXPECT_TRUE(StringListView(found.hdrs_list).empty());
+    EXPECT_TRUE(StringListView(found.deps_list).empty());  // nullptr list
+
+    StringList collected;
+    AppendStringList(found.srcs_list, collected);
+    AppendStringList(found.deps_list, collected);
+    AppendStringList(found.srcs_list, collected);
+    EXPECT_THAT(collected, ElementsAre("foo.cc", "bar.cc", "foo.cc", "bar.cc"));
+  });
+  EXPECT_EQ(count, 1);
+}
+
+TEST(QueryUtils, AttributeFromKeyword) {
+  EXPECT_EQ(AttributeFromKeyword("name"), Attribute::kName);
+  EXPECT_EQ(AttributeFromKeyword("deps"), Attribute::kDeps);
+  EXPECT_EQ(AttributeFromKeyword("strip_include_prefix"),
+            Attribute::kStripIncludePrefix);
+  EXPECT_EQ(AttributeFromKeyword("testonly"), Attribute::kTestonly);
+  EXPECT_EQ(AttributeFromKeyword("data"), std::nullopt);
+  EXPECT_EQ(AttributeFromKeyword(""), std::nullopt);
+  EXPECT_EQ(AttributeFromKeyword("some_really_long_keyword_we_dont_know"),
+            std::nullopt);
+}
+
+TEST(QueryUtils, OnlyRequestedAttributesAreExtracted) {
+  ParsedProjectTestUtil pp;
+  const ParsedBuildFile *build_file = pp.Add("//", R"(
+package(
+  default_visibility = ["//visibility:private"],
+)
+alias(
+  name = "foo",
+  actual = ":bar",
+  deps = [":baz"],
+  testonly = True,
+)
+)");
+  EXPECT_TRUE(build_file);
+  int count = 0;
+  FindTargets(build_file->ast, {"alias"},
+              {Attribute::kName, Attribute::kActual},
+              [&](const query::Result &found) {
+                ++count;
+                EXPECT_EQ(found.rule, "alias");
+                EXPECT_EQ(found.name, "foo");
+                EXPECT_EQ(found.actual, ":bar");
+                EXPECT_EQ(found.deps_list, nullptr);
+                EXPECT_EQ(found.visibility, nullptr);
+                EXPECT_FALSE(found.testonly);
+              });
+  EXPECT_EQ(count, 1);
+
+  // Name is always extracted, it is needed to decide if something is found.
+  count = 0;
+  FindTargets(build_file->ast, {"alias"}, {Attribute::kTestonly},
+              [&](const query::Result &found) {
+                ++count;
+                EXPECT_EQ(found.name, "foo");
+                EXPECT_TRUE(found.actual.empty());
+                EXPECT_TRUE(found.testonly);
+              });
+  EXPECT_EQ(count, 1);
+}
+
+TEST(QueryUtils, ImplicitAlwayslinkWithRestrictedAttributes) {
+  ParsedProjectTestUtil pp;
+  const ParsedBuildFile *build_file = pp.Add("//", R"(
+cc_library(
+  name = "no_hdrs",
+  srcs = ["foo.cc"],
+)
+cc_library(
+  name = "with_hdrs",
+  hdrs = ["foo.h"],
+)
+)");
+  EXPECT_TRUE(build_file);
+  FindTargets(build_file->ast, {"cc_library"}, {Attribute::kAlwayslink},
+              [&](const query::Result &found) {
+                EXPECT_EQ(found.alwayslink, found.name == "no_hdrs");
+              });
+}
+
+TEST(QueryUtils, RuleSet) {
+  static constexpr RuleSet kRules{"cc_library", "alias", "cc_binary"};
+  static_assert(kRules.Match("alias"));
+  EXPECT_TRUE(kRules.Match("cc_library"));
+  EXPECT_TRUE(kRules.Match("cc_binary"));
+  EXPECT_FALSE(kRules.Match("cc_test"));
+  EXPECT_FALSE(kRules.Match(""));
+
+  static constexpr RuleSet kAllRules{};
+  EXPECT_TRUE(kAllRules.Match("cc_test"));
+  EXPECT_TRUE(kAllRules.Match("anything"));
+}
+
+TEST(QueryUtils, CompileTimeRuleSetQuery) {
+  ParsedProjectTestUtil pp;
+  const ParsedBuildFile *build_file = pp.Add("//", R"(
+cc_library(
+  name = "foo_lib",
+  hdrs = ["foo.h"],
+)
+cc_binary(
+  name = "foo_bin",
+  deps = [":foo_lib"],
+)
+cc_test(
+  name = "foo_test",
+)
+)");
+  EXPECT_TRUE(build_file);
+  static constexpr RuleSet kRules{"cc_binary", "cc_library"};
+  std::vector<std::string_view> found_names;
+  FindTargets(build_file->ast, kRules, kAllAttributes,
+              [&](const query::Result &found) {
+                found_names.push_back(found.name);
+                if (found.name == "foo_bin") {
+                  EXPECT_THAT(ExtractStringList(found.deps_list),
+                              ElementsAre(":foo_lib"));
+                }
+              });
+  EXPECT_THAT(found_names, ElementsAre("foo_lib", "foo_bin"));
+}
 }  // namespace bant::query
@@ -0,0 +1,198 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/reachability.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "bant/explore/dependency-graph.h"
+#include "bant/explore/target-set.h"
+#include "bant/label-table.h"
+
+namespace bant {
+ReachabilityIndex::ReachabilityIndex(const DependencyGraph &graph)
+    : graph_(graph), node_count_(graph.labels.target_count()) {
+  ComputeComponents();
+}
+
+// Tarjan's strongly connected components algorithm; iterative as graphs can
+// be deep. Components are numbered in the order they are completed, which
+// is a reverse topological order: all components reachable from a component
+// have a smaller number.
+void ReachabilityIndex::ComputeComponents() {
+  constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> index(node_count_, kUnvisited);
+  std::vector<uint32_t> lowlink(node_count_);
+  std::vector<bool> on_stack(node_count_);
+  std::vector<TargetId> stack;
+  struct Frame {
+    TargetId node;
+    uint32_t next_edge;
+  };
+  std::vector<Frame> call_stack;
+  uint32_t next_index = 0;
+
+  component_.assign(node_count_, 0);
+  auto visit = [&](TargetId node) {
+    index[node] = lowlink[node] = next_index++;
+    stack.push_back(node);
+    on_stack[node] = true;
+    call_stack.push_back({node, 0});
+  };
+
+  for (TargetId root = 0; root < node_count_; ++root) {
+    if (index[root] != kUnvisited) continue;
+    visit(root);
+    while (!call_stack.empty()) {
+      Frame &frame = call_stack.back();
+      const auto edges = graph_.depends_on.edges(frame.node);
+      if (frame.next_edge < edges.size()) {
+        const TargetId dep = edges[frame.next_edge++];
+        if (index[dep] == kUnvisited) {
+          visit(dep);  // Note: invalidates frame.
+        } else if (on_stack[dep]) {
+          lowlink[frame.node] = std::min(lowlink[frame.node], index[dep]);
+        }
+        continue;
+      }
+
+      const TargetId node = frame.node;
+      call_stack.pop_back();
+      if (!call_stack.empty()) {
+        const TargetId parent = call_stack.back().node;
+        lowlink[parent] = std::min(lowlink[parent], lowlink[node]);
+      }
+      if (lowlink[node] != index[node]) continue;
+
+      // Node is the root of a component: everything on the stack above it.
+      const uint32_t component = low_.size();
+      auto members_begin = std::find(stack.rbegin(), stack.rend(), node).base();
+      --members_begin;
+      for (auto it = members_begin; it != stack.end(); ++it) {
+        component_[*it] = component;
+        on_stack[*it] = false;
+      }
+      // All components our edges lead to are completed already.
+      uint32_t low = component;
+      uint32_t height = 0;
+      for (auto it = members_begin; it != stack.end(); ++it) {
+        for (const TargetId dep : graph_.depends_on.edges(*it)) {
+          const uint32_t dep_component = component_[dep];
+          if (dep_component == component) continue;
+          low = std::min(low, low_[dep_component]);
+          height = std::max(height, height_[dep_component] + 1);
+        }
+      }
+      low_.push_back(low);
+      height_.push_back(height);
+      stack.erase(members_begin, stack.end());
+    }
+  }
+}
+
+bool ReachabilityIndex::MayReach(TargetId from, TargetId to) const {
+  const uint32_t from_c = component_[from];
+  const uint32_t to_c = component_[to];
+  if (from_c == to_c) return true;
+  // Everything reachable has a smaller number within the interval, reaches
+  // a subset of what we reach, and is closer to the leafs.
+  return to_c < from_c && to_c >= low_[from_c] && low_[to_c] >= low_[from_c] &&
+         height_[to_c] < height_[from_c];
+}
+
+bool ReachabilityIndex::DependsOn(TargetId from, TargetId to) const {
+  if (from == to) return true;
+  if (from >= node_count_ || to >= node_count_) return false;
+  if (!MayReach(from, to)) return false;
+  if (component_[from] == component_[to]) return true;  // Same cycle.
+
+  TargetSet visited(node_count_);
+  std::vector<TargetId> todo = {from};
+  visited.insert(from);
+  while (!todo.empty()) {
+    const TargetId node = todo.back();
+    todo.pop_back();
+    for (const TargetId dep : graph_.depends_on.edges(node)) {
+      if (dep == to) return true;
+      if (!MayReach(dep, to) || !visited.insert(dep)) continue;
+      todo.push_back(dep);
+    }
+  }
+  return false;
+}
+
+std::vector<TargetId> ReachabilityIndex::SomePath(TargetId from,
+                                                  TargetId to) const {
+  if (!DependsOn(from, to)) return {};
+  if (from == to) return {from};
+
+  // Breadth first, remembering where we came from.
+  constexpr TargetId kNone = std::numeric_limits<TargetId>::max();
+  std::vector<TargetId> came_from(node_count_, kNone);
+  std::deque<TargetId> todo = {from};
+  came_from[from] = from;
+  while (!todo.empty()) {
+    const TargetId node = todo.front();
+    todo.pop_front();
+    for (const TargetId dep : graph_.depends_on.edges(node)) {
+      if (came_from[dep] != kNone || !MayReach(dep, to)) continue;
+      came_from[dep] = node;
+      if (dep == to) {
+        std::vector<TargetId> path = {to};
+        for (TargetId n = to; n != from; n = came_from[n]) {
+          path.push_back(came_from[n]);
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+      }
+      todo.push_back(dep);
+    }
+  }
+  return {};  // Not reached, as DependsOn() confirmed.
+}
+
+TargetSet ReachabilityIndex::Closure(const TargetAdjacency &adjacency,
+                                     const TargetSet &start, int max_depth) {
+  TargetSet result = start;
+  std::vector<TargetId> frontier = start.ToVector();
+  std::vector<TargetId> next_frontier;
+  for (int depth = 0; !frontier.empty() && depth != max_depth; ++depth) {
+    next_frontier.clear();
+    for (const TargetId node : frontier) {
+      for (const TargetId adjacent : adjacency.edges(node)) {
+        if (result.insert(adjacent)) next_frontier.push_back(adjacent);
+      }
+    }
+    frontier.swap(next_frontier);
+  }
+  return result;
+}
+
+TargetSet ReachabilityIndex::TransitiveDependencies(const TargetSet &start,
+                                                    int max_depth) const {
+  return Closure(graph_.depends_on, start, max_depth);
+}
+
+TargetSet ReachabilityIndex::TransitiveDependents(const TargetSet &start,
+                                                  int max_depth) const {
+  return Closure(graph_.has_dependents, start, max_depth);
+}
+}  // namespace bant
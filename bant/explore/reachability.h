@@ -0,0 +1,85 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_EXPLORE_REACHABILITY_H
+#define BANT_EXPLORE_REACHABILITY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "bant/explore/dependency-graph.h"
+#include "bant/explore/target-set.h"
+#include "bant/label-table.h"
+
+namespace bant {
+// Answers transitive questions on a DependencyGraph: all (reverse)
+// dependencies of targets, if one target depends on another, and a path
+// between them.
+//
+// Built once per graph in linear time and memory: the strongly connected
+// components of the graph are numbered in reverse topological order and each
+// gets an interval that contains the numbers of all components reachable
+// from it, plus its longest distance to a leaf. These quickly rule out most
+// targets that can not reach a destination, so searches stay small. No
+// quadratic closure is stored.
+class ReachabilityIndex {
+ public:
+  // The graph must outlive the index.
+  explicit ReachabilityIndex(const DependencyGraph &graph);
+
+  // Returns true if "to" is reachable from "from" following dependencies,
+  // i.e. if "from" transitively depends on "to". True if from == to.
+  bool DependsOn(TargetId from, TargetId to) const;
+
+  // All targets reachable from "start" following dependencies (or dependents
+  // for the reverse) up to "max_depth" steps; unlimited if negative.
+  // The result includes "start".
+  TargetSet TransitiveDependencies(const TargetSet &start,
+                                   int max_depth = -1) const;
+  TargetSet TransitiveDependents(const TargetSet &start,
+                                 int max_depth = -1) const;
+
+  // Shortest dependency path from "from" to "to", including both ends.
+  // Empty if there is none.
+  std::vector<TargetId> SomePath(TargetId from, TargetId to) const;
+
+  // Number of strongly connected components; less than the number of
+  // targets if there are dependency cycles.
+  uint32_t component_count() const { return low_.size(); }
+
+ private:
+  void ComputeComponents();
+
+  // Cheap necessary condition for "to" being reachable from "from". If
+  // false, it is certainly not; if true, it might be.
+  bool MayReach(TargetId from, TargetId to) const;
+
+  static TargetSet Closure(const TargetAdjacency &adjacency,
+                           const TargetSet &start, int max_depth);
+
+  const DependencyGraph &graph_;
+  uint32_t node_count_;
+  std::vector<uint32_t> component_;  // TargetId -> component number.
+
+  // Per component: smallest component number reachable, and length of the
+  // longest path to a component without dependencies.
+  std::vector<uint32_t> low_;
+  std::vector<uint32_t> height_;
+};
+}  // namespace bant
+
+#endif  // BANT_EXPLORE_REACHABILITY_H
@@ -0,0 +1,176 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/explore/reachability.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "bant/explore/dependency-graph.h"
+#include "bant/explore/target-set.h"
+#include "bant/frontend/parsed-project_testutil.h"
+#include "bant/label-table.h"
+#include "bant/session.h"
+#include "bant/types-bazel.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+namespace bant {
+class ReachabilityTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // a -> b -> c -> d
+    //      b -> e
+    // x -> y -> x (cycle), y -> c
+    pp_.Add("//p", R"(
+cc_library(name = "a", deps = [":b"])
+cc_library(name = "b", deps = [":c", ":e"])
+cc_library(name = "c", deps = [":d"])
+cc_library(name = "d")
+cc_library(name = "e")
+cc_library(name = "x", deps = [":y"])
+cc_library(name = "y", deps = [":x", ":c"])
+)");
+    auto pattern = BazelPattern::ParseFrom("//...");
+    CHECK(pattern.has_value());
+    Session session(&std::cerr, &std::cerr, CommandlineFlags{});
+    graph_ = BuildDependencyGraph(session, *pattern, 10, &pp_.project());
+  }
+
+  TargetId Id(std::string_view name) const {
+    auto target = BazelTarget::ParseFrom(name, BazelPackage("", "p"));
+    CHECK(target.has_value());
+    auto id = graph_.labels.FindTarget(*target);
+    CHECK(id.has_value()) << name;
+    return *id;
+  }
+
+  TargetSet Set(std::vector<std::string_view> names) const {
+    TargetSet result;
+    for (std::string_view n : names) result.insert(Id(n));
+    return result;
+  }
+
+  std::vector<std::string> Names(const TargetSet &set) const {
+    std::vector<std::string> result;
+    set.ForEach([&](TargetId id) {
+      result.push_back(graph_.labels.target(id).target_name);
+    });
+    return result;
+  }
+
+  std::vector<std::string> Names(const std::vector<TargetId> &path) const {
+    std::vector<std::string> result;
+    for (const TargetId id : path) {
+      result.push_back(graph_.labels.target(id).target_name);
+    }
+    return result;
+  }
+
+  ParsedProjectTestUtil pp_;
+  DependencyGraph graph_;
+};
+
+TEST_F(ReachabilityTest, DependsOn) {
+  const ReachabilityIndex index(graph_);
+  EXPECT_TRUE(index.DependsOn(Id(":a"), Id(":b")));
+  EXPECT_TRUE(index.DependsOn(Id(":a"), Id(":d")));
+  EXPECT_TRUE(index.DependsOn(Id(":a"), Id(":e")));
+  EXPECT_TRUE(index.DependsOn(Id(":a"), Id(":a")));
+  EXPECT_FALSE(index.DependsOn(Id(":d"), Id(":a")));
+  EXPECT_FALSE(index.DependsOn(Id(":e"), Id(":d")));
+  EXPECT_FALSE(index.DependsOn(Id(":a"), Id(":x")));
+
+  // In and out of cycles.
+  EXPECT_TRUE(index.DependsOn(Id(":x"), Id(":y")));
+  EXPECT_TRUE(index.DependsOn(Id(":y"), Id(":x")));
+  EXPECT_TRUE(index.DependsOn(Id(":x"), Id(":d")));
+  EXPECT_FALSE(index.DependsOn(Id(":c"), Id(":y")));
+
+  // x and y are one component.
+  EXPECT_EQ(index.component_count(), graph_.labels.target_count() - 1);
+}
+
+TEST_F(ReachabilityTest, TransitiveDependencies) {
+  const ReachabilityIndex index(graph_);
+  EXPECT_THAT(Names(index.TransitiveDependencies(Set({":b"}))),
+              UnorderedElementsAre("b", "c", "d", "e"));
+  EXPECT_THAT(Names(index.TransitiveDependencies(Set({":a"}), 1)),
+              UnorderedElementsAre("a", "b"));
+  EXPECT_THAT(Names(index.TransitiveDependencies(Set({":a"}), 0)),
+              UnorderedElementsAre("a"));
+  EXPECT_THAT(Names(index.TransitiveDependencies(Set({":x", ":e"}))),
+              UnorderedElementsAre("x", "y", "c", "d", "e"));
+}
+
+TEST_F(ReachabilityTest, TransitiveDependents) {
+  const ReachabilityIndex index(graph_);
+  EXPECT_THAT(Names(index.TransitiveDependents(Set({":c"}))),
+              UnorderedElementsAre("a", "b", "c", "x", "y"));
+  EXPECT_THAT(Names(index.TransitiveDependents(Set({":e"}))),
+              UnorderedElementsAre("a", "b", "e"));
+  EXPECT_THAT(Names(index.TransitiveDependents(Set({":d"}), 1)),
+              UnorderedElementsAre("c", "d"));
+}
+
+TEST_F(ReachabilityTest, SomePath) {
+  const ReachabilityIndex index(graph_);
+  EXPECT_THAT(Names(index.SomePath(Id(":a"), Id(":d"))),
+              ElementsAre("a", "b", "c", "d"));
+  EXPECT_THAT(Names(index.SomePath(Id(":x"), Id(":d"))),
+              ElementsAre("x", "y", "c", "d"));
+  EXPECT_THAT(Names(index.SomePath(Id(":a"), Id(":a"))), ElementsAre("a"));
+  EXPECT_THAT(index.SomePath(Id(":d"), Id(":a")), IsEmpty());
+}
+
+TEST(TargetSet, SetOperations) {
+  TargetSet a;
+  a.insert(1);
+  a.insert(70);
+  a.insert(200);
+  TargetSet b(100);
+  b.insert(70);
+  b.insert(3);
+
+  EXPECT_EQ(a.size(), 3);
+  EXPECT_TRUE(a.contains(200));
+  EXPECT_FALSE(a.contains(3));
+  EXPECT_FALSE(a.contains(100000));
+
+  TargetSet u = a;
+  u |= b;
+  EXPECT_THAT(u.ToVector(), ElementsAre(1, 3, 70, 200));
+
+  TargetSet i = a;
+  i &= b;
+  EXPECT_THAT(i.ToVector(), ElementsAre(70));
+
+  TargetSet d = a;
+  d -= b;
+  EXPECT_THAT(d.ToVector(), ElementsAre(1, 200));
+  d.erase(1);
+  d.erase(200);
+  EXPECT_TRUE(d.empty());
+}
+}  // namespace bant
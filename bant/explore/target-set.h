@@ -0,0 +1,112 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_EXPLORE_TARGET_SET_H
+#define BANT_EXPLORE_TARGET_SET_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bant/label-table.h"
+
+namespace bant {
+// A set of TargetIds, represented as a dense bitset. Set operations are
+// linear scans over 64 targets at a time.
+class TargetSet {
+ public:
+  TargetSet() = default;
+
+  // Pre-size for ids smaller than "universe"; larger ids still can be added.
+  explicit TargetSet(size_t universe) : bits_((universe + 63) / 64) {}
+
+  bool contains(TargetId id) const {
+    const size_t word = id / 64;
+    return word < bits_.size() && (bits_[word] & Bit(id));
+  }
+
+  // Returns true if the element was newly inserted.
+  bool insert(TargetId id) {
+    const size_t word = id / 64;
+    if (word >= bits_.size()) bits_.resize(word + 1);
+    const bool is_new = !(bits_[word] & Bit(id));
+    bits_[word] |= Bit(id);
+    return is_new;
+  }
+
+  void erase(TargetId id) {
+    const size_t word = id / 64;
+    if (word < bits_.size()) bits_[word] &= ~Bit(id);
+  }
+
+  size_t size() const {
+    size_t result = 0;
+    for (const uint64_t w : bits_) result += std::popcount(w);
+    return result;
+  }
+
+  bool empty() const {
+    for (const uint64_t w : bits_) {
+      if (w) return false;
+    }
+    return true;
+  }
+
+  // Union, intersection and difference.
+  TargetSet &operator|=(const TargetSet &other) {
+    if (other.bits_.size() > bits_.size()) bits_.resize(other.bits_.size());
+    for (size_t i = 0; i < other.bits_.size(); ++i) bits_[i] |= other.bits_[i];
+    return *this;
+  }
+  TargetSet &operator&=(const TargetSet &other) {
+    for (size_t i = 0; i < bits_.size(); ++i) {
+      bits_[i] &= (i < other.bits_.size()) ? other.bits_[i] : 0;
+    }
+    return *this;
+  }
+  TargetSet &operator-=(const TargetSet &other) {
+    const size_t common = std::min(bits_.size(), other.bits_.size());
+    for (size_t i = 0; i < common; ++i) bits_[i] &= ~other.bits_[i];
+    return *this;
+  }
+
+  // Call "fun" with each element in ascending order.
+  template <typename Fun>
+  void ForEach(Fun &&fun) const {
+    for (size_t i = 0; i < bits_.size(); ++i) {
+      for (uint64_t w = bits_[i]; w; w &= w - 1) {
+        fun(static_cast<TargetId>(i * 64 + std::countr_zero(w)));
+      }
+    }
+  }
+
+  std::vector<TargetId> ToVector() const {
+    std::vector<TargetId> result;
+    ForEach([&result](TargetId id) { result.push_back(id); });
+    return result;
+  }
+
+ private:
+  static uint64_t Bit(TargetId id) { return uint64_t{1} << (id % 64); }
+
+  std::vector<uint64_t> bits_;
+};
+}  // namespace bant
+
+#endif  // BANT_EXPLORE_TARGET_SET_H
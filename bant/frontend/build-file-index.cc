@@ -0,0 +1,81 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/frontend/build-file-index.h"
+
+#include <initializer_list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "bant/types-bazel.h"
+#include "bant/util/file-utils.h"
+
+namespace bant {
+std::optional<FilesystemPath> BuildFileIndex::FindBuildFile(
+  const BazelPackage &package, int *filesystem_probes) {
+  {
+    const std::lock_guard<std::mutex> l(lock_);
+    auto found = known_.find(package);
+    if (found != known_.end()) return found->second;
+  }
+
+  // Not holding the lock while accessing the filesystem; in the rare case
+  // another thread looks up the same package concurrently, both come to the
+  // same conclusion.
+  int probes = 0;
+  std::optional<FilesystemPath> result = ProbeFilesystem(package, &probes);
+  if (filesystem_probes) *filesystem_probes += probes;
+
+  const std::lock_guard<std::mutex> l(lock_);
+  known_.emplace(package, result);
+  return result;
+}
+
+void BuildFileIndex::Remember(const BazelPackage &package,
+                              const FilesystemPath &build_file) {
+  const std::lock_guard<std::mutex> l(lock_);
+  known_.insert_or_assign(package, build_file);
+}
+
+std::optional<FilesystemPath> BuildFileIndex::ProbeFilesystem(
+  const BazelPackage &package, int *filesystem_probes) const {
+  std::string start_path;
+  if (!package.project.empty()) {
+    auto project_path_or = workspace_.FindPathByProject(package.project);
+    if (!project_path_or.has_value()) {
+      // The following message would be too noisy right now as we attempt to
+      // read more dependencies than we need.
+      // info_out << "Can't find referenced " << package.project << "\n";
+      return std::nullopt;
+    }
+    start_path = project_path_or.value().path();
+  }
+
+  if (!package.path.empty()) {
+    if (!start_path.empty()) start_path.append("/");
+    start_path.append(package.path);
+  }
+  for (const std::string_view build_file : {"BUILD", "BUILD.bazel"}) {
+    FilesystemPath test_path(start_path, build_file);
+    ++*filesystem_probes;
+    if (test_path.can_read()) return test_path;
+  }
+  return std::nullopt;
+}
+}  // namespace bant
@@ -0,0 +1,64 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_FRONTEND_BUILD_FILE_INDEX_H
+#define BANT_FRONTEND_BUILD_FILE_INDEX_H
+
+#include <mutex>
+#include <optional>
+
+#include "absl/container/flat_hash_map.h"
+#include "bant/types-bazel.h"
+#include "bant/util/file-utils.h"
+#include "bant/workspace.h"
+
+namespace bant {
+// Knows which BUILD file, if any, defines a package.
+//
+// The filesystem is only consulted the first time a package is looked up.
+// The answer is remembered, including that there is no BUILD file, which is
+// common for the many packages only referenced in select() branches for
+// other platforms or in external projects that are not available.
+//
+// Thread-safe: lookups can happen concurrently from multiple readers.
+class BuildFileIndex {
+ public:
+  explicit BuildFileIndex(const BazelWorkspace &workspace)
+      : workspace_(workspace) {}
+  BuildFileIndex(const BuildFileIndex &) = delete;
+
+  // Return BUILD or BUILD.bazel file of given package or nullopt if there
+  // is none. If "filesystem_probes" is given, it is incremented by the
+  // number of files checked on the filesystem (zero, if already known).
+  std::optional<FilesystemPath> FindBuildFile(const BazelPackage &package,
+                                              int *filesystem_probes = nullptr);
+
+  // Remember the BUILD file of a package that was found otherwise, e.g. by
+  // walking the directory tree.
+  void Remember(const BazelPackage &package, const FilesystemPath &build_file);
+
+ private:
+  std::optional<FilesystemPath> ProbeFilesystem(const BazelPackage &package,
+                                                int *filesystem_probes) const;
+
+  const BazelWorkspace &workspace_;
+  std::mutex lock_;
+  absl::flat_hash_map<BazelPackage, std::optional<FilesystemPath>> known_;
+};
+}  // namespace bant
+
+#endif  // BANT_FRONTEND_BUILD_FILE_INDEX_H
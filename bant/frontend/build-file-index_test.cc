@@ -0,0 +1,75 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/frontend/build-file-index.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "bant/types-bazel.h"
+#include "bant/workspace.h"
+#include "gtest/gtest.h"
+
+namespace bant {
+TEST(BuildFileIndex, FindAndRememberBuildFiles) {
+  const std::string root = ::testing::TempDir() + "/build-file-index";
+  mkdir(root.c_str(), 0755);
+  mkdir((root + "/foo").c_str(), 0755);
+  mkdir((root + "/bar").c_str(), 0755);
+  mkdir((root + "/baz").c_str(), 0755);
+  unlink((root + "/baz/BUILD").c_str());  // Possibly left from previous run.
+  std::ofstream(root + "/foo/BUILD") << "\n";
+  std::ofstream(root + "/bar/BUILD.bazel") << "\n";
+
+  BazelWorkspace workspace;
+  workspace.project_location[{.project = "ext", .version = ""}] =
+    FilesystemPath(root);
+  BuildFileIndex index(workspace);
+
+  int probes = 0;
+  auto found = index.FindBuildFile(BazelPackage("@ext", "foo"), &probes);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(found->path(), root + "/foo/BUILD");
+  EXPECT_EQ(probes, 1);
+
+  probes = 0;
+  found = index.FindBuildFile(BazelPackage("@ext", "bar"), &probes);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(found->path(), root + "/bar/BUILD.bazel");
+  EXPECT_EQ(probes, 2);
+
+  probes = 0;
+  EXPECT_FALSE(index.FindBuildFile(BazelPackage("@ext", "baz"), &probes));
+  EXPECT_EQ(probes, 2);
+
+  // Unknown project: nothing to look at on the filesystem.
+  probes = 0;
+  EXPECT_FALSE(index.FindBuildFile(BazelPackage("@nope", "foo"), &probes));
+  EXPECT_EQ(probes, 0);
+
+  // Now, all the answers are known, even if the filesystem changes.
+  unlink((root + "/foo/BUILD").c_str());
+  std::ofstream(root + "/baz/BUILD") << "\n";
+  probes = 0;
+  EXPECT_TRUE(index.FindBuildFile(BazelPackage("@ext", "foo"), &probes));
+  EXPECT_FALSE(index.FindBuildFile(BazelPackage("@ext", "baz"), &probes));
+  EXPECT_EQ(probes, 0);
+}
+}  // namespace bant
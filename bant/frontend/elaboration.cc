@@ -49,9 +49,14 @@ class NestCounter {
 
 class SimpleElaborator : public BaseNodeReplacementVisitor {
  public:
+  // If "glob_dirs" is not null, directories listed by glob() are added.
   SimpleElaborator(Session &session, ParsedProject *project,
-                   const BazelPackage &package)
-      : session_(session), project_(project), package_(package) {}
+                   const BazelPackage &package,
+                   std::vector<std::string> *glob_dirs = nullptr)
+      : session_(session),
+        project_(project),
+        package_(package),
+        glob_dirs_(glob_dirs) {}
 
   Node *VisitFunCall(FunCall *f) final {
     const NestCounter c(&nest_level_);
@@ -258,10 +263,14 @@ class SimpleElaborator : public BaseNodeReplacementVisitor {
     const size_t skip_prefix = start_dir.length() + 1;  // w/ slash.
 
     size_t checked_files = 0;
+    if (glob_dirs_) glob_dirs_->emplace_back(start_dir);
     auto result = CollectFilesRecursive(
       FilesystemPath(start_dir),
       [&](const FilesystemPath &dir) {
-        return dir_matcher(std::string_view(dir.path()).substr(skip_prefix));
+        const bool want =
+          dir_matcher(std::string_view(dir.path()).substr(skip_prefix));
+        if (want && glob_dirs_) glob_dirs_->emplace_back(dir.path());
+        return want;
       },
       [&](const FilesystemPath &file) {
         ++checked_files;
@@ -280,6 +289,7 @@ class SimpleElaborator : public BaseNodeReplacementVisitor {
   Session &session_;
   ParsedProject *const project_;
   const BazelPackage &package_;
+  std::vector<std::string> *const glob_dirs_;
   int nest_level_ = 0;
   absl::flat_hash_map<std::string_view, Node *> global_variables_;
 };
@@ -298,8 +308,9 @@ void Elaborate(Session &session, ParsedProject *project,
   const ScopedTimer timer(&elab_stats.duration);
   ++elab_stats.count;
 
-  Node *const result =
-    Elaborate(session, project, build_file->package, build_file->ast);
+  SimpleElaborator elaborator(session, project, build_file->package,
+                              &build_file->glob_dirs);
+  Node *const result = elaborator.WalkNonNull(build_file->ast);
   CHECK_EQ(result, build_file->ast) << "Toplevel should never be replaced.";
 }
 
@@ -45,15 +45,20 @@
 namespace bant {
 namespace {
 
+// Given a directory, return the bare package path with no prefix.
+// ./foo/bar/baz turns into foo/bar/baz
+std::string_view PackagePathFromDir(std::string_view dir) {
+  while (!dir.empty() && (dir[0] == '.' || dir[0] == '/')) {
+    dir.remove_prefix(1);
+  }
+  return dir;
+}
+
 // Given a BUILD, BUILD.bazel filename, return the bare project path with
 // no prefix or suffix.
 // ./foo/bar/baz/BUILD.bazel turns into foo/bar/baz
 std::string_view TargetPathFromBuildFile(std::string_view file) {
-  file = file.substr(0, file.find_last_of('/'));  // Remove BUILD-file
-  while (!file.empty() && (file[0] == '.' || file[0] == '/')) {
-    file.remove_prefix(1);
-  }
-  return file;
+  return PackagePathFromDir(file.substr(0, file.find_last_of('/')));
 }
 
 // Given a bazel pattern, find the start directory to recursively walk the
@@ -78,9 +83,10 @@ static std::optional<FilesystemPath> DetermineSearchDirFromPattern(
 // Convenience function to just collect all the BUILD files. Update "stats"
 // with total files searched and total time.
 // If pattern contains a project name, the path is resolved from "workspace".
-std::vector<FilesystemPath> CollectBuildFiles(Session &session,
-                                              const BazelWorkspace &workspace,
-                                              const BazelPattern &pattern) {
+// Directories excluded by negative patterns in "bundle" are not descended into.
+std::vector<FilesystemPath> CollectBuildFiles(
+  Session &session, const BazelWorkspace &workspace,
+  const BazelPattern &pattern, const BazelPatternBundle &bundle) {
   bant::Stat &walk_stats =
     session.GetStatsFor("BUILD file glob walk", "files/directories");
   const ScopedTimer timer(&walk_stats.duration);
@@ -93,6 +99,14 @@ std::vector<FilesystemPath> CollectBuildFiles(Session &session,
     return basename == "BUILD" || basename == "BUILD.bazel";
   };
 
+  // To map a directory to its package, we need to strip the project prefix.
+  const bool prune_excluded = bundle.has_negative_patterns();
+  size_t project_prefix_len = 0;
+  if (prune_excluded && !pattern.project().empty()) {
+    auto dir_or = workspace.FindPathByProject(pattern.project());
+    if (dir_or.has_value()) project_prefix_len = dir_or->path().length();
+  }
+
   const auto dir_predicate = [&](const FilesystemPath &dir) {
     walk_stats.count++;
     if (!allow_recursive_walking) return false;  // Only looking at one level.
@@ -102,6 +116,13 @@ std::vector<FilesystemPath> CollectBuildFiles(Session &session,
     if (filename == "_tmp") return false;
     if (filename == ".cache") return false;
     if (filename == ".git") return false;
+    if (prune_excluded) {
+      const std::string_view dir_path = dir.path();
+      const BazelPackage package(
+        pattern.project(),
+        PackagePathFromDir(dir_path.substr(project_prefix_len)));
+      if (bundle.ExcludesRecursively(package)) return false;
+    }
     return true;
   };
 
@@ -116,25 +137,42 @@ ParsedProject::ParsedProject(BazelWorkspace workspace, bool verbose)
   arena_.SetVerbose(verbose);
 }
 
-int ParsedProject::FillFromPattern(Session &session,
-                                   const BazelPatternBundle &bundle) {
-  int count = 0;
-  std::set<FilesystemPath> unique_files;  // bundle might match multiple same
+std::vector<std::pair<BazelPackage, FilesystemPath>>
+ParsedProject::FindBuildFiles(Session &session,
+                              const BazelPatternBundle &bundle) const {
+  std::vector<std::pair<BazelPackage, FilesystemPath>> result;
+  std::set<std::string> unique_files;  // bundle might match multiple same
   for (const BazelPattern &pattern : bundle.patterns()) {
-    const auto build_files = CollectBuildFiles(session, workspace(), pattern);
+    if (bundle.ExcludesRecursively(
+          BazelPackage(pattern.project(), pattern.path()))) {
+      continue;
+    }
+    const auto build_files =
+      CollectBuildFiles(session, workspace(), pattern, bundle);
     for (const FilesystemPath &build_file : build_files) {
-      if (unique_files.insert(build_file).second) {
-        ++count;
-        AddBuildFile(session, build_file, pattern.project());
-      }
+      // Walking from the root yields "./foo/BUILD", a pattern for a single
+      // package "foo/BUILD"; both are the same file.
+      std::string_view file_key = build_file.path();
+      if (file_key.starts_with("./")) file_key.remove_prefix(2);
+      if (!unique_files.emplace(file_key).second) continue;
+      auto package = PackageOfBuildFile(build_file, pattern.project());
+      if (package.has_value()) result.emplace_back(*package, build_file);
     }
   }
-  return count;
+  return result;
+}
+
+int ParsedProject::FillFromPattern(Session &session,
+                                   const BazelPatternBundle &bundle) {
+  const auto build_files = FindBuildFiles(session, bundle);
+  for (const auto &[package, build_file] : build_files) {
+    AddBuildFile(session, build_file, package);
+  }
+  return build_files.size();
 }
 
-ParsedBuildFile *ParsedProject::AddBuildFile(Session &session,
-                                             const FilesystemPath &build_file,
-                                             std::string_view project) {
+std::optional<BazelPackage> ParsedProject::PackageOfBuildFile(
+  const FilesystemPath &build_file, std::string_view project) const {
   std::string_view package_path = build_file.path();
   if (!project.empty()) {
     // Somewhat silly to reconstruct the path by asking the worksapce again,
@@ -143,27 +181,32 @@ ParsedBuildFile *ParsedProject::AddBuildFile(Session &session,
     auto prefix_or = workspace().FindPathByProject(project);
     if (!prefix_or.has_value()) {
       std::cerr << build_file.path() << ": Can't determine package.\n";
-      return nullptr;  // should not happen.
+      return std::nullopt;  // should not happen.
     }
     // Path to project is prefix, everything afterwards is the pack path
     package_path = package_path.substr(prefix_or->path().length());
   }
-
-  const BazelPackage package(project, TargetPathFromBuildFile(package_path));
-  return AddBuildFile(session, build_file, package);
+  return BazelPackage(project, TargetPathFromBuildFile(package_path));
 }
 
 ParsedBuildFile *ParsedProject::AddBuildFile(Session &session,
                                              const FilesystemPath &build_file,
                                              const BazelPackage &package) {
   Stat &fread_stat = session.GetStatsFor("read(BUILD)      ", "BUILD files");
-  Stat &parse_stat = session.GetStatsFor("Parse & build AST", "BUILD files");
   std::optional<std::string> content;
   {
     const ScopedTimer timer(&fread_stat.duration);
     content = ReadFileToString(build_file);
     ++fread_stat.count;
   }
+  return AddBuildFile(session, build_file, package, std::move(content));
+}
+
+ParsedBuildFile *ParsedProject::AddBuildFile(
+  Session &session, const FilesystemPath &build_file,
+  const BazelPackage &package, std::optional<std::string> content) {
+  Stat &fread_stat = session.GetStatsFor("read(BUILD)      ", "BUILD files");
+  Stat &parse_stat = session.GetStatsFor("Parse & build AST", "BUILD files");
   if (!content.has_value()) {
     std::cerr << "Could not read " << build_file.path() << "\n";
     ++error_count_;
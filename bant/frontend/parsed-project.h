@@ -19,11 +19,14 @@
 #define BANT_PROJECT_PARDER_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "bant/frontend/ast.h"
+#include "bant/frontend/build-file-index.h"
 #include "bant/frontend/named-content.h"
 #include "bant/frontend/source-locator.h"
 #include "bant/session.h"
@@ -53,6 +56,10 @@ class ParsedBuildFile {
   BazelPackage package;
   List *ast;           // parsed AST. Content owned by arena in ParsedProject
   std::string errors;  // List of errors if observed (todo: make actual list)
+
+  // Directories listed by glob() while elaborating; their content went into
+  // the elaborated AST.
+  std::vector<std::string> glob_dirs;
   // NOLINTEND(misc-non-private-member-variables-in-classes)
 
  private:
@@ -74,11 +81,23 @@ class ParsedProject : public SourceLocator {
   // Returns number of build-files added.
   int FillFromPattern(Session &session, const BazelPatternBundle &bundle);
 
+  // Find the BUILD files matching the pattern and the packages they define,
+  // without reading them.
+  std::vector<std::pair<BazelPackage, FilesystemPath>> FindBuildFiles(
+    Session &session, const BazelPatternBundle &bundle) const;
+
   // Parse build file for given package reading from filename.
   ParsedBuildFile *AddBuildFile(Session &session,
                                 const FilesystemPath &build_file,
                                 const BazelPackage &package);
 
+  // Same, but with the "content" of "build_file" already read by the caller;
+  // nullopt if reading failed.
+  ParsedBuildFile *AddBuildFile(Session &session,
+                                const FilesystemPath &build_file,
+                                const BazelPackage &package,
+                                std::optional<std::string> content);
+
   // A map of Package -> ParsedBuildFile
   const Package2Parsed &ParsedFiles() const { return package_to_parsed_; }
 
@@ -93,6 +112,9 @@ class ParsedProject : public SourceLocator {
 
   const BazelWorkspace &workspace() const { return workspace_; }
 
+  // Where to find BUILD files for packages not parsed yet.
+  BuildFileIndex &build_file_index() { return build_file_index_; }
+
   // Register the "source_locator" for given given string-view range.
   // Range must be disjoint from all other ranges. Ownership of
   // "source_locator" is not taken over, ParsedProject just keeps track of
@@ -107,11 +129,10 @@ class ParsedProject : public SourceLocator {
  private:
   friend class ParsedProjectTestUtil;
 
-  // like AddBuildFile(..package), but extract package from (workspace, path).
-  // TODO: should not be needed, just an artifact of FillFromPattern() workings.
-  ParsedBuildFile *AddBuildFile(Session &session,
-                                const FilesystemPath &build_file,
-                                std::string_view project);
+  // Package defined by the build file in given project, determined from its
+  // path relative to the project location in the workspace.
+  std::optional<BazelPackage> PackageOfBuildFile(
+    const FilesystemPath &build_file, std::string_view project) const;
 
   // Given package and content, parse. Main workhorse. Content is std::move()'d
   // thus by value.
@@ -122,6 +143,7 @@ class ParsedProject : public SourceLocator {
 
   Arena arena_{1 << 20};
   const BazelWorkspace workspace_;
+  BuildFileIndex build_file_index_{workspace_};
   int error_count_ = 0;
   Package2Parsed package_to_parsed_;
   DisjointRangeMap<std::string_view, const SourceLocator *> location_maps_;
@@ -0,0 +1,83 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/label-table.h"
+
+#include <optional>
+#include <string_view>
+
+#include "bant/types-bazel.h"
+
+namespace bant {
+PackageId LabelTable::Intern(const BazelPackage &package) {
+  if (auto found = FindPackage(package); found.has_value()) {
+    return *found;
+  }
+  const PackageId id = packages_.size();
+  const BazelPackage &stored = packages_.emplace_back(package);
+  package_index_.emplace(PackageKey{stored.project, stored.path}, id);
+  return id;
+}
+
+TargetId LabelTable::Intern(const BazelTarget &target) {
+  const PackageId package = Intern(target.package);
+  if (auto found = FindTarget(package, target.target_name); found.has_value()) {
+    return *found;
+  }
+  const TargetId id = targets_.size();
+  const TargetEntry &stored =
+    targets_.emplace_back(TargetEntry{target, package, target.ToString()});
+  target_index_.emplace(TargetKey{package, stored.target.target_name}, id);
+  return id;
+}
+
+std::optional<TargetId> LabelTable::ParseAndIntern(std::string_view label,
+                                                   PackageId context) {
+  if (auto found = literal_cache_.find(LiteralKey{context, label});
+      found != literal_cache_.end()) {
+    if (found->second == kUnparseable) return std::nullopt;
+    return found->second;
+  }
+  const auto target = BazelTarget::ParseFrom(label, packages_[context]);
+  const TargetId id = target.has_value() ? Intern(*target) : kUnparseable;
+  const std::string &stored_literal = literals_.emplace_back(label);
+  literal_cache_.emplace(LiteralKey{context, stored_literal}, id);
+  if (id == kUnparseable) return std::nullopt;
+  return id;
+}
+
+std::optional<PackageId> LabelTable::FindPackage(
+  const BazelPackage &package) const {
+  auto found = package_index_.find(PackageKey{package.project, package.path});
+  if (found == package_index_.end()) return std::nullopt;
+  return found->second;
+}
+
+std::optional<TargetId> LabelTable::FindTarget(
+  const BazelTarget &target) const {
+  const auto package = FindPackage(target.package);
+  if (!package.has_value()) return std::nullopt;
+  return FindTarget(*package, target.target_name);
+}
+
+std::optional<TargetId> LabelTable::FindTarget(
+  PackageId package, std::string_view target_name) const {
+  auto found = target_index_.find(TargetKey{package, target_name});
+  if (found == target_index_.end()) return std::nullopt;
+  return found->second;
+}
+}  // namespace bant
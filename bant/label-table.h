@@ -0,0 +1,133 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_LABEL_TABLE_H
+#define BANT_LABEL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "bant/types-bazel.h"
+
+namespace bant {
+// Dense ids of interned packages and targets. Handed out in sequence
+// starting from zero, so they can be used as index into plain vectors.
+using PackageId = uint32_t;
+using TargetId = uint32_t;
+
+// Interns BazelPackage and BazelTarget: each distinct label is stored once
+// and gets a dense id. Sets and maps of ids are much cheaper than of the
+// multi-string labels, and the string representation of a target is
+// available without assembling it each time.
+//
+// References returned stay valid for the lifetime of the table.
+class LabelTable {
+ public:
+  LabelTable() = default;
+  LabelTable(LabelTable &&) = default;
+  LabelTable(const LabelTable &) = delete;
+  LabelTable &operator=(LabelTable &&) = default;
+  LabelTable &operator=(const LabelTable &) = delete;
+
+  // Return the id of the package or target, interning it if not seen yet.
+  PackageId Intern(const BazelPackage &package);
+  TargetId Intern(const BazelTarget &target);
+
+  // Parse a label as found in a BUILD file in the "context" package, such
+  // as ":foo" or "@abseil-cpp//absl/strings", and return the interned
+  // target or nullopt if it can't be parsed.
+  // The result is cached, so resolving the same label literal in the same
+  // package again is a hash lookup.
+  std::optional<TargetId> ParseAndIntern(std::string_view label,
+                                         PackageId context);
+
+  // Lookup only, without interning.
+  std::optional<PackageId> FindPackage(const BazelPackage &package) const;
+  std::optional<TargetId> FindTarget(const BazelTarget &target) const;
+  std::optional<TargetId> FindTarget(PackageId package,
+                                     std::string_view target_name) const;
+
+  const BazelPackage &package(PackageId id) const { return packages_[id]; }
+  const BazelTarget &target(TargetId id) const { return targets_[id].target; }
+  PackageId package_id(TargetId id) const { return targets_[id].package; }
+
+  // Same as target(id).ToString(), but pre-computed.
+  const std::string &ToString(TargetId id) const {
+    return targets_[id].as_string;
+  }
+
+  size_t package_count() const { return packages_.size(); }
+  size_t target_count() const { return targets_.size(); }
+
+ private:
+  // Keys refer to the strings stored in packages_ and targets_.
+  struct PackageKey {
+    std::string_view project;
+    std::string_view path;
+    bool operator==(const PackageKey &) const = default;
+    template <typename H>
+    friend H AbslHashValue(H h, const PackageKey &k) {
+      return H::combine(std::move(h), k.project, k.path);
+    }
+  };
+
+  struct TargetKey {
+    PackageId package;
+    std::string_view name;
+    bool operator==(const TargetKey &) const = default;
+    template <typename H>
+    friend H AbslHashValue(H h, const TargetKey &k) {
+      return H::combine(std::move(h), k.package, k.name);
+    }
+  };
+
+  struct LiteralKey {
+    PackageId context;
+    std::string_view literal;
+    bool operator==(const LiteralKey &) const = default;
+    template <typename H>
+    friend H AbslHashValue(H h, const LiteralKey &k) {
+      return H::combine(std::move(h), k.context, k.literal);
+    }
+  };
+
+  // Cached in literal_cache_ for labels that could not be parsed.
+  static constexpr TargetId kUnparseable = ~TargetId{0};
+
+  struct TargetEntry {
+    BazelTarget target;
+    PackageId package;
+    std::string as_string;
+  };
+
+  // deque: elements don't move when growing, so keys can point to them.
+  std::deque<BazelPackage> packages_;
+  std::deque<TargetEntry> targets_;
+  std::deque<std::string> literals_;
+  absl::flat_hash_map<PackageKey, PackageId> package_index_;
+  absl::flat_hash_map<TargetKey, TargetId> target_index_;
+  absl::flat_hash_map<LiteralKey, TargetId> literal_cache_;
+};
+}  // namespace bant
+
+#endif  // BANT_LABEL_TABLE_H
@@ -0,0 +1,116 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/label-table.h"
+
+#include <optional>
+#include <string_view>
+
+#include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
+#include "bant/types-bazel.h"
+#include "gtest/gtest.h"
+
+namespace bant {
+static BazelTarget T(std::string_view s) {
+  auto result = BazelTarget::ParseFrom(s, BazelPackage());
+  CHECK(result.has_value()) << s;
+  return *result;
+}
+
+TEST(LabelTable, InternGivesDenseStableIds) {
+  LabelTable table;
+  const TargetId foo = table.Intern(T("//foo:foo"));
+  const TargetId bar = table.Intern(T("//foo:bar"));
+  const TargetId baz = table.Intern(T("@baz//some/path:baz"));
+  EXPECT_EQ(foo, 0);
+  EXPECT_EQ(bar, 1);
+  EXPECT_EQ(baz, 2);
+  EXPECT_EQ(table.target_count(), 3);
+  EXPECT_EQ(table.package_count(), 2);
+
+  // Same labels get the same ids.
+  EXPECT_EQ(table.Intern(T("//foo:bar")), bar);
+  EXPECT_EQ(table.Intern(T("@baz//some/path:baz")), baz);
+  EXPECT_EQ(table.target_count(), 3);
+
+  EXPECT_EQ(table.package_id(foo), table.package_id(bar));
+  EXPECT_NE(table.package_id(foo), table.package_id(baz));
+  EXPECT_EQ(table.package(table.package_id(baz)).project, "@baz");
+}
+
+TEST(LabelTable, RetrieveTargetAndString) {
+  LabelTable table;
+  const TargetId foo = table.Intern(T("//foo:foo"));
+  const TargetId baz = table.Intern(T("@baz//some/path:baz"));
+  for (int i = 0; i < 1000; ++i) {  // Make sure growing keeps things stable
+    table.Intern(T(absl::StrCat("//filler/p", i % 17, ":t", i)));
+  }
+  EXPECT_EQ(table.target(foo), T("//foo:foo"));
+  EXPECT_EQ(table.target(baz), T("@baz//some/path:baz"));
+  EXPECT_EQ(table.ToString(foo), "//foo");
+  EXPECT_EQ(table.ToString(baz), "@baz//some/path:baz");
+  EXPECT_EQ(table.Intern(T("//foo:foo")), foo);
+}
+
+TEST(LabelTable, FindDoesNotIntern) {
+  LabelTable table;
+  EXPECT_EQ(table.FindTarget(T("//foo:bar")), std::nullopt);
+  EXPECT_EQ(table.target_count(), 0);
+  EXPECT_EQ(table.package_count(), 0);
+
+  const TargetId bar = table.Intern(T("//foo:bar"));
+  EXPECT_EQ(table.FindTarget(T("//foo:bar")), bar);
+  const auto foo_package = table.FindPackage(T("//foo:bar").package);
+  ASSERT_TRUE(foo_package.has_value());
+  EXPECT_EQ(table.FindTarget(*foo_package, "bar"), bar);
+  EXPECT_EQ(table.FindTarget(*foo_package, "baz"), std::nullopt);
+}
+
+TEST(LabelTable, ParseAndInternRelativeToContext) {
+  LabelTable table;
+  const PackageId foo = table.Intern(T("//foo:foo").package);
+  const PackageId bar = table.Intern(T("//bar:bar").package);
+
+  const auto foo_x = table.ParseAndIntern(":x", foo);
+  const auto bar_x = table.ParseAndIntern(":x", bar);
+  ASSERT_TRUE(foo_x.has_value());
+  ASSERT_TRUE(bar_x.has_value());
+  EXPECT_NE(*foo_x, *bar_x);  // Same literal, different context.
+  EXPECT_EQ(table.target(*foo_x), T("//foo:x"));
+  EXPECT_EQ(table.target(*bar_x), T("//bar:x"));
+
+  // Different literal, same target.
+  EXPECT_EQ(table.ParseAndIntern("//foo:x", bar), foo_x);
+  EXPECT_EQ(table.ParseAndIntern(":x", foo), foo_x);  // cached.
+
+  // Unparseable are reported every time.
+  EXPECT_EQ(table.ParseAndIntern("//a:b:c", foo), std::nullopt);
+  EXPECT_EQ(table.ParseAndIntern("//a:b:c", foo), std::nullopt);
+}
+
+TEST(LabelTable, ParseAndInternInExternalProjectContext) {
+  LabelTable table;
+  const PackageId absl_pkg =
+    table.Intern(T("@abseil-cpp//absl/strings:strings").package);
+  const auto str_format =
+    table.ParseAndIntern("//absl/strings:str_format", absl_pkg);
+  ASSERT_TRUE(str_format.has_value());
+  EXPECT_EQ(table.ToString(*str_format),
+            "@abseil-cpp//absl/strings:str_format");
+}
+}  // namespace bant
@@ -18,6 +18,7 @@
 #ifndef BANT_SESSION_H
 #define BANT_SESSION_H
 
+#include <cstddef>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -54,7 +55,10 @@ struct CommandlineFlags {
   bool print_only_errors = false;
   bool elaborate = false;
   bool ignore_keep_comment = false;
+  bool recheck_all = false;  // dwyu: don't reuse results of previous runs.
   int recurse_dependency_depth = 0;
+  int jobs = 0;  // Threads for work that can be parallelized; 0: all cores.
+  size_t include_scan_slack = 0;  // dwyu: stop scan after this; 0: strict.
   OutputFormat output_format = OutputFormat::kNative;
   std::string grep_regex;
   bool do_color = false;
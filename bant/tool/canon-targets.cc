@@ -23,6 +23,7 @@
 
 #include "bant/explore/query-utils.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/label-table.h"
 #include "bant/session.h"
 #include "bant/tool/edit-callback.h"
 #include "bant/types-bazel.h"
@@ -37,13 +38,31 @@ size_t CreateCanonicalizeEdits(Session &session, const ParsedProject &project,
   Stat &stats = session.GetStatsFor("Canonicalization checked", "dependencies");
   const ScopedTimer timer(&stats.duration);
 
+  // Same label strings show up over and over again; the label table only
+  // needs to parse them once.
+  LabelTable labels;
+
+  // Canonical is the shortest form: relative if in the same package.
+  auto is_canonical = [&](std::string_view dep_str, TargetId dep,
+                          PackageId current_package_id) {
+    if (labels.package_id(dep) != current_package_id) {
+      return dep_str == labels.ToString(dep);
+    }
+    const std::string_view name = labels.target(dep).target_name;
+    return dep_str.size() == name.size() + 1 && dep_str.starts_with(':') &&
+           dep_str.ends_with(name);
+  };
+
   for (const auto &[_, parsed_package] : project.ParsedFiles()) {
     if (!pattern.Match(parsed_package->package)) {
       continue;
     }
     const BazelPackage &current_package = parsed_package->package;
+    const PackageId current_package_id = labels.Intern(current_package);
     query::FindTargets(
-      parsed_package->ast, {}, [&](const query::Result &target) {
+      parsed_package->ast, {},
+      {query::Attribute::kName, query::Attribute::kDeps},
+      [&](const query::Result &target) {
         auto self = current_package.QualifiedTarget(target.name);
         if (!self.has_value()) {
           return;
@@ -52,19 +71,20 @@ size_t CreateCanonicalizeEdits(Session &session, const ParsedProject &project,
           return;
         }
 
-        const auto deps = query::ExtractStringList(target.deps_list);
-        for (const std::string_view dep_str : deps) {
+        for (const std::string_view dep_str :
+             query::StringListView(target.deps_list)) {
           stats.count++;
-          auto dep_target = BazelTarget::ParseFrom(dep_str, current_package);
+          auto dep_target = labels.ParseAndIntern(dep_str, current_package_id);
           if (!dep_target.has_value()) {
             project.Loc(info_out, dep_str)
               << " Invalid target name '" << dep_str << "'\n";
             continue;
           }
-          if (dep_str != dep_target->ToStringRelativeTo(current_package)) {
+          if (!is_canonical(dep_str, *dep_target, current_package_id)) {
             ++edit_counts;
-            emit_canon_edit(EditRequest::kRename, *self, dep_str,
-                            dep_target->ToStringRelativeTo(current_package));
+            emit_canon_edit(
+              EditRequest::kRename, *self, dep_str,
+              labels.target(*dep_target).ToStringRelativeTo(current_package));
           }
         }
       });
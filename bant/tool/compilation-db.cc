@@ -201,8 +201,8 @@ static std::vector<std::string> CollectIncDirs(
       const BazelPackage &current_package = target.package;
       // If we're one of those targets that come with the own -I prefix,
       // add all these.
-      const auto inc_dirs = query::ExtractStringList(details.includes_list);
-      for (const std::string_view inc_dir : inc_dirs) {
+      for (const std::string_view inc_dir :
+           query::StringListView(details.includes_list)) {
         const std::string inc_path =
           current_package.FullyQualifiedFile(workspace, inc_dir);
         if (!already_seen.insert(inc_path).second) {
@@ -259,8 +259,8 @@ static std::vector<std::string> CollectIncDirs(
 
       // Now, let's check out the dependencies and see that all of the
       // referenced external projects are covered.
-      const auto deps = query::ExtractStringList(details.deps_list);
-      for (const std::string_view dependency_target : deps) {
+      for (const std::string_view dependency_target :
+           query::StringListView(details.deps_list)) {
         auto requested_dep =
           BazelTarget::ParseFrom(dependency_target, current_package);
         if (!requested_dep.has_value()) {
@@ -317,7 +317,7 @@ static void WriteCompilationDBEntry(const ParsedProject &project,
                                     const std::string &external_inc_json,
                                     std::set<std::string> *already_written,
                                     std::ostream &out) {
-  std::vector<std::string_view> sources;
+  query::StringList sources;
   query::AppendStringList(details.srcs_list, sources);
   query::AppendStringList(details.hdrs_list, sources);
 
@@ -0,0 +1,143 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/tool/dwyu-cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "bant/tool/edit-callback.h"
+#include "bant/types-bazel.h"
+#include "bant/util/cache-file.h"
+
+namespace bant {
+namespace {
+// Bump if the format or what is fingerprinted changes.
+constexpr std::string_view kFileHeader = "bant-dwyu-results 1";
+}  // namespace
+
+DWYUResultCache::DWYUResultCache(std::string file, std::string_view version)
+    : file_(std::move(file)),
+      header_(absl::StrCat(kFileHeader, "\t", version)) {
+  Load();
+}
+
+std::optional<DWYUResultCache::Result> DWYUResultCache::Find(
+  const BazelTarget &target, uint64_t fingerprint) {
+  const std::lock_guard<std::mutex> l(lock_);
+  auto found = entries_.find(target);
+  if (found == entries_.end()) return std::nullopt;
+  found->second.used = true;
+  if (found->second.fingerprint != fingerprint) return std::nullopt;
+  ++reused_;
+  return found->second.result;
+}
+
+void DWYUResultCache::Update(const BazelTarget &target, uint64_t fingerprint,
+                             Result result) {
+  const std::lock_guard<std::mutex> l(lock_);
+  Entry &entry = entries_[target];
+  entry.fingerprint = fingerprint;
+  entry.used = true;
+  entry.result = std::move(result);
+  modified_ = true;
+}
+
+size_t DWYUResultCache::reused() const {
+  const std::lock_guard<std::mutex> l(lock_);
+  return reused_;
+}
+
+void DWYUResultCache::Load() {
+  // All strings but the target are C-escaped.
+  // T <target> <fingerprint>
+  // E <edit-op> <info-before> <before> <after>
+  // I <info>
+  Entry *current = nullptr;
+  auto record = [&](std::span<const std::string_view> fields) {
+    if (fields[0] == "T" && fields.size() == 3) {
+      const auto target =
+        BazelTarget::ParseFrom(fields[1], BazelPackage("", ""));
+      Entry entry;
+      if (!target.has_value() ||
+          !ParseNumber(fields[2], &entry.fingerprint, 16)) {
+        return false;
+      }
+      current = &(entries_[*target] = std::move(entry));
+      return true;
+    }
+    if (fields[0] == "E" && fields.size() == 5 && current) {
+      Edit &edit = current->result.edits.emplace_back();
+      int op = 0;
+      if (!ParseNumber(fields[1], &op) ||
+          op > static_cast<int>(EditRequest::kRename)) {
+        return false;
+      }
+      edit.op = static_cast<EditRequest>(op);
+      return absl::CUnescape(fields[2], &edit.info_before) &&
+             absl::CUnescape(fields[3], &edit.before) &&
+             absl::CUnescape(fields[4], &edit.after);
+    }
+    if (fields[0] == "I" && fields.size() == 2 && current) {
+      return absl::CUnescape(fields[1], &current->result.info);
+    }
+    return false;
+  };
+  std::string content;  // Strings are unescaped into the entries.
+  LoadCacheFile(file_, header_, &content, &entries_, record);
+}
+
+bool DWYUResultCache::Save(const BazelTargetMatcher &checked) {
+  const std::lock_guard<std::mutex> l(lock_);
+  modified_ |= std::erase_if(entries_, [&checked](const auto &entry) {
+    const auto &[target, value] = entry;
+    return !value.used && checked.Match(target);
+  }) > 0;
+  if (!modified_) return true;  // Nothing to update.
+
+  CacheFileWriter out(file_, header_);
+  for (const auto &[target, entry] : entries_) {
+    const std::string target_name = target.ToString();
+    if (!CacheFileWriter::IsStorable(target_name)) continue;
+    out.Write({"T", target_name, absl::StrFormat("%x", entry.fingerprint)});
+    for (const Edit &edit : entry.result.edits) {
+      out.Write({"E", absl::StrCat(static_cast<int>(edit.op)),
+                 absl::CEscape(edit.info_before), absl::CEscape(edit.before),
+                 absl::CEscape(edit.after)});
+    }
+    if (!entry.result.info.empty()) {
+      out.Write({"I", absl::CEscape(entry.result.info)});
+    }
+  }
+  if (!out.Commit()) return false;
+  modified_ = false;
+  return true;
+}
+
+std::optional<std::string> DWYUResultCacheFile() {
+  return ProjectCacheFile("dwyu-results");
+}
+}  // namespace bant
@@ -0,0 +1,100 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_TOOL_DWYU_CACHE_
+#define BANT_TOOL_DWYU_CACHE_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bant/tool/edit-callback.h"
+#include "bant/types-bazel.h"
+
+namespace bant {
+// Remembers what DWYU reported for each target together with a fingerprint
+// of everything that went into the check: the rule, the content of its
+// sources and what the included headers resolved to. Kept between runs, a
+// target whose fingerprint did not change does not need to be checked again;
+// its previous messages and edits can be replayed.
+//
+// Find() and Update() are thread-safe.
+class DWYUResultCache {
+ public:
+  struct Edit {
+    std::string info_before;  // Info messages that came before this edit.
+    EditRequest op;
+    std::string before;
+    std::string after;
+  };
+
+  // Everything reported while checking a target.
+  struct Result {
+    std::vector<Edit> edits;
+    std::string info;  // Info messages after the last edit.
+  };
+
+  // Cache stored in "file". Starts out with its content if it exists, is
+  // readable and was written by the same bant "version": other versions
+  // might come to different results.
+  DWYUResultCache(std::string file, std::string_view version);
+  DWYUResultCache(const DWYUResultCache &) = delete;
+
+  // Result for "target" if it was recorded with the same "fingerprint".
+  std::optional<Result> Find(const BazelTarget &target, uint64_t fingerprint);
+
+  // Record the result of checking "target" with given input "fingerprint".
+  void Update(const BazelTarget &target, uint64_t fingerprint, Result result);
+
+  // Write back the cache if anything changed. Entries of targets "checked"
+  // in this run, but neither looked up nor updated, are dropped: these
+  // targets don't exist anymore. Returns true on success.
+  bool Save(const BazelTargetMatcher &checked);
+
+  size_t size() const { return entries_.size(); }
+
+  // Number of successful Find()s.
+  size_t reused() const;
+
+ private:
+  struct Entry {
+    uint64_t fingerprint = 0;
+    bool used = false;  // Looked up or updated in this run.
+    Result result;
+  };
+
+  void Load();
+
+  const std::string file_;
+  const std::string header_;  // First line of the file.
+  mutable std::mutex lock_;
+  std::map<BazelTarget, Entry> entries_;
+  size_t reused_ = 0;
+  bool modified_ = false;
+};
+
+// If the user created a ~/.cache/bant directory, the file to keep the DWYU
+// results of the project in the current directory in; nullopt otherwise.
+std::optional<std::string> DWYUResultCacheFile();
+}  // namespace bant
+
+#endif  // BANT_TOOL_DWYU_CACHE_
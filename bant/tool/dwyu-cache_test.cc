@@ -0,0 +1,110 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "bant/tool/dwyu-cache.h"
+
+#include <unistd.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "bant/tool/edit-callback.h"
+#include "bant/types-bazel.h"
+#include "gtest/gtest.h"
+
+namespace bant {
+namespace {
+BazelTarget Target(std::string_view str) {
+  return *BazelTarget::ParseFrom(str, BazelPackage("", ""));
+}
+
+BazelPatternBundle Pattern(std::string_view str) {
+  BazelPatternBundle result;
+  result.AddPattern(*BazelPattern::ParseFrom(str));
+  result.Finish();
+  return result;
+}
+}  // namespace
+
+TEST(DWYUResultCache, FindUpdateSaveAndLoad) {
+  const std::string cache_file = ::testing::TempDir() + "/dwyu-results";
+  unlink(cache_file.c_str());  // Possibly left from previous run.
+
+  // Messages are multi-line and might contain all kinds of characters.
+  const DWYUResultCache::Result foo_result{
+    .edits = {{.info_before = "foo.cc:1:1: Some\tmessage\n",
+               .op = EditRequest::kRemove,
+               .before = "//some:lib",
+               .after = ""},
+              {.info_before = "",
+               .op = EditRequest::kAdd,
+               .before = "",
+               .after = ":other"}},
+    .info = "\033[31mcolored\033[0m \\ message\n",
+  };
+
+  {
+    DWYUResultCache cache(cache_file, "1.0");
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_FALSE(cache.Find(Target("//foo:foo"), 42).has_value());
+    cache.Update(Target("//foo:foo"), 42, foo_result);
+    cache.Update(Target("@ext//bar:bar"), 17, {});
+    EXPECT_TRUE(cache.Find(Target("//foo:foo"), 42).has_value());
+    EXPECT_EQ(cache.reused(), 1);
+    EXPECT_TRUE(cache.Save(Pattern("//...")));
+  }
+
+  {
+    DWYUResultCache cache(cache_file, "1.0");
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_FALSE(cache.Find(Target("//foo:foo"), 43).has_value());  // Changed
+    const auto found = cache.Find(Target("//foo:foo"), 42);
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->edits.size(), 2);
+    EXPECT_EQ(found->edits[0].info_before, foo_result.edits[0].info_before);
+    EXPECT_EQ(found->edits[0].op, EditRequest::kRemove);
+    EXPECT_EQ(found->edits[0].before, "//some:lib");
+    EXPECT_EQ(found->edits[1].op, EditRequest::kAdd);
+    EXPECT_EQ(found->edits[1].after, ":other");
+    EXPECT_EQ(found->info, foo_result.info);
+
+    // Only //foo was looked at in this run. So if it was part of what we
+    // checked, @ext//bar does not exist anymore; otherwise it is kept.
+    EXPECT_TRUE(cache.Save(Pattern("@ext//...")));
+  }
+
+  {
+    DWYUResultCache cache(cache_file, "1.0");
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_TRUE(cache.Find(Target("//foo:foo"), 42).has_value());
+  }
+}
+
+TEST(DWYUResultCache, ResultsOfOtherVersionAreNotUsed) {
+  const std::string cache_file = ::testing::TempDir() + "/dwyu-version";
+  unlink(cache_file.c_str());
+  {
+    DWYUResultCache cache(cache_file, "1.0");
+    cache.Update(Target("//foo:foo"), 42, {});
+    EXPECT_TRUE(cache.Save(Pattern("//...")));
+  }
+  EXPECT_EQ(DWYUResultCache(cache_file, "1.0").size(), 1);
+  EXPECT_EQ(DWYUResultCache(cache_file, "1.1").size(), 0);
+}
+}  // namespace bant
@@ -19,19 +19,35 @@
 #define BANT_TOOL_DWYU_INTERNAL_
 
 #include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <ostream>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/container/btree_map.h"
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/time/time.h"
 #include "bant/explore/header-providers.h"
+#include "bant/explore/include-cache.h"
 #include "bant/explore/query-utils.h"
+#include "bant/frontend/ast.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/frontend/source-locator.h"
+#include "bant/label-table.h"
 #include "bant/session.h"
+#include "bant/tool/dwyu-cache.h"
 #include "bant/tool/edit-callback.h"
 #include "bant/types-bazel.h"
+#include "bant/util/cache-file.h"
 
 namespace bant {
 // The DWYUGenerator is the underlying implementation, for which
@@ -39,11 +55,18 @@ namespace bant {
 // just needed in tests.
 class DWYUGenerator {
  public:
+  // If "result_cache" is given, targets whose inputs did not change since
+  // their result was recorded are not checked again. With "include_cache",
+  // sources that did not change since are not read again.
   DWYUGenerator(Session &session, const ParsedProject &project,
-                EditCallback emit_deps_edit);
+                EditCallback emit_deps_edit,
+                DWYUResultCache *result_cache = nullptr,
+                IncludeCache *include_cache = nullptr);
   virtual ~DWYUGenerator() = default;
 
   // Return number of targets that matched pattern and have been processed.
+  // Targets are checked in parallel (see CommandlineFlags::jobs), but
+  // messages and edits are emitted in the same order as checked serially.
   size_t CreateEditsForPattern(const BazelTargetMatcher &pattern);
 
  protected:
@@ -52,21 +75,77 @@ class DWYUGenerator {
     std::string content;  // Content of the file
     std::string path;     // Path relative to current directory.
     bool is_generated;    // This is the output of some other rule.
+    size_t file_size;     // Might be larger if content is only beginning.
   };
 
   // Try to find the given file in the soruce tree or the generated tree,
   // and return content and path. Virtual, to make this class testable.
+  // Called concurrently from multiple threads.
+  // If CommandlineFlags::include_scan_slack is set, only needs to read up to
+  // FindEndOfIncludePreamble().
   virtual std::optional<SourceFile> TryOpenFile(std::string_view source_file);
 
  private:
+  // The #includes extracted from a source file and where they are; the
+  // content itself is not kept. Locates the include paths for messages.
+  struct ScannedSource : public SourceLocator {
+    FileLocation GetLocation(std::string_view text) const final;
+    std::string_view GetSurroundingLine(std::string_view text) const final {
+      return text;  // Content not kept.
+    }
+
+    std::string path;           // Path relative to current directory.
+    bool is_generated = false;  // This is the output of some other rule.
+    IncludeCache::IncludeList includes;
+    StringStore include_storage;  // Include paths, if not owned by cache.
+    uint64_t fingerprint = 0;     // Of content; only with one of the caches.
+  };
+
+  // Everything reported while checking one target: info messages and edits
+  // in the order they happened, and stats. Targets are checked concurrently,
+  // so this is collected and emitted later.
+  struct TargetOutput {
+    using Edit = DWYUResultCache::Edit;
+
+    void AddEdit(EditRequest op, std::string_view before,
+                 std::string_view after) {
+      edits.push_back({info.str(), op, std::string(before),
+                       std::string(after)});
+      info.str("");
+    }
+
+    std::ostringstream info;  // Info messages since last edit.
+    std::vector<Edit> edits;
+    int sources_read = 0;
+    int sources_from_cache = 0;  // Not read: includes known from cache.
+    size_t bytes_read = 0;
+    size_t bytes_scanned = 0;  // Less than read if only preamble is scanned.
+    size_t file_bytes = 0;     // Full size of files read.
+    absl::Duration read_duration;
+    absl::Duration grep_duration;
+    absl::Duration cache_duration;  // Looking up includes in cache.
+    uint64_t fingerprint = 0;  // Of the inputs; only with result cache.
+    bool reused = false;       // Result from the cache.
+  };
+
+  // A library in the project with the details needed for later inspection.
+  struct KnownLibrary {
+    query::Result details;
+    // Visibility patterns compiled once; std::nullopt if visible everywhere.
+    std::optional<BazelPatternBundle> visibility;
+    uint64_t fingerprint = 0;  // Of its rule; only with result cache.
+  };
+
   // Extract all the known targets in project and remember corresponding node
   // in case later inspection is needed (e.g. for visibility).
   void InitKnownLibraries();
+  static std::optional<BazelPatternBundle> CompileVisibility(
+    List *visibility_list, const BazelPackage &package);
 
   // Various predicates to check targets to make decisions to include/exclude.
   bool IsAlwayslink(const BazelTarget &target) const;
-  bool IsTestonlyCompatible(const BazelTarget &target,
-                            const BazelTarget &dep) const;
+  bool IsTestonlyCompatible(const BazelTarget &target, const BazelTarget &dep,
+                            std::ostream &info_out) const;
   // Check if "target" can see "dep". Sets "msg" if not.
   bool CanSee(const BazelTarget &target, const BazelTarget &dep,
               std::string *msg) const;
@@ -80,19 +159,79 @@ class DWYUGenerator {
   // target.
   std::vector<absl::btree_set<BazelTarget>> DependenciesNeededBySources(
     const BazelTarget &target, const ParsedBuildFile &build_file,
-    const std::vector<std::string_view> &sources,
-    bool *all_headers_accounted_for);
+    const query::StringList &sources, bool *all_headers_accounted_for,
+    TargetOutput *out);
+
+  // Fingerprint of everything the result of checking "target" depends on:
+  // flags, the rule, its sources and the libraries that provide included
+  // headers or are in deps. Needs to read the sources.
+  uint64_t InputFingerprint(const BazelTarget &target,
+                            const query::Result &details,
+                            const ParsedBuildFile &build_file,
+                            TargetOutput *out);
+
+  // Fingerprint of the rule "details" and where it is located in its BUILD
+  // file, continuing from "hash".
+  uint64_t RuleFingerprint(const query::Result &details, uint64_t hash) const;
+
+  // Fingerprint of the known library "target" continuing from "hash".
+  uint64_t LibraryFingerprint(const BazelTarget &target, uint64_t hash) const;
 
   void CreateEditsForTarget(const BazelTarget &target,
                             const query::Result &details,
-                            const ParsedBuildFile &build_file);
+                            const ParsedBuildFile &build_file,
+                            TargetOutput *out);
+
+  // Emit what has been collected for "target" in "out".
+  void EmitTargetOutput(const BazelTarget &target, const TargetOutput &out);
+
+  // Return the scanned source file (or nullptr if it can't be found) using
+  // ReadScannedSource(). Sources are typically listed in multiple targets,
+  // so the result is cached, including the fact that it could not be found.
+  // Each file is only read once, even if requested concurrently.
+  // Thread-safe.
+  const ScannedSource *GetScannedSource(std::string_view source_file,
+                                        TargetOutput *out);
+
+  // Read "source_file" using TryOpenFile() and extract its includes; nullptr
+  // if it can't be found. With CommandlineFlags::include_scan_slack, only
+  // the beginning of the file is scanned. With the include cache, unchanged
+  // files are not read at all.
+  std::unique_ptr<ScannedSource> ReadScannedSource(std::string_view source_file,
+                                                   TargetOutput *out);
+
+  // Check if "path" might exist by looking it up in the (cached) listing of
+  // its directory. Avoids open() probing of locations that don't have a
+  // file. Thread-safe.
+  bool MightExist(std::string_view path);
+
+  // Parse "dependency" relative to "package". Thread-safe.
+  std::optional<BazelTarget> ParseDependency(std::string_view dependency,
+                                             const BazelPackage &package);
 
   Session &session_;
   const ParsedProject &project_;
   const EditCallback emit_deps_edit_;
-  ProvidedFromTargetSet headers_from_libs_;
+  DWYUResultCache *const result_cache_;
+  IncludeCache *const include_cache_;
+  HeaderSuffixIndex headers_from_libs_;
   ProvidedFromTarget files_from_genrules_;
-  absl::btree_map<BazelTarget, query::Result> known_libs_;
+  absl::btree_map<BazelTarget, KnownLibrary> known_libs_;
+  std::mutex labels_lock_;
+  LabelTable labels_;  // Parse cache for deps. Guarded by labels_lock_.
+
+  // Sources by path, possibly still being read; nullptr if file could not
+  // be found.
+  std::mutex source_cache_lock_;
+  absl::flat_hash_map<std::string,
+                      std::shared_future<std::unique_ptr<ScannedSource>>>
+    source_cache_;  // Guarded by source_cache_lock_
+
+  // Filenames in a directory; nullptr if directory does not exist.
+  std::mutex dir_listing_lock_;
+  absl::flat_hash_map<std::string,
+                      std::unique_ptr<absl::flat_hash_set<std::string>>>
+    dir_listing_;  // Guarded by dir_listing_lock_
 };
 }  // namespace bant
 
@@ -17,33 +17,49 @@
 
 #include "bant/tool/dwyu.h"
 
+#include <dirent.h>
+
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstddef>
-#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <set>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "bant/explore/header-providers.h"
+#include "bant/explore/include-cache.h"
 #include "bant/explore/query-utils.h"
 #include "bant/frontend/ast.h"
 #include "bant/frontend/named-content.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/frontend/source-locator.h"
 #include "bant/session.h"
+#include "bant/tool/dwyu-cache.h"
 #include "bant/tool/dwyu-internal.h"
 #include "bant/tool/edit-callback.h"
 #include "bant/types-bazel.h"
 #include "bant/types.h"
+#include "bant/util/cache-file.h"
 #include "bant/util/file-utils.h"
 #include "bant/util/stat.h"
+#include "bant/util/thread-pool.h"
 #include "re2/re2.h"
 
 // Looking for source files directly in the source tree, but if not found
@@ -61,31 +77,35 @@ static constexpr std::string_view kSourceLocations[] = {
 
 namespace bant {
 
-// Given a header file, check if it is in the list. Take possible prefix
-// into account.
-static bool IsHeaderInList(std::string_view header,
-                           const std::vector<std::string_view> &list,
-                           std::string_view prefix_path) {
-  // The list items are provided without the full path in the cc_library(),
-  // so we always need to prepend that prefix_path.
-  for (const std::string_view list_item : list) {
-    if (header.ends_with(list_item) &&  // cheap first test before strcat
-        (header == list_item ||
-         absl::StrCat(prefix_path, "/", list_item) == header)) {
-      return true;
+namespace {
+// The sources of a target for quick lookup if an include refers to any of
+// them. The list items are provided without the package path in the
+// cc_library(), so they are also indexed fully qualified.
+class OwnSources {
+ public:
+  OwnSources(const query::StringList &sources, std::string_view package_path) {
+    for (const std::string_view source : sources) {
+      bare_.insert(source);
+      qualified_.insert(absl::StrCat(package_path, "/", source));
     }
   }
-  return false;
-}
 
-static absl::btree_set<BazelTarget> intersect(
-  const absl::btree_set<BazelTarget> &a,
-  const absl::btree_set<BazelTarget> &b) {
-  absl::btree_set<BazelTarget> result;
-  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
-                        std::inserter(result, result.begin()));
-  return result;
-}
+  // Check if "header" is one of the sources, relative to the project root.
+  bool Contains(std::string_view header) const {
+    return bare_.contains(header) || qualified_.contains(header);
+  }
+
+  // Check if "header" is one of the sources without the package path.
+  bool ContainsUnqualified(std::string_view header) const {
+    return bare_.contains(header) ||
+           (header.starts_with('/') && bare_.contains(header.substr(1)));
+  }
+
+ private:
+  absl::flat_hash_set<std::string_view> bare_;
+  absl::flat_hash_set<std::string> qualified_;
+};
+}  // namespace
 
 // Input is a list of dependency alternative we need: for each header file,
 // there are potentially multiple libraries that are providing these,
@@ -97,27 +117,94 @@ static std::vector<absl::btree_set<BazelTarget>> MinimizeDependencySet(
   // The intersection will be sufficient to satisfy the dependency requirements
   // for both.
 
-  // n^2, but usually pretty small n.
+  // Sets are represented as bitsets over all the candidate providers,
+  // so that intersections are cheap even with many alternative sets.
+  // Candidate ids are in BazelTarget sort order.
+  std::vector<const BazelTarget *> candidates;
+  for (const auto &alternatives : to_reduce) {
+    for (const BazelTarget &t : alternatives) candidates.push_back(&t);
+  }
+  auto deref_less = [](const BazelTarget *a, const BazelTarget *b) {
+    return *a < *b;
+  };
+  std::sort(candidates.begin(), candidates.end(), deref_less);
+  candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                               [](const BazelTarget *a, const BazelTarget *b) {
+                                 return *a == *b;
+                               }),
+                   candidates.end());
+
+  const size_t words = (candidates.size() + 63) / 64;
+  std::vector<uint64_t> bits(to_reduce.size() * words, 0);
+  for (size_t i = 0; i < to_reduce.size(); ++i) {
+    uint64_t *const row = &bits[i * words];
+    for (const BazelTarget &t : to_reduce[i]) {
+      const size_t id =
+        std::lower_bound(candidates.begin(), candidates.end(), &t, deref_less) -
+        candidates.begin();
+      row[id / 64] |= uint64_t{1} << (id % 64);
+    }
+  }
+
   std::vector<absl::btree_set<BazelTarget>> result;
-  std::set<size_t> already_covereed;
+  std::vector<bool> already_covered(to_reduce.size(), false);
+  std::vector<uint64_t> current_set(words);
   for (size_t i = 0; i < to_reduce.size(); ++i) {
-    if (already_covereed.contains(i)) continue;
-    already_covereed.insert(i);
-    auto current_set = to_reduce[i];
+    if (already_covered[i]) continue;
+    already_covered[i] = true;
+    std::copy_n(&bits[i * words], words, current_set.begin());
     for (size_t j = i + 1; j < to_reduce.size(); ++j) {
-      auto intersection_set = intersect(current_set, to_reduce[j]);
-      if (intersection_set.empty()) continue;
-      current_set = intersection_set;
-      already_covereed.insert(j);
+      const uint64_t *const other = &bits[j * words];
+      uint64_t any_intersection = 0;
+      for (size_t w = 0; w < words; ++w) {
+        any_intersection |= current_set[w] & other[w];
+      }
+      if (!any_intersection) continue;
+      for (size_t w = 0; w < words; ++w) current_set[w] &= other[w];
+      already_covered[j] = true;
     }
-    CHECK_GT(current_set.size(), size_t(0));
-    result.push_back(current_set);
+
+    absl::btree_set<BazelTarget> &reduced = result.emplace_back();
+    for (size_t w = 0; w < words; ++w) {
+      for (uint64_t word = current_set[w]; word; word &= word - 1) {
+        const size_t id = w * 64 + std::countr_zero(word);
+        reduced.insert(reduced.end(), *candidates[id]);
+      }
+    }
+    CHECK_GT(reduced.size(), size_t(0));
   }
+  return result;
+}
 
-  CHECK(already_covereed.size() == to_reduce.size());
+// Return all the names in the given directory or nullptr if it can't be read.
+static std::unique_ptr<absl::flat_hash_set<std::string>> ListDirectory(
+  const std::string &dir) {
+  DIR *const d = opendir(dir.c_str());
+  if (!d) return nullptr;
+  auto result = std::make_unique<absl::flat_hash_set<std::string>>();
+  while (const struct dirent *entry = readdir(d)) {
+    result->emplace(entry->d_name);
+  }
+  closedir(d);
   return result;
 }
 
+bool DWYUGenerator::MightExist(std::string_view path) {
+  const size_t slash_pos = path.find_last_of('/');
+  const std::string dir(slash_pos == std::string_view::npos
+                          ? "."
+                          : path.substr(0, slash_pos));
+  const std::string_view filename = (slash_pos == std::string_view::npos)
+                                      ? path
+                                      : path.substr(slash_pos + 1);
+  const std::lock_guard<std::mutex> l(dir_listing_lock_);
+  auto found = dir_listing_.find(dir);
+  if (found == dir_listing_.end()) {
+    found = dir_listing_.emplace(dir, ListDirectory(dir)).first;
+  }
+  return found->second != nullptr && found->second->contains(filename);
+}
+
 // Open the given file an return an line-indexed content or nullptr if file
 // not found.
 std::optional<DWYUGenerator::SourceFile> DWYUGenerator::TryOpenFile(
@@ -126,65 +213,244 @@ std::optional<DWYUGenerator::SourceFile> DWYUGenerator::TryOpenFile(
   // File could come from multiple locations, primary or generated.
   result.is_generated = false;
   std::optional<std::string> src_content;
+  const size_t slack = session_.flags().include_scan_slack;
   for (const std::string_view search_path : kSourceLocations) {
     result.path = absl::StrCat(search_path, source_file);
-    src_content = ReadFileToString(FilesystemPath(result.path));
-    if (src_content.has_value()) {
-      result.content = std::move(*src_content);
-      return result;
+    if (MightExist(result.path)) {
+      if (slack > 0) {
+        src_content = ReadFilePrefix(
+          FilesystemPath(result.path),
+          [slack](std::string_view content) {
+            return FindEndOfIncludePreamble(content, slack) !=
+                   std::string_view::npos;
+          },
+          &result.file_size);
+      } else {
+        src_content = ReadFileToString(FilesystemPath(result.path));
+        if (src_content.has_value()) result.file_size = src_content->size();
+      }
+      if (src_content.has_value()) {
+        result.content = std::move(*src_content);
+        return result;
+      }
     }
     result.is_generated = true;  // Only the first in list is direct source
   }
   return std::nullopt;
 }
 
+FileLocation DWYUGenerator::ScannedSource::GetLocation(
+  std::string_view text) const {
+  const auto found = std::find_if(
+    includes.begin(), includes.end(), [text](const IncludeCache::Include &i) {
+      return text.begin() >= i.path.begin() && text.end() <= i.path.end();
+    });
+  CHECK(found != includes.end())
+    << "Attempt to pass '" << text << "' which is not an include in " << path;
+  LineColumn start = found->position;
+  start.col += text.begin() - found->path.begin();
+  const LineColumn end{start.line, start.col + static_cast<int>(text.size())};
+  return {path, {start, end}};
+}
+
+const DWYUGenerator::ScannedSource *DWYUGenerator::GetScannedSource(
+  std::string_view source_file, TargetOutput *out) {
+  // The first thread asking for a file reads it; others asking for the same
+  // file in the meantime wait for that result.
+  std::promise<std::unique_ptr<ScannedSource>> promise;
+  std::shared_future<std::unique_ptr<ScannedSource>> result;
+  {
+    const std::lock_guard<std::mutex> l(source_cache_lock_);
+    auto [found, inserted] =
+      source_cache_.try_emplace(std::string(source_file));
+    if (!inserted) {
+      result = found->second;
+    } else {
+      found->second = promise.get_future().share();
+    }
+  }
+  if (result.valid()) return result.get().get();
+
+  // Not holding the lock while reading.
+  std::unique_ptr<ScannedSource> scanned = ReadScannedSource(source_file, out);
+  const ScannedSource *const scanned_ptr = scanned.get();
+  promise.set_value(std::move(scanned));
+  return scanned_ptr;
+}
+
+std::unique_ptr<DWYUGenerator::ScannedSource> DWYUGenerator::ReadScannedSource(
+  std::string_view source_file, TargetOutput *out) {
+  std::unique_ptr<ScannedSource> scanned;
+  const size_t slack = session_.flags().include_scan_slack;
+
+  // The include cache stamps the file before it is read, so that it only
+  // remembers includes of content at least as new as the stamp.
+  std::string stamped_path;
+  IncludeCache::Lookup lookup;
+  if (include_cache_) {
+    const ScopedTimer timer(&out->cache_duration);
+    bool is_generated = false;  // Same search order as TryOpenFile()
+    for (const std::string_view search_path : kSourceLocations) {
+      std::string path = absl::StrCat(search_path, source_file);
+      if (MightExist(path)) {
+        lookup = include_cache_->Find(FilesystemPath(path), slack);
+        if (lookup.exists) {
+          stamped_path = std::move(path);
+          break;
+        }
+      }
+      is_generated = true;
+    }
+    if (lookup.includes.has_value()) {
+      ++out->sources_from_cache;
+      scanned = std::make_unique<ScannedSource>();
+      scanned->path = std::move(stamped_path);
+      scanned->is_generated = is_generated;
+      scanned->includes = std::move(*lookup.includes);
+      scanned->fingerprint = lookup.fingerprint;
+    }
+  }
+
+  std::optional<SourceFile> source_content;
+  if (!scanned) {
+    const ScopedTimer timer(&out->read_duration);
+    source_content = TryOpenFile(source_file);
+  }
+  if (source_content.has_value()) {
+    ++out->sources_read;
+    out->bytes_read += source_content->content.size();
+    out->file_bytes += source_content->file_size;
+    if (slack > 0) {
+      const size_t end =
+        FindEndOfIncludePreamble(source_content->content, slack);
+      if (end != std::string_view::npos) source_content->content.resize(end);
+    }
+    out->bytes_scanned += source_content->content.size();
+    scanned = std::make_unique<ScannedSource>();
+    scanned->path = std::move(source_content->path);
+    scanned->is_generated = source_content->is_generated;
+    const ScopedTimer timer(&out->grep_duration);
+    if (result_cache_ || include_cache_) {
+      scanned->fingerprint = Fingerprint(source_content->content);
+    }
+    const FilesystemPath cache_key(scanned->path);
+    const bool cacheable = lookup.exists && scanned->path == stamped_path;
+    std::optional<IncludeCache::IncludeList> known;
+    if (cacheable) {  // Touched, but maybe same content.
+      known = include_cache_->FindByContent(cache_key, slack, lookup.stamp,
+                                            scanned->fingerprint);
+    }
+    if (known.has_value()) {
+      scanned->includes = std::move(*known);
+    } else {
+      NamedLineIndexedContent indexed(scanned->path, source_content->content);
+      IncludeCache::IncludeList includes;
+      for (const std::string_view inc_file : ExtractCCIncludes(&indexed)) {
+        includes.push_back(
+          {inc_file, indexed.GetLocation(inc_file).line_column_range.start});
+      }
+      if (cacheable) {
+        scanned->includes = include_cache_->Update(
+          cache_key, slack, lookup.stamp, scanned->fingerprint, includes);
+      } else {  // Content is not kept; copy the include paths.
+        for (IncludeCache::Include &include : includes) {
+          include.path = scanned->include_storage.Keep(include.path);
+        }
+        scanned->includes = std::move(includes);
+      }
+    }
+  }
+
+  return scanned;
+}
+
 // class DWYUGenerator declared in dwyu-internal.h
 // We can only confidently remove a target if we actually know about its
 // existence in the project. If not, be cautious.
 void DWYUGenerator::InitKnownLibraries() {
+  static constexpr query::RuleSet kKnownLibRules{
+    "cc_library",        // The common ones
+    "alias",             // ...
+    "cc_proto_library",  // specialized
+    "grpc_cc_library",   // ...
+    "cc_test",           // also indexing test for testonly check.
+  };
   for (const auto &[_, parsed_package] : project_.ParsedFiles()) {
     const BazelPackage &current_package = parsed_package->package;
-    query::FindTargets(parsed_package->ast,
-                       {"cc_library", "alias",  // The common ones
-                        "cc_proto_library", "grpc_cc_library",  // specialized
-                        "cc_test"},  // also indexing test for testonly check.
+    query::FindTargets(parsed_package->ast, kKnownLibRules,
+                       {query::Attribute::kName, query::Attribute::kAlwayslink,
+                        query::Attribute::kTestonly,
+                        query::Attribute::kDeprecation,
+                        query::Attribute::kVisibility},
                        [&](const query::Result &target) {
                          auto self =
                            current_package.QualifiedTarget(target.name);
                          if (!self.has_value()) {
                            return;
                          }
-                         known_libs_.insert({*self, target});
+                         auto inserted = known_libs_.insert(
+                           {*self,
+                            {target, CompileVisibility(target.visibility,
+                                                       current_package)}});
+                         if (result_cache_ && inserted.second) {
+                           inserted.first->second.fingerprint =
+                             RuleFingerprint(target, kFingerprintInit);
+                         }
                        });
   }
 }
 
+// Compile visibility patterns of a library in "package" for quick matching
+// in CanSee(). Returns std::nullopt if it is visible to everyone.
+std::optional<BazelPatternBundle> DWYUGenerator::CompileVisibility(
+  List *visibility_list, const BazelPackage &package) {
+  if (!visibility_list) return std::nullopt;
+  BazelPatternBundle result;
+  bool any_valid_visiblity_pattern = false;
+  for (Node *entry : *visibility_list) {
+    const Scalar *str = entry->CastAsScalar();
+    if (!str) continue;
+    auto vis_or = BazelPattern::ParseVisibility(str->AsString(), package);
+    if (!vis_or.has_value()) continue;
+    if (!vis_or->HasFilter()) return std::nullopt;  // public
+    result.AddPattern(*vis_or);
+    any_valid_visiblity_pattern = true;
+  }
+  // There might be variables and other things that we couldn't elaborate.
+  // So in case there was not a any pattern we can expand, assume this to
+  // be public visibility.
+  if (!any_valid_visiblity_pattern) return std::nullopt;
+  result.Finish();
+  return result;
+}
+
 // Various predicates to check
 bool DWYUGenerator::IsAlwayslink(const BazelTarget &target) const {
   auto found = known_libs_.find(target);
   if (found == known_libs_.end()) return true;  // Unknown ? Be conservative.
   // TODO: follow all libs we depend on ?
-  return found->second.alwayslink;
+  return found->second.details.alwayslink;
 }
 
 bool DWYUGenerator::IsTestonlyCompatible(const BazelTarget &target,
-                                         const BazelTarget &dep) const {
+                                         const BazelTarget &dep,
+                                         std::ostream &info_out) const {
   const auto dependency_detail_found = known_libs_.find(dep);
   if (dependency_detail_found == known_libs_.end()) return true;
 
-  const query::Result &dep_detail = dependency_detail_found->second;
+  const query::Result &dep_detail = dependency_detail_found->second.details;
   if (!dep_detail.testonly) return true;  // non-testonly always compatible.
 
   const auto target_detail_found = known_libs_.find(target);
   if (target_detail_found == known_libs_.end()) {
     return true;  // Should not happen, but let's not flag as issue.
   }
-  const query::Result &target_detail = target_detail_found->second;
+  const query::Result &target_detail = target_detail_found->second.details;
   if (target_detail.testonly || target_detail.rule == "cc_test") {
     return true;  // target and dependency are both tests.
   }
 
-  project_.Loc(session_.info(), target_detail.name)
+  project_.Loc(info_out, target_detail.name)
     << " '" << target << "' is using headers that would be provided by '" << dep
     << "', but the latter is marked testonly, the former not. "
     << "Not adding dependency.\n";
@@ -198,9 +464,10 @@ bool DWYUGenerator::CanSee(const BazelTarget &target, const BazelTarget &dep,
                            std::string *msg) const {
   const auto found = known_libs_.find(dep);
   if (found == known_libs_.end()) return true;  // Unknown ? Be Bold.
-  if (!found->second.deprecation.empty()) {
+  const KnownLibrary &dep_lib = found->second;
+  if (!dep_lib.details.deprecation.empty()) {
     // Consider a library with a deprecation as not visible.
-    if (msg) *msg = absl::StrCat("deprecated: ", found->second.deprecation);
+    if (msg) *msg = absl::StrCat("deprecated: ", dep_lib.details.deprecation);
     return false;
   }
 
@@ -218,50 +485,44 @@ bool DWYUGenerator::CanSee(const BazelTarget &target, const BazelTarget &dep,
     return false;
   }
 
-  List *visibility_list = found->second.visibility;
-  if (!visibility_list) return true;
-  bool any_valid_visiblity_pattern = false;
-  bool any_non_matching_visibility_pattern = false;
-  for (Node *entry : *visibility_list) {
-    const Scalar *str = entry->CastAsScalar();
-    if (!str) continue;
-    auto vis_or = BazelPattern::ParseVisibility(str->AsString(), dep.package);
-    if (!vis_or.has_value()) continue;
-    any_valid_visiblity_pattern = true;
-    if (vis_or->Match(target)) {
-      return true;
-    }
-    if (msg) {
+  if (!dep_lib.visibility.has_value()) return true;
+  if (dep_lib.visibility->Match(target)) return true;
+
+  // Not visible. Only now assemble the explanation if requested: all the
+  // patterns that are valid did not match.
+  if (msg) {
+    bool any_non_matching_visibility_pattern = false;
+    for (Node *entry : *dep_lib.details.visibility) {
+      const Scalar *str = entry->CastAsScalar();
+      if (!str) continue;
+      if (!BazelPattern::ParseVisibility(str->AsString(), dep.package)) {
+        continue;
+      }
       if (any_non_matching_visibility_pattern) msg->append("; ");
       absl::StrAppend(msg, project_.Loc(str->AsString()), str->AsString(),
                       " visibility not matched");
+      any_non_matching_visibility_pattern = true;
     }
-    any_non_matching_visibility_pattern = true;
   }
-  // There might be variables and other things that we couldn't elaborate.
-  // So in case there was not a any pattern we can expand, assume this to
-  // be public visibility.
-  return !any_valid_visiblity_pattern;
+  return false;
 }
 
 // TODO: needs to be shorter
 std::vector<absl::btree_set<BazelTarget>>
 DWYUGenerator::DependenciesNeededBySources(
   const BazelTarget &target, const ParsedBuildFile &build_file,
-  const std::vector<std::string_view> &sources,
-  bool *all_headers_accounted_for) {
-  Stat &source_read_stats = session_.GetStatsFor("read(C++ source)", "sources");
-  Stat &source_grep_stats = session_.GetStatsFor("Grep'ed for #inc", "sources");
+  const query::StringList &sources, bool *all_headers_accounted_for,
+  TargetOutput *out) {
+  std::ostream &info_out = out->info;
 
-  std::ostream &info_out = session_.info();
-  size_t total_size = 0;
+  const OwnSources own_sources(sources, target.package.path);
 
   // Already provided targets we don't need to emit anymore.
   std::set<BazelTarget> already_provided;
   already_provided.insert(target);
 
   // Log providers if super verbose -vvv
-  auto maybe_log = [&](const NamedLineIndexedContent &source,
+  auto maybe_log = [&](const SourceLocator &source,
                        std::string_view inc_file,
                        const absl::btree_set<BazelTarget> &alternatives) {
     if (session_.flags().verbose < 3) return;
@@ -299,12 +560,8 @@ DWYUGenerator::DependenciesNeededBySources(
   for (const std::string_view src_name : sources) {
     const std::string source_file =
       build_file.package.FullyQualifiedFile(project_.workspace(), src_name);
-    std::optional<DWYUGenerator::SourceFile> source_content;
-    {
-      const ScopedTimer timer(&source_read_stats.duration);
-      source_content = TryOpenFile(source_file);
-    }
-    if (!source_content.has_value()) {
+    const ScannedSource *const scanned = GetScannedSource(source_file, out);
+    if (scanned == nullptr) {
       project_.Loc(info_out, src_name)
         << " Can not read source '" << source_file << "' for target " << target;
       const auto from_genrule = files_from_genrules_.find(source_file);
@@ -317,30 +574,21 @@ DWYUGenerator::DependenciesNeededBySources(
       *all_headers_accounted_for = false;
       continue;
     }
+    const ScannedSource &source = *scanned;
 
     // There migth be multiple complaints about various includes found
     // in the same file. If so, only print reference to BUILD file once.
     bool need_in_source_referenced_message = false;
 
-    ++source_read_stats.count;
-    ++source_grep_stats.count;
-    total_size += source_content->content.size();
-    NamedLineIndexedContent source(source_content->path,
-                                   source_content->content);
-    std::vector<std::string_view> pound_includes;
-    {
-      const ScopedTimer timer(&source_grep_stats.duration);
-      pound_includes = ExtractCCIncludes(&source);
-    }
     // Now for all includes, we need to make sure we can account for it.
-    for (const std::string_view inc_file : pound_includes) {
-      if (IsHeaderInList(inc_file, sources, target.package.path)) {
+    for (const auto &[inc_file, _] : scanned->includes) {
+      if (own_sources.Contains(inc_file)) {
         continue;  // Cool, our own list srcs=[...], hdrs=[...]
       }
 
       // mmh, maybe we included it without the proper prefix ?
-      if (IsHeaderInList(inc_file, sources, "")) {
-        if (!source_content->is_generated) {  // Only complain if actionable
+      if (own_sources.ContainsUnqualified(inc_file)) {
+        if (!scanned->is_generated) {  // Only complain if actionable
           source.Loc(info_out, inc_file)
             << " " << inc_file << " header relative to this file. "
             << "Consider FQN relative to project root.\n";
@@ -349,7 +597,7 @@ DWYUGenerator::DependenciesNeededBySources(
         continue;  // But, anyway, found it in our own sources; accounted for.
       }
 
-      if (const auto &found = FindBySuffix(headers_from_libs_, inc_file);
+      if (const auto &found = headers_from_libs_.FindBySuffix(inc_file);
           found.has_value()) {
         const auto &found_result = found.value();
 
@@ -369,9 +617,9 @@ DWYUGenerator::DependenciesNeededBySources(
 
       // Maybe include is not provided with path relative to project root ?
       const std::string abs_header = build_file.package.QualifiedFile(inc_file);
-      if (const auto &found = FindBySuffix(headers_from_libs_, abs_header);
+      if (const auto &found = headers_from_libs_.FindBySuffix(abs_header);
           found.has_value()) {
-        if (!source_content->is_generated) {  // Only complain if actionable
+        if (!scanned->is_generated) {  // Only complain if actionable
           source.Loc(info_out, inc_file)
             << " " << inc_file << " header relative to this file. "
             << "Consider FQN relative to project root.\n";
@@ -422,26 +670,140 @@ DWYUGenerator::DependenciesNeededBySources(
     }
   }
 
-  source_read_stats.AddBytesProcessed(total_size);
-  source_grep_stats.AddBytesProcessed(total_size);
   return result;
 }
 
+uint64_t DWYUGenerator::RuleFingerprint(const query::Result &details,
+                                       uint64_t hash) const {
+  std::ostringstream printed;
+  printed << details.node << details.visibility;
+  hash = Fingerprint(printed.str(), hash);
+  if (!details.name.empty()) {
+    hash = Fingerprint(project_.Loc(details.name), hash);
+  }
+  for (const std::string_view vis : query::StringListView(details.visibility)) {
+    hash = Fingerprint(project_.Loc(vis), hash);
+  }
+  return hash;
+}
+
+uint64_t DWYUGenerator::LibraryFingerprint(const BazelTarget &target,
+                                           uint64_t hash) const {
+  hash = Fingerprint(target.ToString(), hash);
+  const auto found = known_libs_.find(target);
+  if (found == known_libs_.end()) return hash;
+  return Fingerprint(absl::StrFormat("%x", found->second.fingerprint), hash);
+}
+
+uint64_t DWYUGenerator::InputFingerprint(const BazelTarget &target,
+                                         const query::Result &details,
+                                         const ParsedBuildFile &build_file,
+                                         TargetOutput *out) {
+  uint64_t hash = kFingerprintInit;
+  auto add = [&hash](std::string_view data) {
+    hash = Fingerprint(data, hash);
+    hash = Fingerprint("\n", hash);  // Field separator.
+  };
+  const CommandlineFlags &flags = session_.flags();
+  add(absl::StrCat(flags.verbose, flags.ignore_keep_comment ? "k" : "",
+                   flags.do_color ? "c" : "", ",", flags.include_scan_slack));
+
+  // The rule, and where the strings are that messages refer to. The line of
+  // a dependency might also have a '# keep' comment.
+  hash = RuleFingerprint(details, hash);
+  hash = LibraryFingerprint(target, hash);  // testonly
+  for (const std::string_view dep : query::StringListView(details.deps_list)) {
+    add(project_.Loc(dep));
+    add(project_.GetSurroundingLine(dep));
+    if (auto dep_target = ParseDependency(dep, target.package)) {
+      hash = LibraryFingerprint(*dep_target, hash);
+    }
+  }
+
+  // Libraries and genrules the headers included in sources resolve to.
+  auto add_providers = [&](std::string_view header) {
+    if (const auto found = headers_from_libs_.FindBySuffix(header)) {
+      add(found->match);
+      for (const BazelTarget &provider : *found->target_set) {
+        hash = LibraryFingerprint(provider, hash);
+      }
+    }
+    add("");
+  };
+  auto add_genrule = [&](const std::string &file) {
+    if (const auto found = files_from_genrules_.find(file);
+        found != files_from_genrules_.end()) {
+      add(found->second.ToString());
+    }
+    add("");
+  };
+
+  query::StringList sources;
+  query::AppendStringList(details.srcs_list, sources);
+  query::AppendStringList(details.hdrs_list, sources);
+  for (const std::string_view src_name : sources) {
+    add(project_.Loc(src_name));
+    const std::string source_file =
+      build_file.package.FullyQualifiedFile(project_.workspace(), src_name);
+    const ScannedSource *const scanned = GetScannedSource(source_file, out);
+    if (scanned == nullptr) {
+      add_genrule(source_file);
+      continue;
+    }
+    add(scanned->path);
+    add(scanned->is_generated ? "generated" : "source");
+    add(absl::StrFormat("%x", scanned->fingerprint));
+    for (const auto &[inc_file, _] : scanned->includes) {
+      add(inc_file);
+      add_providers(inc_file);
+      add_providers(build_file.package.QualifiedFile(inc_file));
+      add_genrule(std::string(inc_file));
+    }
+  }
+  return hash;
+}
+
+std::optional<BazelTarget> DWYUGenerator::ParseDependency(
+  std::string_view dependency, const BazelPackage &package) {
+  const std::lock_guard<std::mutex> l(labels_lock_);
+  const PackageId package_id = labels_.Intern(package);
+  const auto id = labels_.ParseAndIntern(dependency, package_id);
+  if (!id.has_value()) return std::nullopt;
+  return labels_.target(*id);
+}
+
 void DWYUGenerator::CreateEditsForTarget(const BazelTarget &target,
                                          const query::Result &details,
-                                         const ParsedBuildFile &build_file) {
+                                         const ParsedBuildFile &build_file,
+                                         TargetOutput *out) {
+  if (result_cache_) {
+    out->fingerprint = InputFingerprint(target, details, build_file, out);
+    std::optional<DWYUResultCache::Result> cached;
+    if (!session_.flags().recheck_all) {
+      cached = result_cache_->Find(target, out->fingerprint);
+    }
+    if (cached.has_value()) {
+      out->edits = std::move(cached->edits);
+      out->info << cached->info;
+      out->reused = true;
+      return;
+    }
+  }
+
+  std::ostream &info_out = out->info;
   // Looking at the include files the sources reference, map these back
   // to the dependencies that provide them: these are the deps we
   // needed.
   bool all_header_deps_known = true;
 
   // Collect sources and headers provided by this library.
-  auto sources = query::ExtractStringList(details.srcs_list);
+  query::StringList sources;
+  query::AppendStringList(details.srcs_list, sources);
   query::AppendStringList(details.hdrs_list, sources);
 
   // Grep for all includes they use to determine which deps we need
-  auto deps_needed = DependenciesNeededBySources(target, build_file, sources,
-                                                 &all_header_deps_known);
+  auto deps_needed = DependenciesNeededBySources(
+    target, build_file, sources, &all_header_deps_known, out);
   deps_needed = MinimizeDependencySet(deps_needed);
   OneToOne<BazelTarget, BazelTarget> checked_off_by;
   auto IsNeededInSourcesAndCheckOff = [&](const BazelTarget &target) -> bool {
@@ -461,31 +823,32 @@ void DWYUGenerator::CreateEditsForTarget(const BazelTarget &target,
   // them off the 'deps_needed' list.
   // Everything deps_needed
   // verify we actually need them. If not: remove.
-  const auto deps = query::ExtractStringList(details.deps_list);
-  for (const std::string_view dependency_target : deps) {
-    const auto requested_target = BazelTarget::ParseFrom(dependency_target,  //
-                                                         target.package);
-    if (!requested_target.has_value()) {
-      project_.Loc(session_.info(), dependency_target)
+  for (const std::string_view dependency_target :
+       query::StringListView(details.deps_list)) {
+    const std::optional<BazelTarget> requested =
+      ParseDependency(dependency_target, target.package);
+    if (!requested.has_value()) {
+      project_.Loc(info_out, dependency_target)
         << " Invalid target name '" << dependency_target << "'\n";
       continue;
     }
+    const BazelTarget &requested_target = *requested;
 
     // Strike off the dependency requested in the build file from the
     // dependendencies we independently determined from the #includes.
     // If it is not on that list, it is a canidate for removal.
-    if (IsNeededInSourcesAndCheckOff(*requested_target)) {
+    if (IsNeededInSourcesAndCheckOff(requested_target)) {
       continue;
     }
 
-    if (checked_off_by.contains(*requested_target)) {
-      const BazelTarget &previously = checked_off_by[*requested_target];
-      if (previously == *requested_target) {
-        project_.Loc(session_.info(), dependency_target)
+    if (checked_off_by.contains(requested_target)) {
+      const BazelTarget &previously = checked_off_by[requested_target];
+      if (previously == requested_target) {
+        project_.Loc(info_out, dependency_target)
           << " in target " << target << ": dependency " << dependency_target
           << " same dependency mentioned multiple times. Run buildifier\n";
       } else {
-        project_.Loc(session_.info(), dependency_target)
+        project_.Loc(info_out, dependency_target)
           << " in target " << target << ": dependency " << dependency_target
           << " provides headers already provided by " << previously
           << " before. Multiple libraries providing the same headers ?\n";
@@ -495,7 +858,7 @@ void DWYUGenerator::CreateEditsForTarget(const BazelTarget &target,
 
     // Looks like we don't need this dependency. But maybe we don't quite know:
     const bool potential_remove_suggestion_safe =
-      all_header_deps_known && !IsAlwayslink(*requested_target);
+      all_header_deps_known && !IsAlwayslink(requested_target);
 
     // Emit the edits.
     if (potential_remove_suggestion_safe) {
@@ -503,11 +866,11 @@ void DWYUGenerator::CreateEditsForTarget(const BazelTarget &target,
       const auto line = project_.GetSurroundingLine(dependency_target);
       if (session_.flags().ignore_keep_comment ||
           !RE2::PartialMatch(line, *kExcludeVetoUserCommentRe)) {
-        emit_deps_edit_(EditRequest::kRemove, target, dependency_target, "");
+        out->AddEdit(EditRequest::kRemove, dependency_target, "");
       }
     } else if (!all_header_deps_known && session_.flags().verbose > 1) {
-      project_.Loc(session_.info(), dependency_target)
-        << ": Unsure what " << requested_target->ToString()
+      project_.Loc(info_out, dependency_target)
+        << ": Unsure what " << requested_target.ToString()
         << " provides, but there are also unaccounted headers. Won't remove.\n";
     }
   }
@@ -516,23 +879,25 @@ void DWYUGenerator::CreateEditsForTarget(const BazelTarget &target,
   for (const auto &need_add_alternatives : deps_needed) {
     // Only possible to auto-add if there is exactly one alternative.
     if (need_add_alternatives.size() > 1) {
-      project_.Loc(session_.info(), details.name)
+      project_.Loc(info_out, details.name)
         << " Can't auto-fix: Referenced headers in " << target
         << " need exactly one of multiple choices\nAlternatives are:\n";
       for (const BazelTarget &target : need_add_alternatives) {
-        session_.info() << "\t" << target << "\n";
+        info_out << "\t" << target << "\n";
       }
       continue;
     }
 
     const BazelTarget &need_add = *need_add_alternatives.begin();
+    // Explanation is only needed if it is printed.
     std::string visibility_msg;
-    if (CanSee(target, need_add, &visibility_msg) &&
-        IsTestonlyCompatible(target, need_add)) {
-      emit_deps_edit_(EditRequest::kAdd, target, "",
-                      need_add.ToStringRelativeTo(target.package));
-    } else if (session_.flags().verbose > 1) {
-      project_.Loc(session_.info(), details.name)
+    const bool explain = session_.flags().verbose > 1;
+    if (CanSee(target, need_add, explain ? &visibility_msg : nullptr) &&
+        IsTestonlyCompatible(target, need_add, info_out)) {
+      out->AddEdit(EditRequest::kAdd, "",
+                   need_add.ToStringRelativeTo(target.package));
+    } else if (explain) {
+      project_.Loc(info_out, details.name)
         << ": Would add " << need_add << ", but not visible. " << visibility_msg
         << "\n";
     }
@@ -541,23 +906,108 @@ void DWYUGenerator::CreateEditsForTarget(const BazelTarget &target,
 
 // -- Publically visible interface
 
-std::vector<std::string_view> ExtractCCIncludes(NamedLineIndexedContent *src) {
-  static const LazyRE2 kIncRe{
-    R"/((?m)("|^\s*#\s*include\s+"((\.\./)*[0-9a-zA-Z_/+-]+(\.[a-zA-Z]+)*)"))/"};
+// Whitespace as in regular expression \s
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static bool IsPathChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '/' || c == '+' ||
+         c == '-';
+}
+
+static bool IsAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
 
+// Given "pos" points to the '#', check if there is an #include "..." and
+// return the path in "header_path". Returns position after closing quote
+// or std::string_view::npos if this is not an include we're interested in.
+// Accepted header path: (\.\./)*[0-9a-zA-Z_/+-]+(\.[a-zA-Z]+)*
+static size_t ParseIncludeAt(std::string_view content, size_t pos,
+                             std::string_view *header_path) {
+  static constexpr std::string_view kInclude = "include";
+  const size_t len = content.size();
+  ++pos;  // '#'
+  while (pos < len && IsSpace(content[pos])) ++pos;
+  if (content.substr(pos, kInclude.size()) != kInclude) {
+    return std::string_view::npos;
+  }
+  pos += kInclude.size();
+  const size_t space_start = pos;
+  while (pos < len && IsSpace(content[pos])) ++pos;
+  if (pos == space_start || pos >= len || content[pos] != '"') {
+    return std::string_view::npos;
+  }
+  const size_t path_start = ++pos;
+  while (content.substr(pos, 3) == "../") pos += 3;
+  const size_t name_start = pos;
+  while (pos < len && IsPathChar(content[pos])) ++pos;
+  if (pos == name_start) return std::string_view::npos;
+  while (pos + 1 < len && content[pos] == '.' && IsAlpha(content[pos + 1])) {
+    pos += 2;
+    while (pos < len && IsAlpha(content[pos])) ++pos;
+  }
+  if (pos >= len || content[pos] != '"') return std::string_view::npos;
+  *header_path = content.substr(path_start, pos - path_start);
+  return pos + 1;
+}
+
+std::vector<std::string_view> ExtractCCIncludes(NamedLineIndexedContent *src) {
+  // Only two characters are of interest: '"' and '#'. Jump between them
+  // with memchr(); only a '#' preceded by nothing but whitespace to the
+  // beginning of a line can start an include.
+  //
   // We don't actually understand strings in c++, so we just pretend by
   // toggle ignore whenever we see one.
   bool best_effort_in_nested_quote_toggle = false;
   std::vector<std::string_view> result;
-  std::string_view run = src->content();
-  std::string_view header_path;
-  std::string_view outer;
-  while (RE2::FindAndConsume(&run, *kIncRe, &outer, &header_path)) {
-    if (outer == "\"") {
+  const std::string_view content = src->content();
+  const char *const begin = content.data();
+  const size_t len = content.size();
+
+  auto find_next = [&](char c, size_t from) -> size_t {
+    if (from >= len) return len;
+    const void *found = memchr(begin + from, c, len - from);
+    return found ? static_cast<const char *>(found) - begin : len;
+  };
+
+  size_t line_start_limit = 0;  // Start of text remaining to be scanned.
+  size_t next_quote = find_next('"', 0);
+  size_t next_hash = find_next('#', 0);
+  for (;;) {
+    if (next_quote < next_hash) {
       best_effort_in_nested_quote_toggle = !best_effort_in_nested_quote_toggle;
-    } else if (!best_effort_in_nested_quote_toggle) {
+      line_start_limit = next_quote + 1;
+      next_quote = find_next('"', next_quote + 1);
+      continue;
+    }
+    if (next_hash >= len) break;
+
+    // Only whitespace allowed between start of line and '#'. Start of our
+    // remaining text also counts as start of line (like ^ in a regex would).
+    size_t pos = next_hash;
+    bool at_line_start = false;
+    while (pos > line_start_limit && IsSpace(begin[pos - 1])) {
+      at_line_start |= (begin[pos - 1] == '\n');
+      --pos;
+    }
+    at_line_start |= (pos == line_start_limit);
+    std::string_view header_path;
+    const size_t include_end =
+      at_line_start ? ParseIncludeAt(content, next_hash, &header_path)
+                    : std::string_view::npos;
+    if (include_end == std::string_view::npos) {
+      next_hash = find_next('#', next_hash + 1);
+      continue;
+    }
+    if (!best_effort_in_nested_quote_toggle) {
       result.push_back(header_path);
     }
+    line_start_limit = include_end;
+    next_quote = find_next('"', include_end);
+    next_hash = find_next('#', include_end);
   }
 
   if (!result.empty()) {
@@ -570,45 +1020,166 @@ std::vector<std::string_view> ExtractCCIncludes(NamedLineIndexedContent *src) {
   return result;
 }
 
+size_t FindEndOfIncludePreamble(std::string_view content, size_t slack) {
+  size_t code_bytes = 0;  // Seen since last #include
+  bool in_block_comment = false;
+  bool in_directive = false;  // Continuation line of preprocessor directive.
+  size_t pos = 0;
+  for (;;) {
+    const size_t eol = content.find('\n', pos);
+    if (eol == std::string_view::npos) break;
+    const std::string_view line = content.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    size_t first = 0;
+    while (first < line.size() && IsSpace(line[first])) ++first;
+    size_t last = line.size();
+    while (last > first && IsSpace(line[last - 1])) --last;
+    const std::string_view text = line.substr(first, last - first);
+    const bool continued = text.ends_with('\\');
+
+    if (in_directive) {
+      in_directive = continued;
+      continue;
+    }
+    if (in_block_comment) {
+      in_block_comment = (text.find("*/") == std::string_view::npos);
+      continue;
+    }
+    if (text.empty() || text.starts_with("//")) continue;
+    if (text.starts_with("/*")) {
+      in_block_comment = (text.find("*/", 2) == std::string_view::npos);
+      continue;
+    }
+    if (text.starts_with('#')) {
+      in_directive = continued;
+      size_t directive = 1;
+      while (directive < text.size() && IsSpace(text[directive])) ++directive;
+      if (text.substr(directive).starts_with("include")) code_bytes = 0;
+      continue;
+    }
+    code_bytes += line.size() + 1;
+    if (code_bytes >= slack) return pos;
+  }
+  return std::string_view::npos;
+}
+
 DWYUGenerator::DWYUGenerator(Session &session, const ParsedProject &project,
-                             EditCallback emit_deps_edit)
+                             EditCallback emit_deps_edit,
+                             DWYUResultCache *result_cache,
+                             IncludeCache *include_cache)
     : session_(session),
       project_(project),
-      emit_deps_edit_(std::move(emit_deps_edit)) {
+      emit_deps_edit_(std::move(emit_deps_edit)),
+      result_cache_(result_cache),
+      include_cache_(include_cache) {
   Stat &stats = session_.GetStatsFor("DWYU preparation", "indexed targets");
   const ScopedTimer timer(&stats.duration);
 
-  headers_from_libs_ = ExtractHeaderToLibMapping(project, session.info(),
-                                                 /*suffix_index=*/true);
+  headers_from_libs_ =
+    HeaderSuffixIndex(ExtractHeaderToLibMapping(project, session.info()));
   files_from_genrules_ = ExtractGeneratedFromGenrule(project, session.info());
   InitKnownLibraries();
   stats.count = known_libs_.size();
 }
 
 size_t DWYUGenerator::CreateEditsForPattern(const BazelTargetMatcher &pattern) {
-  size_t matching_patterns = 0;
+  static constexpr query::RuleSet kCCRules{"cc_library", "cc_binary",
+                                           "cc_test"};
+  // Collect all the targets first, so that they can be worked on in
+  // parallel, but reported in this order.
+  struct TargetToCheck {
+    BazelTarget target;
+    query::Result details;
+    const ParsedBuildFile *build_file;
+  };
+  std::vector<TargetToCheck> targets;
   for (const auto &[_, parsed_package] : project_.ParsedFiles()) {
     const BazelPackage &current_package = parsed_package->package;
     if (!pattern.Match(current_package)) {
       continue;
     }
     query::FindTargets(
-      parsed_package->ast, {"cc_library", "cc_binary", "cc_test"},
+      parsed_package->ast, kCCRules,
+      {query::Attribute::kName, query::Attribute::kSrcs,
+       query::Attribute::kHdrs, query::Attribute::kDeps},
       [&](const query::Result &details) {
         auto target = current_package.QualifiedTarget(details.name);
         if (!target.has_value() || !pattern.Match(*target)) {
           return;
         }
-        ++matching_patterns;
-        CreateEditsForTarget(*target, details, *parsed_package);
+        targets.push_back({*target, details, parsed_package.get()});
       });
   }
-  return matching_patterns;
+
+  std::vector<TargetOutput> outputs(targets.size());
+  const int jobs = session_.flags().jobs > 0
+                     ? session_.flags().jobs
+                     : std::max(1u, std::thread::hardware_concurrency());
+  if (jobs > 1 && targets.size() > 1) {
+    ThreadPool pool(std::min<int>(jobs, targets.size()));
+    std::vector<std::future<void>> done;
+    done.reserve(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+      done.push_back(pool.ExecAsync([this, &targets, &outputs, i]() {
+        const TargetToCheck &t = targets[i];
+        CreateEditsForTarget(t.target, t.details, *t.build_file, &outputs[i]);
+      }));
+    }
+    // Emit in order as results become available.
+    for (size_t i = 0; i < targets.size(); ++i) {
+      done[i].wait();
+      EmitTargetOutput(targets[i].target, outputs[i]);
+    }
+  } else {
+    for (size_t i = 0; i < targets.size(); ++i) {
+      const TargetToCheck &t = targets[i];
+      CreateEditsForTarget(t.target, t.details, *t.build_file, &outputs[i]);
+      EmitTargetOutput(t.target, outputs[i]);
+    }
+  }
+  return targets.size();
+}
+
+void DWYUGenerator::EmitTargetOutput(const BazelTarget &target,
+                                     const TargetOutput &out) {
+  for (const TargetOutput::Edit &edit : out.edits) {
+    session_.info() << edit.info_before;
+    emit_deps_edit_(edit.op, target, edit.before, edit.after);
+  }
+  session_.info() << out.info.str();
+  if (result_cache_ && !out.reused) {
+    result_cache_->Update(target, out.fingerprint,
+                          {.edits = out.edits, .info = out.info.str()});
+  }
+
+  Stat &read_stats = session_.GetStatsFor("read(C++ source)", "sources");
+  read_stats.count += out.sources_read;
+  read_stats.duration += out.read_duration;
+  read_stats.AddBytesProcessed(out.bytes_read);
+  if (session_.flags().include_scan_slack > 0) {
+    // Compare what we actually had to read with the full size of the files.
+    Stat &full_stats = session_.GetStatsFor("  - full size of", "sources");
+    full_stats.count += out.sources_read;
+    full_stats.duration += out.read_duration;
+    full_stats.AddBytesProcessed(out.file_bytes);
+  }
+  Stat &grep_stats = session_.GetStatsFor("Grep'ed for #inc", "sources");
+  grep_stats.count += out.sources_read;
+  grep_stats.duration += out.grep_duration;
+  grep_stats.AddBytesProcessed(out.bytes_scanned);
+  if (include_cache_) {
+    Stat &cached_stats = session_.GetStatsFor("Includes from cache", "sources");
+    cached_stats.count += out.sources_from_cache;
+    cached_stats.duration += out.cache_duration;
+  }
 }
 
 size_t CreateDependencyEdits(Session &session, const ParsedProject &project,
                              const BazelTargetMatcher &pattern,
-                             const EditCallback &emit_deps_edit) {
+                             const EditCallback &emit_deps_edit,
+                             DWYUResultCache *result_cache,
+                             IncludeCache *include_cache) {
   size_t edits_emitted = 0;
   const EditCallback edit_counting_forwarder =
     [&](EditRequest op, const BazelTarget &target,  //
@@ -616,9 +1187,15 @@ size_t CreateDependencyEdits(Session &session, const ParsedProject &project,
       ++edits_emitted;
       emit_deps_edit(op, target, before, after);
     };
-  DWYUGenerator gen(session, project, edit_counting_forwarder);
+  DWYUGenerator gen(session, project, edit_counting_forwarder, result_cache,
+                    include_cache);
   const size_t target_count = gen.CreateEditsForPattern(pattern);
-  session.info() << "Checked DWYU on " << target_count << " targets.";
+  session.info() << "Checked DWYU on " << target_count << " targets";
+  if (result_cache) {
+    session.info() << " (" << result_cache->reused()
+                   << " unchanged since last run)";
+  }
+  session.info() << ".";
   if (edits_emitted) {
     session.info() << " Emitted " << edits_emitted << " edits.";
   }
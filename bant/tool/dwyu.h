@@ -22,9 +22,11 @@
 #include <string_view>
 #include <vector>
 
+#include "bant/explore/include-cache.h"
 #include "bant/frontend/named-content.h"
 #include "bant/frontend/parsed-project.h"
 #include "bant/session.h"
+#include "bant/tool/dwyu-cache.h"
 #include "bant/tool/edit-callback.h"
 #include "bant/types-bazel.h"
 
@@ -35,14 +37,27 @@ namespace bant {
 // Initialize the line index in src to be able to refer back to origainal.
 std::vector<std::string_view> ExtractCCIncludes(NamedLineIndexedContent *src);
 
+// Includes are typically at the beginning of a file. Return the position
+// after the first line at which at least "slack" bytes of code have been
+// seen following the last #include; no further includes are expected after
+// that. Preprocessor lines, empty lines and comments don't count as code.
+// Only complete lines are considered; returns std::string_view::npos if
+// the end of the preamble is not within "content".
+size_t FindEndOfIncludePreamble(std::string_view content, size_t slack);
+
 // Look through the sources mentioned in the file, check what they include
 // and determine what dependencies need to be added/removed.
 // Input should be an elaborated project for best availability of inspected
 // lists.
+// If "result_cache" is given, results of targets that did not change since
+// are taken from there, and it is updated with the new ones. Likewise,
+// "include_cache" provides the includes of sources that did not change.
 // Return number of edits that have been emitted.
 size_t CreateDependencyEdits(Session &session, const ParsedProject &project,
                              const BazelTargetMatcher &pattern,
-                             const EditCallback &emit_deps_edit);
+                             const EditCallback &emit_deps_edit,
+                             DWYUResultCache *result_cache = nullptr,
+                             IncludeCache *include_cache = nullptr);
 
 }  // namespace bant
 
@@ -0,0 +1,102 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <cstddef>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bant/frontend/named-content.h"
+#include "bant/tool/dwyu.h"
+#include "bant/util/file-utils.h"
+#include "benchmark/benchmark.h"
+#include "re2/re2.h"
+
+namespace bant {
+namespace {
+// Corpus of all *.cc and *.h files found in $BANT_BENCHMARK_CORPUS, or, if
+// not set, in the workspace `bazel run` was invoked from.
+const std::vector<std::string> &GetCorpus() {
+  static const std::vector<std::string> *const corpus = [] {
+    const char *dir = getenv("BANT_BENCHMARK_CORPUS");
+    if (!dir) dir = getenv("BUILD_WORKSPACE_DIRECTORY");
+    if (!dir) dir = ".";
+    auto *result = new std::vector<std::string>();
+    const auto files = CollectFilesRecursive(
+      FilesystemPath(dir),
+      [](const FilesystemPath &d) {
+        return !d.filename().starts_with(".") &&
+               !d.filename().starts_with("bazel-");
+      },
+      [](const FilesystemPath &f) {
+        return f.filename().ends_with(".cc") || f.filename().ends_with(".h");
+      });
+    for (const FilesystemPath &f : files) {
+      if (std::optional<std::string> content = ReadFileToString(f)) {
+        result->push_back(std::move(*content));
+      }
+    }
+    return result;
+  }();
+  return *corpus;
+}
+
+// The regular expression based extraction ExtractCCIncludes() used to do;
+// as reference.
+std::vector<std::string_view> RegexExtractCCIncludes(
+  NamedLineIndexedContent *src) {
+  static const LazyRE2 kIncRe{
+    R"/((?m)("|^\s*#\s*include\s+"((\.\./)*[0-9a-zA-Z_/+-]+(\.[a-zA-Z]+)*)"))/"};
+  bool best_effort_in_nested_quote_toggle = false;
+  std::vector<std::string_view> result;
+  std::string_view run = src->content();
+  std::string_view header_path;
+  std::string_view outer;
+  while (RE2::FindAndConsume(&run, *kIncRe, &outer, &header_path)) {
+    if (outer == "\"") {
+      best_effort_in_nested_quote_toggle = !best_effort_in_nested_quote_toggle;
+    } else if (!best_effort_in_nested_quote_toggle) {
+      result.push_back(header_path);
+    }
+  }
+  return result;
+}
+
+template <std::vector<std::string_view> (*kExtractor)(
+  NamedLineIndexedContent *)>
+void BM_ExtractIncludes(benchmark::State &state) {
+  const std::vector<std::string> &corpus = GetCorpus();
+  size_t bytes = 0;
+  for (const std::string &content : corpus) bytes += content.size();
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const std::string &content : corpus) {
+      NamedLineIndexedContent src("<benchmark>", content);
+      found += kExtractor(&src).size();
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  state.counters["files"] = corpus.size();
+}
+BENCHMARK(BM_ExtractIncludes<RegexExtractCCIncludes>);
+BENCHMARK(BM_ExtractIncludes<ExtractCCIncludes>);
+}  // namespace
+}  // namespace bant
@@ -18,20 +18,25 @@
 #include "bant/tool/dwyu.h"
 
 #include <cstddef>
+#include <initializer_list>
+#include <mutex>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "bant/frontend/named-content.h"
 #include "bant/frontend/parsed-project.h"
 #include "bant/frontend/parsed-project_testutil.h"
 #include "bant/frontend/source-locator.h"
 #include "bant/session.h"
+#include "bant/tool/dwyu-cache.h"
 #include "bant/tool/dwyu-internal.h"
 #include "bant/tool/edit-callback_testutil.h"
 #include "bant/types-bazel.h"
@@ -89,6 +94,54 @@ R"(
   EXPECT_EQ(PosOfPart(scanned_src, includes, 5), (LineColumn{12, 15}));
 }
 
+TEST(DWYUTest, HeaderFilesInStringsAreIgnored) {
+  constexpr std::string_view kTestContent = R"(
+const char *s = "foo";
+#include "after-string.h"
+const char *multi_line_string = "
+#include "in-string.h"
+";
+#include "not-valid.h2"     // Not extracted, but quotes don't confuse us.
+#include "after.h"
+)";
+  NamedLineIndexedContent scanned_src("<text>", kTestContent);
+  const auto includes = ExtractCCIncludes(&scanned_src);
+  EXPECT_THAT(includes, ElementsAre("after-string.h", "after.h"));
+  EXPECT_EQ(PosOfPart(scanned_src, includes, 1), (LineColumn{7, 10}));
+}
+
+TEST(DWYUTest, EndOfIncludePreambleIsDetermined) {
+  constexpr std::string_view kTestContent = R"(/* License
+ * header; multiple lines of comment are not counted.
+ */
+#include "foo.h"
+#define SOME_MACRO(x) \
+  do_something_with(x)
+
+// Comments also don't count.
+int some_code_that_is_more_than_twenty = 42;
+#include "bar.h"
+int a = 1;
+int b = 2;
+int c = 3;
+int d = 4;
+int e = 5;
+#include "baz.h"
+)";
+  // The code between foo.h and bar.h is long enough, so would stop before
+  // reaching bar.h.
+  EXPECT_EQ(FindEndOfIncludePreamble(kTestContent, 20),
+            kTestContent.find("#include \"bar.h\""));
+
+  // Needs to see more, and just before baz.h we have seen enough.
+  EXPECT_EQ(FindEndOfIncludePreamble(kTestContent, 50),
+            kTestContent.find("#include \"baz.h\""));
+
+  // Not enough code after last include: need to scan until the end.
+  EXPECT_EQ(FindEndOfIncludePreamble(kTestContent, 60),
+            std::string_view::npos);
+}
+
 namespace {
 
 // A DWYUGenerator with a mocked-out way to extract the sources.
@@ -100,16 +153,31 @@ class TestableDWYUGenerator : public bant::DWYUGenerator {
     source_content_[name] = content;
   }
 
+  // Number of times TryOpenFile() has been called for "name".
+  int OpenCount(std::string_view name) {
+    const std::lock_guard<std::mutex> l(open_count_lock_);
+    auto found = open_count_.find(name);
+    return found == open_count_.end() ? 0 : found->second;
+  }
+
  protected:
   std::optional<SourceFile> TryOpenFile(std::string_view source_file) override {
+    {
+      const std::lock_guard<std::mutex> l(open_count_lock_);
+      ++open_count_[source_file];
+    }
     auto found = source_content_.find(source_file);
     if (found == source_content_.end()) return std::nullopt;
-    return SourceFile{
-      .content = found->second, .path = found->first, .is_generated = false};
+    return SourceFile{.content = found->second,
+                      .path = found->first,
+                      .is_generated = false,
+                      .file_size = found->second.size()};
   }
 
  private:
   absl::flat_hash_map<std::string, std::string> source_content_;
+  std::mutex open_count_lock_;
+  absl::flat_hash_map<std::string, int> open_count_;
 };
 
 // Putthing it all together
@@ -159,6 +227,67 @@ class DWYUTestFixture {
 };
 }  // namespace
 
+TEST(DWYUTest, IncludeScanStopsAfterPreambleIfRequested) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//some/path", R"(
+cc_library(
+  name = "foo",
+  hdrs = ["foo.h"],
+)
+
+cc_library(
+  name = "bar",
+  srcs = ["bar.cc"],
+)
+)");
+  constexpr std::string_view kSource = R"(
+int first_function() { return 42; }
+int second_function() { return 42; }
+#include "some/path/foo.h"  // Only found if file is scanned completely
+)";
+
+  for (const size_t slack : {0, 80, 30}) {
+    std::stringstream log;
+    Session session(
+      &log, &log, CommandlineFlags{.verbose = 1, .include_scan_slack = slack});
+    EditExpector edit_expector;
+    if (slack != 30) edit_expector.ExpectAdd(":foo");
+    TestableDWYUGenerator dwyu(session, pp.project(), edit_expector.checker());
+    dwyu.AddSource("some/path/foo.h", "");
+    dwyu.AddSource("some/path/bar.cc", kSource);
+    dwyu.CreateEditsForPattern(*BazelPattern::ParseFrom("//some/path:bar"));
+  }
+}
+
+TEST(DWYUTest, OwnSourcesAreAccountedFor) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//some/path", R"(
+cc_library(
+  name = "foo",
+  hdrs = ["foo.h"]
+)
+
+cc_library(
+  name = "bar",
+  hdrs = ["bar.h", "sub/baz.h"],
+  srcs = ["bar.cc", "internal.h"],
+)
+)");
+
+  // Own headers, qualified or relative to package, don't need any library.
+  DWYUTestFixture tester(pp.project());
+  tester.AddSource("some/path/bar.h", "");
+  tester.AddSource("some/path/sub/baz.h", "");
+  tester.AddSource("some/path/internal.h", "");
+  tester.AddSource("some/path/bar.cc", R"(
+#include "some/path/bar.h"
+#include "some/path/sub/baz.h"
+#include "internal.h"
+#include "sub/baz.h"
+)");
+  tester.RunForTarget("//some/path:bar");
+}
+
 TEST(DWYUTest, Add_MissingDependency) {
   ParsedProjectTestUtil pp;
   pp.Add("//some/path", R"(
@@ -464,6 +593,48 @@ cc_library(
   tester.RunForTarget("//some/path:bar");
 }
 
+TEST(DWYUTest, Add_OnlyIfVisibilityPatternMatches) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//lib/path", R"(
+cc_library(
+  name = "foo",
+  srcs = ["foo.cc"],
+  hdrs = ["foo.h"],
+  visibility = [
+     "//some/path:__pkg__",
+     "//other/path:__subpackages__",
+  ],
+)
+)");
+
+  for (const std::string_view package :
+       {"some/path", "some/path/below", "other/path", "other/path/below",
+        "unrelated/path"}) {
+    pp.Add(absl::StrCat("//", package), R"(
+cc_library(
+  name = "bar",
+  srcs = ["bar.cc"],
+)
+)");
+  }
+
+  for (const auto &[package, expect_visible] :
+       std::initializer_list<std::pair<std::string_view, bool>>{
+         {"some/path", true},
+         {"some/path/below", false},  // only __pkg__
+         {"other/path", true},
+         {"other/path/below", true},
+         {"unrelated/path", false},
+       }) {
+    DWYUTestFixture tester(pp.project());
+    if (expect_visible) tester.ExpectAdd("//lib/path:foo");
+    tester.AddSource(absl::StrCat(package, "/bar.cc"), R"(
+#include "lib/path/foo.h"
+)");
+    tester.RunForTarget(absl::StrCat("//", package, ":bar"));
+  }
+}
+
 // We don't handle package groups properly yet, so should be treated
 // as //visibility:public
 TEST(DWYUTest, Add_IfVisibilityIsPackageGroup) {
@@ -904,4 +1075,158 @@ cc_binary(
   }
 }
 
+TEST(DWYUTest, SourcesListedInMultipleTargetsAreOnlyOpenedOnce) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//some/path", R"(
+cc_library(
+  name = "foo",
+  srcs = ["foo.cc"],
+  hdrs = ["shared.h", "gone.h"],
+)
+
+cc_library(
+  name = "bar",
+  srcs = ["bar.cc"],
+  hdrs = ["shared.h", "gone.h"],
+)
+)");
+
+  // Targets are checked concurrently; still, each file is read only once.
+  std::stringstream log;
+  Session session(&log, &log, CommandlineFlags{.jobs = 8});
+  TestableDWYUGenerator dwyu(session, pp.project(),
+                             [](EditRequest, const BazelTarget &,
+                                std::string_view, std::string_view) {});
+  dwyu.AddSource("some/path/foo.cc", "#include \"some/path/shared.h\"\n");
+  dwyu.AddSource("some/path/bar.cc", "#include \"some/path/shared.h\"\n");
+  dwyu.AddSource("some/path/shared.h", "");
+  dwyu.CreateEditsForPattern(*BazelPattern::ParseFrom("//some/path/..."));
+
+  EXPECT_EQ(dwyu.OpenCount("some/path/foo.cc"), 1);
+  EXPECT_EQ(dwyu.OpenCount("some/path/shared.h"), 1);
+  EXPECT_EQ(dwyu.OpenCount("some/path/gone.h"), 1);  // Not found also cached.
+
+  // Missing file is still reported for each target referencing it.
+  EXPECT_THAT(log.str(), HasSubstr("'some/path/gone.h' for target "
+                                   "//some/path:foo"));
+  EXPECT_THAT(log.str(), HasSubstr("'some/path/gone.h' for target "
+                                   "//some/path:bar"));
+}
+
+TEST(DWYUTest, ResultsOfUnchangedTargetsAreReusedFromCache) {
+  ParsedProjectTestUtil pp;
+  pp.Add("//lib", R"(
+cc_library(
+  name = "a",
+  hdrs = ["a.h"],
+  visibility = ["//visibility:public"],
+)
+
+cc_library(
+  name = "b",
+  hdrs = ["b.h"],
+  visibility = ["//visibility:public"],
+)
+)");
+  pp.Add("//some/path", R"(
+cc_library(
+  name = "foo",
+  srcs = ["foo.cc"],
+  deps = ["//lib:a"],
+)
+)");
+
+  const std::string cache_file = ::testing::TempDir() + "/dwyu-test-results";
+  DWYUResultCache cache(cache_file, "1.0");
+  std::stringstream log;
+  auto run_with_source = [&](std::string_view content, EditExpector &expect,
+                             const CommandlineFlags &flags = {}) {
+    Session session(&log, &log, flags);
+    TestableDWYUGenerator dwyu(session, pp.project(), expect.checker(),
+                               &cache);
+    dwyu.AddSource("some/path/foo.cc", content);
+    dwyu.AddSource("lib/a.h", "");
+    dwyu.AddSource("lib/b.h", "");
+    dwyu.CreateEditsForPattern(*BazelPattern::ParseFrom("//some/path/..."));
+  };
+
+  {
+    EditExpector expect;
+    expect.ExpectRemove("//lib:a").ExpectAdd("//lib:b");
+    run_with_source("#include \"lib/b.h\"\n", expect);
+    EXPECT_EQ(cache.reused(), 0);
+  }
+
+  {  // Nothing changed: the same edits, but from the cache.
+    EditExpector expect;
+    expect.ExpectRemove("//lib:a").ExpectAdd("//lib:b");
+    run_with_source("#include \"lib/b.h\"\n", expect);
+    EXPECT_EQ(cache.reused(), 1);
+  }
+
+  {  // Changed source: needs to be checked again.
+    EditExpector expect;
+    run_with_source("#include \"lib/a.h\"\n", expect);
+    EXPECT_EQ(cache.reused(), 1);
+  }
+
+  {  // Unchanged, but asked to check everything again.
+    EditExpector expect;
+    run_with_source("#include \"lib/a.h\"\n", expect, {.recheck_all = true});
+    EXPECT_EQ(cache.reused(), 1);
+  }
+}
+
+TEST(DWYUTest, ParallelRunEmitsSameOutputInSameOrder) {
+  ParsedProjectTestUtil pp;
+  std::string build_file;
+  for (int i = 0; i < 20; ++i) {
+    build_file += absl::StrFormat(R"(
+cc_library(
+  name = "lib%d",
+  srcs = ["lib%d.cc"],
+  hdrs = ["lib%d.h"],
+  deps = [":unused%d"],
+)
+cc_library(
+  name = "unused%d",
+  hdrs = ["unused%d.h"],
+)
+)",
+                                  i, i, i, i, i, i);
+  }
+  pp.Add("//some/path", build_file);
+
+  // Info messages and edits go to the same stream to observe their order.
+  auto run_with_jobs = [&](int jobs) {
+    std::stringstream output;
+    Session session(&output, &output,
+                    CommandlineFlags{.verbose = 2, .jobs = jobs});
+    TestableDWYUGenerator dwyu(
+      session, pp.project(),
+      [&](EditRequest op, const BazelTarget &target, std::string_view before,
+          std::string_view after) {
+        output << "edit " << static_cast<int>(op) << " " << target << " "
+               << before << " " << after << "\n";
+      });
+    for (int i = 0; i < 20; ++i) {
+      dwyu.AddSource(absl::StrFormat("some/path/lib%d.h", i), "");
+      // Include a header that can't be found to have some info message.
+      dwyu.AddSource(absl::StrFormat("some/path/lib%d.cc", i),
+                     absl::StrFormat("#include \"some/path/lib%d.h\"\n"
+                                     "#include \"some/path/unknown%d.h\"\n"
+                                     "#include \"some/path/unused%d.h\"\n",
+                                     i, i, (i + 1) % 20));
+      dwyu.AddSource(absl::StrFormat("some/path/unused%d.h", i), "");
+    }
+    dwyu.CreateEditsForPattern(*BazelPattern::ParseFrom("//some/path/..."));
+    return output.str();
+  };
+
+  const std::string serial = run_with_jobs(1);
+  EXPECT_THAT(serial, HasSubstr("edit "));
+  EXPECT_THAT(serial, HasSubstr("unknown provider"));
+  EXPECT_EQ(run_with_jobs(8), serial);
+}
+
 }  // namespace bant
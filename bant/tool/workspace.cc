@@ -23,6 +23,7 @@
 
 #include "bant/explore/query-utils.h"
 #include "bant/frontend/parsed-project.h"
+#include "bant/label-table.h"
 #include "bant/session.h"
 #include "bant/types-bazel.h"
 #include "bant/types.h"
@@ -55,13 +56,18 @@ BazelWorkspace CreateFilteredWorkspace(Session &session,
 
   const BazelWorkspace &global_workspace = project.workspace();
   BazelWorkspace matching_workspace_subset;
+  LabelTable labels;
   for (const auto &[_, parsed_package] : project.ParsedFiles()) {
     const BazelPackage &current_package = parsed_package->package;
     if (!pattern.Match(current_package)) {
       continue;
     }
+    const PackageId current_package_id = labels.Intern(current_package);
     query::FindTargetsAllowEmptyName(
-      parsed_package->ast, {}, [&](const query::Result &details) {
+      parsed_package->ast, {},
+      {query::Attribute::kName, query::Attribute::kDeps,
+       query::Attribute::kActual},
+      [&](const query::Result &details) {
         std::vector<std::string_view> potential_external_refs;
         if (details.rule == "load") {  // load() calls at package level.
           // load() has positional arguments (and no 'name').
@@ -82,11 +88,12 @@ BazelWorkspace CreateFilteredWorkspace(Session &session,
 
         // Alright, now let's check these if they reference external projects.
         for (const std::string_view ref : potential_external_refs) {
-          const auto ref_target = BazelTarget::ParseFrom(ref, current_package);
-          if (!ref_target.has_value()) continue;  // could not parse.
+          const auto ref_id = labels.ParseAndIntern(ref, current_package_id);
+          if (!ref_id.has_value()) continue;  // could not parse.
+          const BazelTarget &ref_target = labels.target(*ref_id);
 
           // We're only interested in printing projects other than our own.
-          const std::string &project = ref_target->package.project;
+          const std::string &project = ref_target.package.project;
           if (project.empty() || project == current_package.project) continue;
 
           // If available in global workspace, transfer to our filtered subset.
@@ -17,6 +17,7 @@
 
 #include "bant/types-bazel.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <memory>
@@ -26,6 +27,8 @@
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
@@ -66,48 +69,53 @@ std::string BazelPackage::FullyQualifiedFile(
   return root_dir.append(QualifiedFile(relative_file));
 }
 
-/*static*/ std::optional<BazelPackage> BazelPackage::ParseFrom(
-  std::string_view str) {
+// Parse the package part of a label into project and path without
+// allocating. Returns false if this does not look like a valid package.
+static bool ParsePackageParts(std::string_view str, std::string_view *project,
+                              std::string_view *path) {
   auto maybe_colon = str.find_last_of(':');
   str = str.substr(0, maybe_colon);
 
-  using absl::StrSplit;
-  if (str.size() < 2) return std::nullopt;
-  std::string_view project;
-  std::string_view path;
+  if (str.size() < 2) return false;
   if (str[0] == '@') {
-    project = str.substr(0, str.find_first_of('/'));
-    path = str.substr(project.length());
-    if (project == "@") {
-      project = "";  // This is just our project package.
+    *project = str.substr(0, str.find_first_of('/'));
+    *path = str.substr(project->length());
+    if (*project == "@") {
+      *project = "";  // This is just our project package.
     }
   } else {
-    project = "";
-    path = str;
+    *project = "";
+    *path = str;
   }
-  while (!path.empty() && path.front() == '/') path.remove_prefix(1);
-  while (!path.empty() && path.back() == '/') path.remove_suffix(1);
-  if (absl::StrContains(path, "//")) {
-    return std::nullopt;  // Something is off.
+  while (!path->empty() && path->front() == '/') path->remove_prefix(1);
+  while (!path->empty() && path->back() == '/') path->remove_suffix(1);
+  if (absl::StrContains(*path, "//")) {
+    return false;  // Something is off.
   }
-  auto tilde_pos = project.find_first_of('~');
+  auto tilde_pos = project->find_first_of('~');
   if (tilde_pos != std::string_view::npos) {  // bzlmod puts version after ~
     // version = project.substr(tilde_pos + 1);
-    project = project.substr(0, tilde_pos);
+    *project = project->substr(0, tilde_pos);
   }
+  return true;
+}
+
+/*static*/ std::optional<BazelPackage> BazelPackage::ParseFrom(
+  std::string_view str) {
+  std::string_view project;
+  std::string_view path;
+  if (!ParsePackageParts(str, &project, &path)) return std::nullopt;
   return BazelPackage(project, path);
 }
 
 /*static*/ std::optional<BazelTarget> BazelTarget::ParseFrom(
   std::string_view str, const BazelPackage &context) {
-  const std::string_view project = context.project;
   std::string_view package;
   std::string_view target;
 
-  std::vector<std::string_view> parts = absl::StrSplit(str, ':');
-  switch (parts.size()) {
-  case 1: {
-    package = parts[0];
+  const size_t colon_pos = str.find(':');
+  if (colon_pos == std::string_view::npos) {
+    package = str;
     auto last_slash = package.find_last_of('/');
     if (last_slash != std::string_view::npos) {
       // //absl/strings to be interpreted as //absl/strings:strings
@@ -119,28 +127,25 @@ std::string BazelPackage::FullyQualifiedFile(
       package = "";  // Package without delimiter or package.
       target = str;
     }
-    break;
-  }
-  case 2: {
-    package = parts[0];
-    target = parts[1];
-    break;
-  }
-  default:  //
-    return std::nullopt;
+  } else {
+    package = str.substr(0, colon_pos);
+    target = str.substr(colon_pos + 1);
+    if (target.find(':') != std::string_view::npos) {
+      return std::nullopt;  // More than one colon.
+    }
   }
   if (package.empty()) {
     return BazelTarget(context, target);
   }
-  auto package_part = BazelPackage::ParseFrom(package);
-  if (!package_part.has_value()) {
+  std::string_view project;
+  std::string_view path;
+  if (!ParsePackageParts(package, &project, &path)) {
     return std::nullopt;
   }
-  BazelPackage parsed_package = package_part.value();
-  if (parsed_package.project.empty()) {
-    parsed_package.project = project;
+  if (project.empty()) {
+    project = context.project;
   }
-  return BazelTarget(parsed_package, target);
+  return BazelTarget(BazelPackage(project, path), target);
 }
 
 static std::string_view PackageLastElement(const BazelPackage &p) {
@@ -312,18 +317,192 @@ bool BazelPattern::Match(const BazelPackage &package) const {
   return false;
 }
 
-bool BazelPatternBundle::Match(const BazelTarget &target) const {
-  for (const auto &pattern : patterns_) {
-    if (pattern.Match(target)) return true;
+// All patterns of a bundle in a trie of package path elements, one per
+// project. The nodes record which patterns apply at that package. All target
+// name globs are combined in one RE2::Set.
+class CompiledPatternSet {
+ public:
+  explicit CompiledPatternSet(const std::vector<BazelPattern> &patterns);
+
+  // Same semantics as BazelPattern::Match(), but for all patterns at once.
+  bool Match(const BazelTarget &target) const;
+  bool Match(const BazelPackage &package) const;
+
+  // Package is matched in its entirety (recursive or all-targets pattern).
+  bool MatchAllTargets(const BazelPackage &package) const;
+
+  // Package and all below it are matched by a recursive pattern.
+  bool MatchRecursively(const BazelPackage &package) const;
+
+ private:
+  struct Node {
+    absl::flat_hash_map<std::string, std::unique_ptr<Node>> children;
+    bool recursive = false;    // This package and everything below.
+    bool all_targets = false;  // All targets in this package.
+    absl::flat_hash_set<std::string> target_names;
+    std::vector<int> target_regex;  // Index into target_regex_set_
+
+    bool HasPattern() const {
+      return recursive || all_targets || !target_names.empty() ||
+             !target_regex.empty();
+    }
+  };
+
+  Node *Insert(const BazelPackage &package);
+
+  // Walk down the trie following the package path. Returns the node for the
+  // package or nullptr if there is none. If the walk passes a recursive node,
+  // stops early and sets "*in_recursive" to true.
+  const Node *Find(const BazelPackage &package, bool *in_recursive) const;
+
+  bool always_match_ = false;
+  absl::flat_hash_map<std::string, Node> project_roots_;
+  std::unique_ptr<RE2::Set> target_regex_set_;
+};
+
+CompiledPatternSet::CompiledPatternSet(
+  const std::vector<BazelPattern> &patterns) {
+  using MatchKind = BazelPattern::MatchKind;
+  for (const BazelPattern &pattern : patterns) {
+    if (pattern.kind_ == MatchKind::kAlwaysMatch) {
+      always_match_ = true;
+      continue;
+    }
+    Node *node = Insert(pattern.match_pattern_.package);
+    switch (pattern.kind_) {
+    case MatchKind::kExact:
+      node->target_names.insert(pattern.match_pattern_.target_name);
+      break;
+    case MatchKind::kTargetRegex: {
+      if (!target_regex_set_) {
+        target_regex_set_ =
+          std::make_unique<RE2::Set>(RE2::Options(), RE2::ANCHOR_BOTH);
+      }
+      std::string error;
+      const int index =
+        target_regex_set_->Add(pattern.regex_pattern_->pattern(), &error);
+      if (index < 0) {  // Should not happen, was valid as individual regex.
+        std::cerr << "Pattern issue " << error << "\n";
+        continue;
+      }
+      node->target_regex.push_back(index);
+      break;
+    }
+    case MatchKind::kAllTargetInPackage: node->all_targets = true; break;
+    case MatchKind::kRecursive: node->recursive = true; break;
+    case MatchKind::kAlwaysMatch: break;  // Handled above.
+    }
+  }
+  if (target_regex_set_ && !target_regex_set_->Compile()) {
+    std::cerr << "Could not compile target patterns.\n";
+    target_regex_set_.reset();
   }
-  return false;
 }
 
-bool BazelPatternBundle::Match(const BazelPackage &package) const {
-  for (const auto &pattern : patterns_) {
-    if (pattern.Match(package)) return true;
+CompiledPatternSet::Node *CompiledPatternSet::Insert(
+  const BazelPackage &package) {
+  Node *node = &project_roots_[package.project];
+  if (package.path.empty()) return node;
+  for (const std::string_view element : absl::StrSplit(package.path, '/')) {
+    std::unique_ptr<Node> &child = node->children[element];
+    if (!child) child = std::make_unique<Node>();
+    node = child.get();
+  }
+  return node;
+}
+
+const CompiledPatternSet::Node *CompiledPatternSet::Find(
+  const BazelPackage &package, bool *in_recursive) const {
+  auto found_root = project_roots_.find(package.project);
+  if (found_root == project_roots_.end()) return nullptr;
+  const Node *node = &found_root->second;
+  std::string_view path = package.path;
+  for (;;) {
+    if (node->recursive) {
+      *in_recursive = true;
+      return node;
+    }
+    if (path.empty()) return node;
+    const size_t slash = path.find('/');
+    const std::string_view element = path.substr(0, slash);
+    path = (slash == std::string_view::npos) ? "" : path.substr(slash + 1);
+    auto found = node->children.find(element);
+    if (found == node->children.end()) return nullptr;
+    node = found->second.get();
+  }
+}
+
+bool CompiledPatternSet::Match(const BazelTarget &target) const {
+  if (always_match_) return true;
+  bool in_recursive = false;
+  const Node *node = Find(target.package, &in_recursive);
+  if (in_recursive) return true;
+  if (!node) return false;
+  if (node->all_targets || node->target_names.contains(target.target_name)) {
+    return true;
+  }
+  if (node->target_regex.empty() || !target_regex_set_) return false;
+  std::vector<int> matching;
+  if (!target_regex_set_->Match(target.target_name, &matching)) return false;
+  for (const int index : matching) {
+    const auto &regex = node->target_regex;
+    if (std::find(regex.begin(), regex.end(), index) != regex.end()) {
+      return true;
+    }
   }
   return false;
 }
 
+bool CompiledPatternSet::Match(const BazelPackage &package) const {
+  if (always_match_) return true;
+  bool in_recursive = false;
+  const Node *node = Find(package, &in_recursive);
+  return in_recursive || (node && node->HasPattern());
+}
+
+bool CompiledPatternSet::MatchAllTargets(const BazelPackage &package) const {
+  if (always_match_) return true;
+  bool in_recursive = false;
+  const Node *node = Find(package, &in_recursive);
+  return in_recursive || (node && node->all_targets);
+}
+
+bool CompiledPatternSet::MatchRecursively(const BazelPackage &package) const {
+  if (always_match_) return true;
+  bool in_recursive = false;
+  Find(package, &in_recursive);
+  return in_recursive;
+}
+
+void BazelPatternBundle::Finish() {
+  has_filter_ = !patterns_.empty() || !negative_patterns_.empty();
+  if (patterns_.empty()) {
+    // Make it provide a regular recursive BazelPattern to make things
+    // work seamlessly.
+    patterns_.emplace_back();
+  }
+  positive_ = std::make_shared<CompiledPatternSet>(patterns_);
+  if (!negative_patterns_.empty()) {
+    negative_ = std::make_shared<CompiledPatternSet>(negative_patterns_);
+  }
+}
+
+bool BazelPatternBundle::ExcludesRecursively(
+  const BazelPackage &package) const {
+  return negative_ && negative_->MatchRecursively(package);
+}
+
+bool BazelPatternBundle::Match(const BazelTarget &target) const {
+  if (!positive_) return true;  // Not finished: no filter.
+  return positive_->Match(target) && !(negative_ && negative_->Match(target));
+}
+
+bool BazelPatternBundle::Match(const BazelPackage &package) const {
+  if (!positive_) return true;
+  // Only negative patterns that cover the whole package exclude it; others
+  // just remove individual targets.
+  return positive_->Match(package) &&
+         !(negative_ && negative_->MatchAllTargets(package));
+}
+
 }  // namespace bant
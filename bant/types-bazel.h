@@ -61,6 +61,11 @@ struct BazelPackage {
   bool operator<(const BazelPackage &) const = default;
   bool operator==(const BazelPackage &) const = default;
   bool operator!=(const BazelPackage &) const = default;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const BazelPackage &p) {
+    return H::combine(std::move(h), p.project, p.path);
+  }
 };
 
 inline std::ostream &operator<<(std::ostream &o, const BazelPackage &p) {
@@ -123,6 +128,8 @@ class BazelTargetMatcher {
 //  like ...:all. Note with that, path() will need to be replace with something/
 //  yielding globbing results.
 class BazelPattern final : public BazelTargetMatcher {
+  friend class CompiledPatternSet;
+
  public:
   ~BazelPattern() = default;
 
@@ -140,6 +147,12 @@ class BazelPattern final : public BazelTargetMatcher {
   const std::string &path() const { return match_pattern_.package.path; }
   const std::string &project() const { return match_pattern_.package.project; }
 
+  // Name of the target for a pattern matching exactly one target, otherwise
+  // empty.
+  const std::string &target_name() const {
+    return match_pattern_.target_name;
+  }
+
   bool is_recursive() const {
     return (kind_ == MatchKind::kRecursive || kind_ == MatchKind::kAlwaysMatch);
   }
@@ -168,29 +181,42 @@ class BazelPattern final : public BazelTargetMatcher {
   MatchKind kind_;
 };
 
+// Patterns of a BazelPatternBundle compiled into a trie; see types-bazel.cc
+class CompiledPatternSet;
+
+// A set of patterns, a target matches if it matches any of them. Negative
+// patterns (on the command line prefixed with '-', e.g. -//foo/...) subtract
+// from that set; unlike bazel, independent of the order they are given.
+// Finish() compiles all patterns into a trie of package path elements, so the
+// cost of a match does not depend on the number of patterns.
 class BazelPatternBundle final : public BazelTargetMatcher {
  public:
   void AddPattern(const BazelPattern &p) { patterns_.emplace_back(p); }
-  void Finish() {
-    has_filter_ = !patterns_.empty();
-    if (!has_filter_) {
-      // Make it provide a regular recursive BazelPattern to make things
-      // work seamlessly.
-      patterns_.emplace_back();
-    }
+  void AddNegativePattern(const BazelPattern &p) {
+    negative_patterns_.emplace_back(p);
   }
 
+  // Call after all patterns are added.
+  void Finish();
+
+  // The positive patterns; these determine where to look for BUILD files.
   const std::vector<BazelPattern> &patterns() const { return patterns_; };
 
+  // Returns true if the package and all its sub-packages are excluded by
+  // a negative pattern, so no need to look any further in that directory.
+  bool ExcludesRecursively(const BazelPackage &package) const;
+  bool has_negative_patterns() const { return !negative_patterns_.empty(); }
+
   // -- BazelTargetMatcher interface
   bool HasFilter() const final { return has_filter_; }
   bool Match(const BazelTarget &target) const final;
   bool Match(const BazelPackage &package) const final;
 
  private:
-  // TODO: maybe also match negative patterns that 'subtract' ? Then store
-  // tuple here <bool, BazelPattern>.
   std::vector<BazelPattern> patterns_;
+  std::vector<BazelPattern> negative_patterns_;
+  std::shared_ptr<const CompiledPatternSet> positive_;  // shared: copyable.
+  std::shared_ptr<const CompiledPatternSet> negative_;
   bool has_filter_ = false;
 };
 }  // namespace bant
@@ -19,6 +19,7 @@
 
 #include <optional>
 #include <string_view>
+#include <vector>
 
 #include "absl/log/check.h"
 #include "gtest/gtest.h"
@@ -211,6 +212,13 @@ TEST(TypesBazel, ParseTarget) {
   }
 }
 
+TEST(TypesBazel, ParseInvalidTarget) {
+  const BazelPackage context("", "foo/bar");
+  EXPECT_FALSE(BazelTarget::ParseFrom("//foo:bar:baz", context).has_value());
+  EXPECT_FALSE(BazelTarget::ParseFrom("::", context).has_value());
+  EXPECT_FALSE(BazelTarget::ParseFrom("//foo//bar:baz", context).has_value());
+}
+
 TEST(TypesBazel, QualifiedFile) {
   const BazelPackage p("", "bar/baz");
   EXPECT_EQ(p.QualifiedFile("quux.cc"), "bar/baz/quux.cc");
@@ -376,4 +384,85 @@ TEST(TypesBazel, CheckVisibilityTargetMatch) {
   EXPECT_TRUE(VisibilityOrDie("__subpackages__", p)
                 .Match(TargetOrDie("//foo/bar/baz/and/deep/belo:hello")));
 }
+// The bundle compiles its patterns; make sure it behaves the same as the
+// individual patterns.
+TEST(TypesBazel, PatternBundleMatchesLikeIndividualPatterns) {
+  const std::vector<std::string_view> pattern_strings = {
+    "//foo/bar/...", "//foo:all", "//baz:qux", "//baz:*_test",
+    "//baz:lib*",    "@x//y/...", "@x//:root",
+  };
+  BazelPatternBundle bundle;
+  std::vector<BazelPattern> patterns;
+  for (const std::string_view p : pattern_strings) {
+    patterns.push_back(PatternOrDie(p));
+    bundle.AddPattern(patterns.back());
+  }
+  bundle.Finish();
+  EXPECT_TRUE(bundle.HasFilter());
+
+  for (const std::string_view t :
+       {"//foo:a", "//foo/bar:b", "//foo/bar/baz:c", "//foo/barbar:d",
+        "//fo:e", "//baz:qux", "//baz:quux", "//baz:foo_test", "//baz:libfoo",
+        "//baz:test_foo", "//baz/sub:qux", "@x//y/z:w", "@x//:root",
+        "@x//:other", "//y:w", "@z//foo:a"}) {
+    const BazelTarget target = TargetOrDie(t);
+    bool individual_match = false;
+    bool individual_package_match = false;
+    for (const BazelPattern &p : patterns) {
+      individual_match |= p.Match(target);
+      individual_package_match |= p.Match(target.package);
+    }
+    EXPECT_EQ(bundle.Match(target), individual_match) << t;
+    EXPECT_EQ(bundle.Match(target.package), individual_package_match) << t;
+  }
+}
+
+TEST(TypesBazel, PatternBundleEmptyMatchesEverything) {
+  BazelPatternBundle bundle;
+  bundle.Finish();
+  EXPECT_FALSE(bundle.HasFilter());
+  EXPECT_TRUE(bundle.Match(TargetOrDie("//foo:bar")));
+  EXPECT_TRUE(bundle.Match(TargetOrDie("@baz//foo:bar")));
+  ASSERT_EQ(bundle.patterns().size(), 1);
+  EXPECT_TRUE(bundle.patterns()[0].is_recursive());
+}
+
+TEST(TypesBazel, PatternBundleNegativePatterns) {
+  BazelPatternBundle bundle;
+  bundle.AddPattern(PatternOrDie("//..."));
+  bundle.AddNegativePattern(PatternOrDie("//foo/..."));
+  bundle.AddNegativePattern(PatternOrDie("//bar:baz"));
+  bundle.AddNegativePattern(PatternOrDie("//bar:*_test"));
+  bundle.Finish();
+  EXPECT_EQ(bundle.patterns().size(), 1);  // Only positive ones.
+
+  EXPECT_TRUE(bundle.Match(TargetOrDie("//:root")));
+  EXPECT_FALSE(bundle.Match(TargetOrDie("//foo:a")));
+  EXPECT_FALSE(bundle.Match(TargetOrDie("//foo/sub:a")));
+  EXPECT_TRUE(bundle.Match(TargetOrDie("//foobar:a")));
+  EXPECT_FALSE(bundle.Match(TargetOrDie("//bar:baz")));
+  EXPECT_FALSE(bundle.Match(TargetOrDie("//bar:some_test")));
+  EXPECT_TRUE(bundle.Match(TargetOrDie("//bar:lib")));
+
+  // Packages only are excluded if all their targets are.
+  EXPECT_FALSE(bundle.Match(PackageOrDie("//foo")));
+  EXPECT_FALSE(bundle.Match(PackageOrDie("//foo/sub")));
+  EXPECT_TRUE(bundle.Match(PackageOrDie("//bar")));
+
+  EXPECT_TRUE(bundle.ExcludesRecursively(PackageOrDie("//foo")));
+  EXPECT_TRUE(bundle.ExcludesRecursively(PackageOrDie("//foo/sub/deeper")));
+  EXPECT_FALSE(bundle.ExcludesRecursively(PackageOrDie("//foobar")));
+  EXPECT_FALSE(bundle.ExcludesRecursively(PackageOrDie("//bar")));
+  EXPECT_FALSE(bundle.ExcludesRecursively(PackageOrDie("//")));
+}
+
+TEST(TypesBazel, PatternBundleOnlyNegativePatterns) {
+  BazelPatternBundle bundle;
+  bundle.AddNegativePattern(PatternOrDie("//foo/..."));
+  bundle.Finish();
+  EXPECT_TRUE(bundle.HasFilter());
+  EXPECT_TRUE(bundle.Match(TargetOrDie("//bar:baz")));
+  EXPECT_TRUE(bundle.Match(TargetOrDie("@x//foo:baz")));
+  EXPECT_FALSE(bundle.Match(TargetOrDie("//foo:baz")));
+}
 }  // namespace bant
@@ -84,6 +84,8 @@ class ArenaDeque {
 
   class iterator {
    public:
+    iterator() : block_(nullptr), pos_(0) {}
+
     T &operator*() {
       assert(block_ != nullptr);
       return block_->value[pos_];
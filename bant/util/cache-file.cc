@@ -0,0 +1,167 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/util/cache-file.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <ios>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "bant/util/file-utils.h"
+
+namespace bant {
+std::optional<std::string> UserCacheDirectory() {
+  const char *homedir = getenv("HOME");
+  if (!homedir) return std::nullopt;
+  std::string cache_dir = absl::StrCat(homedir, "/.cache/bant");
+  if (!std::filesystem::is_directory(cache_dir)) return std::nullopt;
+  return cache_dir;
+}
+
+std::optional<std::string> ProjectCacheFile(std::string_view name) {
+  const std::optional<std::string> cache_dir = UserCacheDirectory();
+  if (!cache_dir.has_value()) return std::nullopt;
+  std::error_code err;
+  const auto cwd = std::filesystem::current_path(err);
+  if (err) return std::nullopt;
+  const uint64_t project_hash = std::hash<std::string>()(cwd.string());
+  return absl::StrFormat("%s/%s-%08x", *cache_dir, name,
+                         project_hash & 0xffff'ffff);
+}
+
+std::optional<FileStamp> GetFileStamp(const FilesystemPath &file) {
+  struct stat st;
+  if (stat(file.c_str(), &st) != 0) return std::nullopt;
+#if defined(__APPLE__)
+  const struct timespec &mtime = st.st_mtimespec;
+#else
+  const struct timespec &mtime = st.st_mtim;
+#endif
+  return FileStamp{
+    .inode = static_cast<int64_t>(st.st_ino),
+    .size = static_cast<int64_t>(st.st_size),
+    .mtime = static_cast<int64_t>(mtime.tv_sec) * 1'000'000'000 +
+             mtime.tv_nsec};
+}
+
+uint64_t Fingerprint(std::string_view data, uint64_t hash) {
+  for (const char c : data) {  // FNV-1a
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+bool ReadCacheFile(const std::string &file, std::string_view header,
+                   std::string *content, const CacheRecordFun &record) {
+  std::optional<std::string> read = ReadFileToString(FilesystemPath(file));
+  if (!read.has_value()) return false;
+  *content = std::move(*read);
+  std::string_view remaining = *content;
+  auto next_line = [&remaining]() {
+    const size_t eol = std::min(remaining.find('\n'), remaining.size());
+    const std::string_view line = remaining.substr(0, eol);
+    remaining.remove_prefix(std::min(eol + 1, remaining.size()));
+    return line;
+  };
+  if (next_line() != header) return false;
+
+  std::vector<std::string_view> fields;
+  while (!remaining.empty()) {
+    fields.clear();
+    for (const std::string_view field : absl::StrSplit(next_line(), '\t')) {
+      fields.push_back(field);
+    }
+    if (!record(fields)) return false;
+  }
+  return true;
+}
+
+CacheFileWriter::CacheFileWriter(std::string file, std::string_view header)
+    : file_(std::move(file)), tmp_file_(file_ + ".XXXXXX") {
+  const int fd = mkstemp(tmp_file_.data());
+  if (fd < 0) {
+    tmp_file_.clear();  // Nothing written, Commit() will fail.
+    return;
+  }
+  close(fd);
+  out_.open(tmp_file_, std::ios::out | std::ios::binary | std::ios::trunc);
+  out_ << header << "\n";
+}
+
+CacheFileWriter::~CacheFileWriter() {
+  if (!committed_ && !tmp_file_.empty()) std::remove(tmp_file_.c_str());
+}
+
+void CacheFileWriter::Write(std::span<const std::string_view> fields) {
+  const char *separator = "";
+  for (const std::string_view field : fields) {
+    out_ << separator << field;
+    separator = "\t";
+  }
+  out_ << "\n";
+}
+
+bool CacheFileWriter::Commit() {
+  if (!out_.is_open()) return false;
+  out_.close();
+  if (out_.fail()) return false;
+  if (std::rename(tmp_file_.c_str(), file_.c_str()) != 0) return false;
+  committed_ = true;
+  return true;
+}
+
+bool CacheFileWriter::IsStorable(std::string_view field) {
+  return field.find_first_of("\t\n") == std::string_view::npos;
+}
+
+std::string_view StringStore::Keep(std::string_view str) {
+  // Blocks grow, so there are few of them, but don't waste much if only a
+  // few strings are kept.
+  static constexpr size_t kMinBlockSize = 256;
+  static constexpr size_t kMaxBlockSize = 64 << 10;
+  if (blocks_.empty() || block_used_ + str.size() > block_size_) {
+    block_size_ = std::max({str.size(), kMinBlockSize,
+                            std::min(2 * block_size_, kMaxBlockSize)});
+    blocks_.emplace_back(new char[block_size_]);
+    block_used_ = 0;
+  }
+  char *const stored = blocks_.back().get() + block_used_;
+  if (!str.empty()) memcpy(stored, str.data(), str.size());
+  block_used_ += str.size();
+  return {stored, str.size()};
+}
+}  // namespace bant
@@ -0,0 +1,150 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_UTIL_CACHE_FILE_H
+#define BANT_UTIL_CACHE_FILE_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "bant/util/file-utils.h"
+
+// Utilities for data bant keeps between runs in ~/.cache/bant
+
+namespace bant {
+// If the user created a ~/.cache/bant directory, return it; nullopt
+// otherwise.
+std::optional<std::string> UserCacheDirectory();
+
+// File "<name>-<hash of current directory>" in the UserCacheDirectory(), to
+// keep data of the project in the current directory; nullopt if there is no
+// cache directory.
+std::optional<std::string> ProjectCacheFile(std::string_view name);
+
+// Inode, size and modification time of a file. As long as these don't
+// change, the content is assumed to be the same.
+struct FileStamp {
+  int64_t inode = 0;
+  int64_t size = -1;
+  int64_t mtime = 0;  // Nanoseconds.
+  bool operator==(const FileStamp &) const = default;
+};
+
+// Stamp of "file"; nullopt if it can not be stat()'ed.
+std::optional<FileStamp> GetFileStamp(const FilesystemPath &file);
+
+// Fingerprint (FNV-1a) of "data", continuing from a previous fingerprint
+// "hash", so can be used to fingerprint a sequence of strings. Stable
+// between runs.
+inline constexpr uint64_t kFingerprintInit = 0xcbf29ce484222325;
+uint64_t Fingerprint(std::string_view data, uint64_t hash = kFingerprintInit);
+
+// Parse all of "str" as number in given base.
+template <typename T>
+bool ParseNumber(std::string_view str, T *value, int base = 10) {
+  const char *const end = str.data() + str.size();
+  auto [parsed_end, ec] = std::from_chars(str.data(), end, *value, base);
+  return ec == std::errc() && parsed_end == end;
+}
+
+// Cache files are text: a header line that identifies format and version,
+// followed by one record per line with tab-separated fields.
+
+using CacheRecordFun = std::function<bool(std::span<const std::string_view>)>;
+
+// Read cache "file" into "content" and call "record" with the fields of each
+// record; these point into "content". Returns false if the file can't be
+// read, does not start with "header", or "record" returned false: then, the
+// content is not to be trusted.
+bool ReadCacheFile(const std::string &file, std::string_view header,
+                   std::string *content, const CacheRecordFun &record);
+
+// Same, for a cache that keeps what "record" extracts in "entries" (any
+// container with clear()). If the file can't be trusted, both "entries"
+// and "content" are cleared to start over.
+template <typename Entries>
+void LoadCacheFile(const std::string &file, std::string_view header,
+                   std::string *content, Entries *entries,
+                   const CacheRecordFun &record) {
+  if (!ReadCacheFile(file, header, content, record)) {
+    entries->clear();
+    content->clear();
+  }
+}
+
+// Write a cache file. Records go to a temporary file first that only
+// replaces the file on Commit(), so readers never see a partial file. The
+// temporary file is unique, so bant runs writing the same cache file at the
+// same time don't mix their records.
+class CacheFileWriter {
+ public:
+  CacheFileWriter(std::string file, std::string_view header);
+  CacheFileWriter(const CacheFileWriter &) = delete;
+  ~CacheFileWriter();  // Removes temporary file if not committed.
+
+  // Write record with given "fields"; all need to be IsStorable().
+  void Write(std::span<const std::string_view> fields);
+  void Write(std::initializer_list<std::string_view> fields) {
+    Write(std::span<const std::string_view>(fields.begin(), fields.size()));
+  }
+
+  // Replace the file with what has been written. Returns true on success.
+  bool Commit();
+
+  // If "field" can be stored (it does not contain tab or newline).
+  static bool IsStorable(std::string_view field);
+
+ private:
+  const std::string file_;
+  std::string tmp_file_;  // Empty if it could not be created.
+  std::fstream out_;
+  bool committed_ = false;
+};
+
+// Owns copies of strings such as the ones a cache got from an update. These
+// are handed out as string_views that stay valid as long as the store
+// exists. Not thread-safe.
+class StringStore {
+ public:
+  StringStore() = default;
+  StringStore(const StringStore &) = delete;
+  StringStore(StringStore &&) = default;
+  StringStore &operator=(StringStore &&) = default;
+
+  // Copy of "str" owned by the store.
+  std::string_view Keep(std::string_view str);
+
+ private:
+  // Strings are appended to blocks that never move.
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t block_size_ = 0;
+  size_t block_used_ = 0;
+};
+}  // namespace bant
+
+#endif  // BANT_UTIL_CACHE_FILE_H
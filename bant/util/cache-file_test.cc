@@ -0,0 +1,203 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/util/cache-file.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bant/util/file-utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+
+namespace bant {
+namespace {
+// Read all records of "file", fields joined with "|".
+std::optional<std::vector<std::string>> ReadRecords(const std::string &file,
+                                                    std::string_view header) {
+  std::string content;
+  std::vector<std::string> result;
+  auto record = [&](std::span<const std::string_view> fields) {
+    if (fields[0] == "bad") return false;
+    std::string joined;
+    for (const std::string_view field : fields) {
+      if (!joined.empty()) joined.append("|");
+      joined.append(field);
+    }
+    result.push_back(joined);
+    return true;
+  };
+  if (!ReadCacheFile(file, header, &content, record)) return std::nullopt;
+  return result;
+}
+
+std::vector<std::string> DirectoryEntries(const std::string &dir) {
+  std::vector<std::string> result;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    result.push_back(entry.path().filename().string());
+  }
+  return result;
+}
+}  // namespace
+
+TEST(CacheFile, ProjectCacheFileOnlyIfCacheDirectoryExists) {
+  const std::string home = ::testing::TempDir() + "/cache-file-home";
+  mkdir(home.c_str(), 0755);
+  rmdir((home + "/.cache/bant").c_str());  // Possibly left from previous run.
+  rmdir((home + "/.cache").c_str());
+  setenv("HOME", home.c_str(), 1);
+  EXPECT_FALSE(UserCacheDirectory().has_value());
+  EXPECT_FALSE(ProjectCacheFile("foo").has_value());
+
+  mkdir((home + "/.cache").c_str(), 0755);
+  mkdir((home + "/.cache/bant").c_str(), 0755);
+  EXPECT_EQ(UserCacheDirectory(), home + "/.cache/bant");
+  const std::optional<std::string> file = ProjectCacheFile("foo");
+  ASSERT_TRUE(file.has_value());
+  EXPECT_TRUE(file->starts_with(home + "/.cache/bant/foo-")) << *file;
+  EXPECT_EQ(ProjectCacheFile("foo"), file);  // Same project, same file.
+}
+
+TEST(CacheFile, FileStampChangesWithFile) {
+  const std::string file = ::testing::TempDir() + "/cache-file-stamp";
+  std::ofstream(file) << "hello";
+  const std::optional<FileStamp> stamp = GetFileStamp(FilesystemPath(file));
+  ASSERT_TRUE(stamp.has_value());
+  EXPECT_EQ(stamp->size, 5);
+  EXPECT_EQ(GetFileStamp(FilesystemPath(file)), stamp);
+
+  std::ofstream(file) << "hello world";
+  EXPECT_NE(GetFileStamp(FilesystemPath(file)), stamp);
+
+  unlink(file.c_str());
+  EXPECT_FALSE(GetFileStamp(FilesystemPath(file)).has_value());
+}
+
+TEST(CacheFile, FingerprintCanBeContinued) {
+  EXPECT_EQ(Fingerprint("foobar"), Fingerprint("bar", Fingerprint("foo")));
+  EXPECT_EQ(Fingerprint(""), kFingerprintInit);
+  EXPECT_NE(Fingerprint("foo"), Fingerprint("bar"));
+}
+
+TEST(CacheFile, ParseNumber) {
+  int64_t value = 0;
+  EXPECT_TRUE(ParseNumber("42", &value));
+  EXPECT_EQ(value, 42);
+  EXPECT_TRUE(ParseNumber("ff", &value, 16));
+  EXPECT_EQ(value, 255);
+  EXPECT_FALSE(ParseNumber("42x", &value));
+  EXPECT_FALSE(ParseNumber("", &value));
+}
+
+TEST(CacheFile, WriteAndRead) {
+  const std::string file = ::testing::TempDir() + "/cache-file-records";
+  unlink(file.c_str());
+  EXPECT_FALSE(ReadRecords(file, "test 1").has_value());
+
+  {
+    CacheFileWriter out(file, "test 1");
+    out.Write({"A", "foo", "42"});
+    out.Write({"B", ""});
+    const std::vector<std::string_view> fields = {"C", "bar"};
+    out.Write(fields);
+    EXPECT_TRUE(out.Commit());
+  }
+  EXPECT_THAT(ReadRecords(file, "test 1"),
+              testing::Optional(ElementsAre("A|foo|42", "B|", "C|bar")));
+
+  // Other format or version.
+  EXPECT_FALSE(ReadRecords(file, "test 2").has_value());
+
+  EXPECT_TRUE(CacheFileWriter::IsStorable("foo bar"));
+  EXPECT_FALSE(CacheFileWriter::IsStorable("foo\tbar"));
+  EXPECT_FALSE(CacheFileWriter::IsStorable("foo\nbar"));
+}
+
+TEST(CacheFile, RejectedRecordFailsRead) {
+  const std::string file = ::testing::TempDir() + "/cache-file-rejected";
+  std::ofstream(file) << "test 1\n"
+                      << "A\tfoo\n"
+                      << "bad\tbar\n";
+  EXPECT_FALSE(ReadRecords(file, "test 1").has_value());
+}
+
+TEST(CacheFile, UncommittedWriteLeavesFileUntouched) {
+  const std::string dir = ::testing::TempDir() + "/cache-file-uncommitted";
+  mkdir(dir.c_str(), 0755);
+  const std::string file = dir + "/cache";
+  {
+    CacheFileWriter out(file, "test 1");
+    out.Write({"A", "foo"});
+    EXPECT_TRUE(out.Commit());
+  }
+  {
+    CacheFileWriter out(file, "test 1");
+    out.Write({"B", "bar"});
+  }
+  EXPECT_THAT(ReadRecords(file, "test 1"),
+              testing::Optional(ElementsAre("A|foo")));
+  EXPECT_THAT(DirectoryEntries(dir), ElementsAre("cache"));  // No tmp left.
+}
+
+TEST(CacheFile, ConcurrentWritersDontMixRecords) {
+  const std::string dir = ::testing::TempDir() + "/cache-file-concurrent";
+  mkdir(dir.c_str(), 0755);
+  const std::string file = dir + "/cache";
+  CacheFileWriter first(file, "test 1");
+  CacheFileWriter second(file, "test 1");
+  first.Write({"A", "first"});
+  second.Write({"A", "second"});
+  first.Write({"B", "first"});
+  second.Write({"B", "second"});
+
+  EXPECT_TRUE(first.Commit());
+  EXPECT_THAT(ReadRecords(file, "test 1"),
+              testing::Optional(ElementsAre("A|first", "B|first")));
+  EXPECT_TRUE(second.Commit());  // Last one wins, but complete.
+  EXPECT_THAT(ReadRecords(file, "test 1"),
+              testing::Optional(ElementsAre("A|second", "B|second")));
+}
+
+TEST(CacheFile, StringStoreKeepsCopies) {
+  StringStore store;
+  std::vector<std::string_view> kept;
+  std::string str;
+  for (int i = 0; i < 10000; ++i) {  // Enough to need multiple blocks.
+    str = "string-" + std::to_string(i);
+    kept.push_back(store.Keep(str));
+  }
+  kept.push_back(store.Keep(""));
+  kept.push_back(store.Keep(std::string(100'000, 'x')));  // Larger than block.
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(kept[i], "string-" + std::to_string(i));
+  }
+  EXPECT_EQ(kept[10000], "");
+  EXPECT_EQ(kept[10001], std::string(100'000, 'x'));
+}
+}  // namespace bant
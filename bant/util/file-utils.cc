@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <deque>
@@ -157,6 +158,42 @@ std::optional<std::string> ReadFileToString(const FilesystemPath &filename) {
   return content;
 }
 
+std::optional<std::string> ReadFilePrefix(
+  const FilesystemPath &filename,
+  const std::function<bool(std::string_view)> &have_enough,
+  size_t *file_size) {
+  static constexpr size_t kFirstChunkSize = 16384;
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return std::nullopt;
+  const absl::Cleanup fd_closer = [fd]() { close(fd); };
+  struct stat st;
+  if (fstat(fd, &st) != 0) return std::nullopt;
+
+  FilesystemPrewarmCacheRememberFileWasAccessed(filename.path());
+  *file_size = st.st_size;
+  std::string content;
+  size_t chunk_size = kFirstChunkSize;
+  while (content.size() < *file_size) {
+    // Doubling the size each time: scanning the accumulated content in
+    // have_enough() over and over stays linear.
+    const size_t to_read = std::min(chunk_size, *file_size - content.size());
+    const size_t previous_size = content.size();
+    content.resize(previous_size + to_read);
+    size_t bytes_read = 0;
+    while (bytes_read < to_read) {
+      const ssize_t r = read(fd, content.data() + previous_size + bytes_read,
+                             to_read - bytes_read);
+      if (r <= 0) break;
+      bytes_read += r;
+    }
+    content.resize(previous_size + bytes_read);
+    if (bytes_read < to_read) break;  // File shorter than expected ?
+    if (have_enough(content)) break;
+    chunk_size *= 2;
+  }
+  return content;
+}
+
 // Best effort on filesystems that don't have inodes; they typically emit some
 // placeholder value such as 0 or -1.
 // In consequence, loop-detection is essentially disabled for these filesystems.
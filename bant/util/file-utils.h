@@ -84,6 +84,15 @@ std::vector<FilesystemPath> Glob(std::string_view glob_pattern);
 // an error, return a nullopt.
 std::optional<std::string> ReadFileToString(const FilesystemPath &filename);
 
+// Read the beginning of a file incrementally, in chunks of increasing size,
+// until "have_enough" returns true for the content read so far or the end of
+// the file is reached. Returns the content read (which might extend beyond
+// what "have_enough" needed) and the full size of the file in "file_size".
+std::optional<std::string> ReadFilePrefix(
+  const FilesystemPath &filename,
+  const std::function<bool(std::string_view)> &have_enough,
+  size_t *file_size);
+
 // Collect files found recursively (BFS) and return.
 // Uses predicate "want_dir_p" to check if directory should be entered, and
 // "want_file_p" if file should be included; if so, it is added to "paths".
@@ -19,7 +19,12 @@
 
 #include <dirent.h>
 
+#include <cstddef>
 #include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
 
 #include "gtest/gtest.h"
 
@@ -59,4 +64,32 @@ TEST(FileUtils, FilesystemPathCopy) {
   EXPECT_EQ(other.filename(), "baz");
 }
 
+TEST(FileUtils, ReadFilePrefix) {
+  const std::string filename = ::testing::TempDir() + "/read-prefix.txt";
+  const std::string expected_content(100000, 'x');
+  std::ofstream(filename) << expected_content;
+
+  size_t file_size = 0;
+  const std::optional<std::string> prefix = ReadFilePrefix(
+    FilesystemPath(filename),
+    [](std::string_view content) { return content.size() >= 20000; },
+    &file_size);
+  ASSERT_TRUE(prefix.has_value());
+  EXPECT_EQ(file_size, expected_content.size());
+  EXPECT_GE(prefix->size(), 20000);
+  EXPECT_LT(prefix->size(), expected_content.size());  // stopped early
+  EXPECT_TRUE(expected_content.starts_with(*prefix));
+
+  const std::optional<std::string> full =
+    ReadFilePrefix(FilesystemPath(filename),  //
+                   [](std::string_view) { return false; }, &file_size);
+  ASSERT_TRUE(full.has_value());
+  EXPECT_EQ(*full, expected_content);
+
+  EXPECT_FALSE(ReadFilePrefix(FilesystemPath(filename + ".nonexistent"),
+                              [](std::string_view) { return false; },
+                              &file_size)
+                 .has_value());
+}
+
 }  // namespace bant
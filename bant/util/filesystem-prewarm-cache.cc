@@ -20,81 +20,27 @@
 #include <dirent.h>
 #include <unistd.h>
 
-#include <condition_variable>
 #include <cstdint>
-#include <cstdlib>
-#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <ios>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <system_error>
-#include <thread>
-#include <vector>
 
 #include "absl/container/flat_hash_set.h"
-#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "bant/util/cache-file.h"
+#include "bant/util/thread-pool.h"
 
 namespace bant {
 namespace {
 static constexpr int kPrewarmParallelism = 32;
 
-// Simplistic thread-pool.
-class ThreadPool {
- public:
-  explicit ThreadPool(int count) {
-    while (count--) {
-      threads_.push_back(new std::thread(&ThreadPool::Runner, this));
-    }
-  }
-
-  ~ThreadPool() {
-    CancelAllWork();
-    for (std::thread *t : threads_) {
-      t->join();
-      delete t;
-    }
-  }
-
-  void ExecAsync(const std::function<void()> &fun) {
-    lock_.lock();
-    work_queue_.push_back(fun);
-    lock_.unlock();
-    cv_.notify_one();
-  }
-
-  void CancelAllWork() {
-    lock_.lock();
-    exiting_ = true;
-    lock_.unlock();
-    cv_.notify_all();
-  }
-
- private:
-  void Runner() {
-    for (;;) {
-      std::unique_lock<std::mutex> l(lock_);
-      cv_.wait(l, [this]() { return !work_queue_.empty() || exiting_; });
-      if (exiting_) return;
-      auto process_work_item = work_queue_.front();
-      work_queue_.pop_front();
-      l.unlock();
-      process_work_item();
-    }
-  }
-
-  std::vector<std::thread *> threads_;
-  std::mutex lock_;
-  std::condition_variable cv_;
-  std::deque<std::function<void()>> work_queue_;
-  bool exiting_ = false;
-};
-
 class FilesystemPrewarmCache {
  public:
   // Singleton access to the one global caching object.
@@ -111,10 +57,12 @@ class FilesystemPrewarmCache {
  private:
   void WritePrefixed(char prefix, std::string_view f) {
     if (!writer_) return;
+    const std::lock_guard<std::mutex> l(writer_lock_);  // Parallel file reads.
     if (!already_seen_.insert(std::string{f}).second) return;
     *writer_ << prefix << f << "\n";
   }
 
+  std::mutex writer_lock_;
   std::unique_ptr<std::fstream> writer_;
   absl::flat_hash_set<std::string> already_seen_;
   std::unique_ptr<ThreadPool> pool_;
@@ -159,10 +107,8 @@ void FilesystemPrewarmCache::InitCacheFile(const std::string &cache_file) {
 
 void FilesystemPrewarmCacheInit(int argc, char *argv[]) {
   // If the user created a ~/.cache/bant directory, use that.
-  const char *homedir = getenv("HOME");
-  if (!homedir) return;
-  const std::string cache_dir = absl::StrCat(homedir, "/.cache/bant");
-  if (!std::filesystem::is_directory(cache_dir)) return;  // no dir, no cache.
+  const std::optional<std::string> cache_dir = UserCacheDirectory();
+  if (!cache_dir.has_value()) return;  // no dir, no cache.
 
   // Make filename unique to match cwd and arguments.
   std::error_code err;
@@ -187,7 +133,7 @@ void FilesystemPrewarmCacheInit(int argc, char *argv[]) {
   }
 
   const std::string cache_file = absl::StrFormat(
-    "%s/fs-warm-%08x", cache_dir, argument_dependent_hash & 0xffff'ffff);
+    "%s/fs-warm-%08x", *cache_dir, argument_dependent_hash & 0xffff'ffff);
   FilesystemPrewarmCache::instance().InitCacheFile(cache_file);
 }
 
@@ -0,0 +1,65 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/util/thread-pool.h"
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace bant {
+ThreadPool::ThreadPool(int count) {
+  while (count--) {
+    threads_.push_back(new std::thread(&ThreadPool::Runner, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  CancelAllWork();
+  for (std::thread *t : threads_) {
+    t->join();
+    delete t;
+  }
+}
+
+void ThreadPool::Enqueue(std::function<void()> &&work) {
+  lock_.lock();
+  work_queue_.push_back(std::move(work));
+  lock_.unlock();
+  cv_.notify_one();
+}
+
+void ThreadPool::CancelAllWork() {
+  lock_.lock();
+  exiting_ = true;
+  lock_.unlock();
+  cv_.notify_all();
+}
+
+void ThreadPool::Runner() {
+  for (;;) {
+    std::unique_lock<std::mutex> l(lock_);
+    cv_.wait(l, [this]() { return !work_queue_.empty() || exiting_; });
+    if (exiting_) return;
+    auto process_work_item = std::move(work_queue_.front());
+    work_queue_.pop_front();
+    l.unlock();
+    process_work_item();
+  }
+}
+}  // namespace bant
@@ -0,0 +1,73 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef BANT_UTIL_THREAD_POOL_H
+#define BANT_UTIL_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bant {
+// Threads to read many files with. Reading is I/O bound, possibly on a slow
+// network filesystem, so this is independent of the number of cores.
+inline constexpr int kFileReadParallelism = 16;
+
+// Simplistic thread-pool.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int count);
+  ThreadPool(const ThreadPool &) = delete;
+
+  // Cancels all work not started yet and waits for running work to finish.
+  ~ThreadPool();
+
+  // Schedule "fun" to be executed in one of the threads. The returned future
+  // provides the result once done; it can be ignored for fire-and-forget.
+  template <typename Fun>
+  std::future<std::invoke_result_t<Fun>> ExecAsync(Fun &&fun) {
+    using Result = std::invoke_result_t<Fun>;
+    auto task =
+      std::make_shared<std::packaged_task<Result()>>(std::forward<Fun>(fun));
+    std::future<Result> result = task->get_future();
+    Enqueue([task]() { (*task)(); });
+    return result;
+  }
+
+  // Drop all work not started yet and stop the threads.
+  void CancelAllWork();
+
+ private:
+  void Enqueue(std::function<void()> &&work);
+  void Runner();
+
+  std::vector<std::thread *> threads_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> work_queue_;
+  bool exiting_ = false;
+};
+}  // namespace bant
+
+#endif  // BANT_UTIL_THREAD_POOL_H
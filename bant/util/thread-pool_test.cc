@@ -0,0 +1,46 @@
+// bant - Bazel Navigation Tool
+// Copyright (C) 2024 Henner Zeller <h.zeller@acm.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "bant/util/thread-pool.h"
+
+#include <future>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace bant {
+TEST(ThreadPool, FuturesProvideResults) {
+  ThreadPool pool(4);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i) {
+    results.push_back(pool.ExecAsync([i]() { return i * i; }));
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(results[i].get(), i * i);
+  }
+}
+
+TEST(ThreadPool, VoidWork) {
+  int value = 0;
+  {
+    ThreadPool pool(1);
+    std::future<void> done = pool.ExecAsync([&value]() { value = 42; });
+    done.wait();
+  }
+  EXPECT_EQ(value, 42);
+}
+}  // namespace bant
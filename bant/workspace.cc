@@ -110,7 +110,10 @@ static bool LoadWorkspaceFromFile(Session &session,
   if (!ast) return false;
 
   query::FindTargets(
-    ast, {"http_archive", "bazel_dep"}, [&](const query::Result &result) {
+    ast, {"http_archive", "bazel_dep"},
+    {query::Attribute::kName, query::Attribute::kVersion,
+     query::Attribute::kRepoName},
+    [&](const query::Result &result) {
       // Sometimes, the version is attached to the dirs (bazel 6), somtimes
       // not (before bazel 6: plain file, at bazel 7: just ~, at bazel 8 '+')
       // Check for both if we have a version.